@@ -0,0 +1,116 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <device_control_messages/measurement.h>
+#include <storage/column_kernels.h>
+
+void print_help_message()
+{
+    std::cout << "Benchmark comparing scalar and vectorized scans of temperature and fan speed columns.\n\n";
+    std::cout << "Example of usage:\n"
+              << "    ./column_kernels_benchmark --values 1000000 --iterations 200\n"
+              << std::endl;
+}
+
+template <class ValueType>
+std::vector<ValueType> make_column(size_t size_, ValueType error_value_)
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<uint32_t> distribution(0, std::numeric_limits<ValueType>::max());
+    std::vector<ValueType> column(size_);
+    for (auto& value : column)
+    {
+        value = static_cast<ValueType>(distribution(generator));
+        if (value % 100 == 0)
+            value = error_value_;
+    }
+    return column;
+}
+
+// Run scan given number of times, return throughput in GB/s
+template <class Scan>
+double measure(size_t bytes_, size_t iterations_, Scan&& scan_)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations_; i++)
+    {
+        scan_();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(bytes_ * iterations_) / elapsed.count() / 1e9;
+}
+
+template <class ValueType>
+void run(const char* column_name_, size_t values_, size_t iterations_, ValueType error_value_)
+{
+    using hw::storage::kernels::isa;
+
+    auto column = make_column<ValueType>(values_, error_value_);
+    std::span<const ValueType> span(column);
+    auto bytes = column.size() * sizeof(ValueType);
+
+    double scalar_aggregate{0};
+    double scalar_count{0};
+    for (auto kernel_isa : {isa::scalar, isa::sse4, isa::avx2})
+    {
+        if (!hw::storage::kernels::supported(kernel_isa))
+            continue;
+
+        volatile size_t sink{0};
+        auto aggregate = measure(bytes, iterations_, [&] {
+            hw::storage::column_aggregate result;
+            hw::storage::kernels::aggregate(span, error_value_, result, kernel_isa);
+            sink = sink + result.count;
+        });
+        auto count = measure(bytes, iterations_, [&] { sink = sink + hw::storage::kernels::count_above(span, ValueType{100}, error_value_, kernel_isa); });
+        if (kernel_isa == isa::scalar)
+        {
+            scalar_aggregate = aggregate;
+            scalar_count     = count;
+        }
+
+        std::cout << std::setw(8) << column_name_ << std::setw(8) << hw::storage::kernels::isa_name(kernel_isa) << std::fixed << std::setprecision(2)
+                  << std::setw(16) << aggregate << std::setw(10) << aggregate / scalar_aggregate << std::setw(16) << count << std::setw(10)
+                  << count / scalar_count << '\n';
+    }
+}
+
+int main(int argc_, char** argv_)
+{
+    namespace po = boost::program_options;
+
+    po::options_description options("Options");
+    po::variables_map vm;
+
+    size_t values;
+    size_t iterations;
+
+    // clang-format off
+    options.add_options()
+            ("help,h", "Produce help message")
+            ("values", po::value<size_t>(&values)->default_value(1000000), "Number of values in scanned column")
+            ("iterations", po::value<size_t>(&iterations)->default_value(200), "Number of scans of each kernel");
+    // clang-format on
+
+    po::store(po::command_line_parser(argc_, argv_).options(options).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help"))
+    {
+        print_help_message();
+        std::cout << options << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    std::cout << std::setw(8) << "column" << std::setw(8) << "isa" << std::setw(16) << "aggregate GB/s" << std::setw(10) << "speedup" << std::setw(16)
+              << "count GB/s" << std::setw(10) << "speedup" << '\n';
+    run<uint16_t>("temp", values, iterations, hw::device_control_messages::measurement::error_temperature);
+    run<uint8_t>("fan", values, iterations, hw::device_control_messages::measurement::error_fan_speed);
+
+    return EXIT_SUCCESS;
+}
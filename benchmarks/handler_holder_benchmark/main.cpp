@@ -0,0 +1,104 @@
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <common/handler_holder.h>
+
+void print_help_message()
+{
+    std::cout << "Benchmark comparing invocation of callbacks held by lock-free and mutex-protected handler holders.\n\n";
+    std::cout << "Example of usage:\n"
+              << "    ./handler_holder_benchmark --threads 1 2 4 8 --calls 10000000\n"
+              << std::endl;
+}
+
+// Invoke holder from given number of threads concurrently, return millions of invocations per second
+template <class Holder>
+double measure(size_t threads_count_, size_t calls_)
+{
+    Holder holder;
+    std::atomic<size_t> total{0};
+    holder = [&total](size_t value_) {
+        // Per-thread work of a trivial callback, shared state is touched once per thread at the end
+        thread_local size_t sum{0};
+        sum += value_;
+        if (value_ == 0)
+        {
+            total += sum;
+            sum = 0;
+        }
+    };
+
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threads_count_; t++)
+    {
+        threads.emplace_back([&] {
+            while (!go)
+            {
+                std::this_thread::yield();
+            }
+            for (size_t i = 1; i <= calls_; i++)
+            {
+                holder(i);
+            }
+            holder(size_t{0});
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go         = true;
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (total != threads_count_ * calls_ * (calls_ + 1) / 2)
+        std::cerr << "Unexpected sum of invocations" << std::endl;
+    return static_cast<double>(threads_count_ * calls_) / elapsed.count() / 1e6;
+}
+
+int main(int argc_, char** argv_)
+{
+    namespace po = boost::program_options;
+
+    po::options_description options("Options");
+    po::variables_map vm;
+
+    std::vector<size_t> threads;
+    size_t calls;
+
+    // clang-format off
+    options.add_options()
+            ("help,h", "Produce help message")
+            ("threads", po::value<std::vector<size_t>>(&threads)->multitoken()->default_value({1, 2, 4}, "1 2 4"), "Numbers of invoking threads")
+            ("calls", po::value<size_t>(&calls)->default_value(10000000), "Number of invocations per thread");
+    // clang-format on
+
+    po::store(po::command_line_parser(argc_, argv_).options(options).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help"))
+    {
+        print_help_message();
+        std::cout << options << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    std::cout << std::setw(8) << "threads" << std::setw(18) << "lock-free Mcall/s" << std::setw(18) << "mutex Mcall/s" << std::setw(10) << "speedup" << '\n';
+    for (auto threads_count : threads)
+    {
+        auto lock_free = measure<hw::common::handler_holder<void(size_t)>>(threads_count, calls);
+        auto locking   = measure<hw::common::locking_handler_holder<void(size_t)>>(threads_count, calls);
+        std::cout << std::setw(8) << threads_count << std::fixed << std::setprecision(2) << std::setw(18) << lock_free << std::setw(18) << locking
+                  << std::setw(10) << lock_free / locking << '\n';
+    }
+
+    return EXIT_SUCCESS;
+}
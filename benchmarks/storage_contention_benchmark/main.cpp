@@ -0,0 +1,130 @@
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <device_messages_storage.h>
+
+void print_help_message()
+{
+    std::cout << "Benchmark measuring ingest throughput of device messages storage with increasing number of concurrently storing threads.\n\n";
+    std::cout << "Example of usage:\n"
+              << "    ./storage_contention_benchmark --threads 1 2 4 8 --shards 1 16 --messages 100000\n"
+              << std::endl;
+}
+
+// Prepare messages stored by one thread. Every thread stores messages of its own set of devices.
+std::vector<hw::device_control_messages::device_message_type> prepare_messages(size_t thread_id_, size_t messages_, size_t devices_)
+{
+    std::vector<hw::device_control_messages::device_message_type> messages;
+    messages.reserve(messages_);
+    for (size_t i = 0; i < messages_; i++)
+    {
+        auto device_name = "device_" + std::to_string(thread_id_) + "_" + std::to_string(i % devices_);
+        if (i % 100 == 99)
+        {
+            messages.emplace_back(hw::device_control_messages::error(device_name, hw::device_control_messages::error::error_type::unknown));
+        }
+        else
+        {
+            hw::device_control_messages::measurement meas(device_name);
+            meas.temperature_sensors = {static_cast<uint16_t>(i), 2, 3};
+            meas.fans_speed          = {static_cast<uint8_t>(i)};
+            messages.emplace_back(std::move(meas));
+        }
+    }
+    return messages;
+}
+
+// Store prepared messages from given number of threads, return throughput in messages per second
+double run(const hw::storage_config& config_, size_t threads_, size_t messages_, size_t devices_)
+{
+    hw::device_messages_storage storage(config_);
+
+    std::vector<std::vector<hw::device_control_messages::device_message_type>> per_thread_messages;
+    for (size_t t = 0; t < threads_; t++)
+    {
+        per_thread_messages.push_back(prepare_messages(t, messages_, devices_));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threads_; t++)
+    {
+        threads.emplace_back([&storage, &messages = per_thread_messages[t]] {
+            for (auto& msg : messages)
+            {
+                storage.new_message(std::move(msg));
+            }
+        });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(threads_ * messages_) / elapsed.count();
+}
+
+int main(int argc_, char** argv_)
+{
+    namespace po = boost::program_options;
+
+    po::options_description options("Options");
+    po::variables_map vm;
+
+    std::vector<size_t> threads_counts;
+    std::vector<size_t> shards_counts;
+    size_t messages;
+    size_t devices;
+    bool counts_only;
+
+    // clang-format off
+    options.add_options()
+            ("help,h", "Produce help message")
+            ("threads", po::value<std::vector<size_t>>(&threads_counts)->multitoken()->default_value({1, 2, 4, 8}, "1 2 4 8"),
+                "Numbers of concurrently storing threads to measure")
+            ("shards", po::value<std::vector<size_t>>(&shards_counts)->multitoken()->default_value({1, 16}, "1 16"),
+                "Numbers of storage shards to measure")
+            ("messages", po::value<size_t>(&messages)->default_value(200000), "Number of messages stored by each thread")
+            ("devices", po::value<size_t>(&devices)->default_value(16), "Number of devices per thread")
+            ("counts-only", po::bool_switch(&counts_only), "Measure storage in counts only mode");
+    // clang-format on
+
+    po::store(po::command_line_parser(argc_, argv_).options(options).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help"))
+    {
+        print_help_message();
+        std::cout << options << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    std::cout << std::setw(10) << "shards" << std::setw(10) << "threads" << std::setw(16) << "msgs/s" << std::setw(10) << "speedup" << '\n';
+    for (auto shards : shards_counts)
+    {
+        hw::storage_config config;
+        config.shards_count = shards;
+        config.mode         = counts_only ? hw::storage_mode::counts_only : hw::storage_mode::full;
+
+        double single_thread_throughput{0};
+        for (auto threads : threads_counts)
+        {
+            auto throughput = run(config, threads, messages, devices);
+            if (single_thread_throughput == 0)
+                single_thread_throughput = throughput;
+
+            std::cout << std::setw(10) << shards << std::setw(10) << threads << std::setw(16) << std::fixed << std::setprecision(0) << throughput
+                      << std::setw(10) << std::setprecision(2) << throughput / single_thread_throughput << '\n';
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
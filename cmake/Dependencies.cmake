@@ -7,3 +7,14 @@ if(BUILD_TESTS)
     find_package(Catch2 2.0.0 REQUIRED)
 endif()
 
+
+# Optional io_uring backend, only kernel headers with multishot receive (Linux 6.0) are needed
+if(WITH_IO_URING)
+    include(CheckSymbolExists)
+    check_symbol_exists(IORING_RECV_MULTISHOT linux/io_uring.h HAVE_IO_URING_RECV_MULTISHOT)
+    if(HAVE_IO_URING_RECV_MULTISHOT)
+        add_compile_definitions(HW_WITH_IO_URING)
+    else()
+        message(WARNING "linux/io_uring.h with multishot receive not found, building without io_uring backend")
+    endif()
+endif()
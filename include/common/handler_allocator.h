@@ -0,0 +1,147 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace hw::common
+{
+
+/**
+ * @brief Preallocated storage of Boost.Asio handlers of one object.
+ *
+ * Boost.Asio allocates an operation object for every posted handler and every started asynchronous operation. Storage provides a fixed
+ * number of slots for these operations, taking a free slot is one atomic exchange and releasing it is one atomic store, so an object which
+ * never has more operations in flight than slots performs no heap allocation in steady state. Operations larger than a slot or exceeding
+ * the number of slots fall back to the heap.
+ */
+class handler_memory
+{
+public:
+    static constexpr size_t slot_size   = 256; //!< Size of one slot in bytes
+    static constexpr size_t slots_count = 16;  //!< Number of slots
+
+    handler_memory()                                 = default;
+    handler_memory(const handler_memory&)            = delete;
+    handler_memory& operator=(const handler_memory&) = delete;
+
+    /**
+     * @brief Allocate memory of operation
+     *
+     * @param size_ Size in bytes
+     * @return Free slot, heap memory if no slot is free or the size exceeds slot size
+     */
+    void* allocate(size_t size_)
+    {
+        if (size_ <= slot_size)
+        {
+            for (size_t i = 0; i < slots_count; i++)
+            {
+                if (!_used[i].load(std::memory_order_relaxed) && !_used[i].exchange(true, std::memory_order_acquire))
+                    return &_slots[i];
+            }
+        }
+        return ::operator new(size_);
+    }
+
+    /**
+     * @brief Release memory returned by @ref allocate
+     *
+     * @param pointer_ Released memory
+     */
+    void deallocate(void* pointer_)
+    {
+        auto slot = static_cast<slot_storage*>(pointer_);
+        if (slot >= _slots.data() && slot < _slots.data() + slots_count)
+            _used[static_cast<size_t>(slot - _slots.data())].store(false, std::memory_order_release);
+        else
+            ::operator delete(pointer_);
+    }
+
+private:
+    struct alignas(std::max_align_t) slot_storage
+    {
+        std::byte data[slot_size];
+    };
+
+    std::array<slot_storage, slots_count> _slots;
+    std::array<std::atomic<bool>, slots_count> _used{};
+};
+
+/**
+ * @brief Allocator of Boost.Asio operations taking memory from @ref handler_memory
+ *
+ * @tparam T Allocated type
+ */
+template <class T>
+class handler_allocator
+{
+public:
+    using value_type = T;
+
+    explicit handler_allocator(handler_memory& memory_) noexcept
+        : _memory(&memory_)
+    {}
+
+    template <class U>
+    handler_allocator(const handler_allocator<U>& other_) noexcept
+        : _memory(other_._memory)
+    {}
+
+    T* allocate(size_t count_) { return static_cast<T*>(_memory->allocate(sizeof(T) * count_)); }
+
+    void deallocate(T* pointer_, size_t) noexcept { _memory->deallocate(pointer_); }
+
+    template <class U>
+    bool operator==(const handler_allocator<U>& other_) const noexcept
+    {
+        return _memory == other_._memory;
+    }
+
+    template <class U>
+    bool operator!=(const handler_allocator<U>& other_) const noexcept
+    {
+        return _memory != other_._memory;
+    }
+
+private:
+    template <class>
+    friend class handler_allocator;
+
+    handler_memory* _memory;
+};
+
+/**
+ * @brief Handler whose Boost.Asio operations are allocated from @ref handler_memory.
+ * The handler shares ownership of the memory, so operations still queued when the owning object is destroyed are released safely.
+ *
+ * @tparam Handler Wrapped handler
+ */
+template <class Handler>
+class allocating_handler
+{
+public:
+    //! Allocator associated with the handler, picked up by Boost.Asio
+    using allocator_type = handler_allocator<std::byte>;
+
+    allocating_handler(std::shared_ptr<handler_memory> memory_, Handler handler_)
+        : _memory(std::move(memory_))
+        , _handler(std::move(handler_))
+    {}
+
+    allocator_type get_allocator() const noexcept { return allocator_type(*_memory); }
+
+    template <class... Args>
+    void operator()(Args&&... args_)
+    {
+        _handler(std::forward<Args>(args_)...);
+    }
+
+private:
+    std::shared_ptr<handler_memory> _memory;
+    Handler _handler;
+};
+}
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <optional>
 
 namespace hw::common
@@ -10,6 +13,11 @@ namespace hw::common
  * @brief Class holding callback function.
  * Purpose of this class is to make work with callbacks cleaner and easier.
  *
+ * Invocation takes no lock: it atomically loads shared pointer to the current callback and calls it, so concurrent invocations run in
+ * parallel. The callback can be replaced at any time, invocations which already loaded the previous callback finish with it and the last
+ * of them destroys it, together with its captured state.
+ * Use @ref locking_handler_holder when invocations must not overlap.
+ *
  * @tparam HandlerSignature Signature of the callback function
  */
 template <class HandlerSignature>
@@ -18,6 +26,9 @@ class handler_holder
 public:
     handler_holder() = default;
 
+    handler_holder(const handler_holder&)            = delete;
+    handler_holder& operator=(const handler_holder&) = delete;
+
     /**
      * @brief Assign callback function
      *
@@ -25,6 +36,58 @@ public:
      * @return handler_holder this
      */
     handler_holder& operator=(std::function<HandlerSignature> handler_)
+    {
+        _current.store(std::make_shared<const std::function<HandlerSignature>>(std::move(handler_)), std::memory_order_release);
+        return *this;
+    }
+
+    /**
+     * @brief Call operator
+     *
+     * @tparam Args Arg pack
+     * @param args_ Forwarded arguments
+     */
+    template <class... Args>
+    void operator()(Args&&... args_) const
+    {
+        if (auto handler = _current.load(std::memory_order_acquire); handler && *handler)
+            (*handler)(std::forward<Args>(args_)...);
+    }
+
+    /**
+     * @brief Get copy of current callback function, e.g. to hand it over to an object invoking it directly
+     *
+     * @return Callback function, empty if none is assigned
+     */
+    std::function<HandlerSignature> get() const
+    {
+        auto handler = _current.load(std::memory_order_acquire);
+        return handler ? *handler : std::function<HandlerSignature>{};
+    }
+
+private:
+    std::atomic<std::shared_ptr<const std::function<HandlerSignature>>> _current;
+};
+
+/**
+ * @brief Class holding callback function, invocations are serialized by a mutex.
+ * The mutex is held while the callback runs, so the callback is never invoked concurrently and is not replaced while it runs.
+ *
+ * @tparam HandlerSignature Signature of the callback function
+ */
+template <class HandlerSignature>
+class locking_handler_holder
+{
+public:
+    locking_handler_holder() = default;
+
+    /**
+     * @brief Assign callback function
+     *
+     * @param handler_ Callback function
+     * @return locking_handler_holder this
+     */
+    locking_handler_holder& operator=(std::function<HandlerSignature> handler_)
     {
         std::scoped_lock lock(_mtx);
         _handler = std::move(handler_);
@@ -41,7 +104,7 @@ public:
     void operator()(Args&&... args_)
     {
         std::scoped_lock lock(_mtx);
-        if (_handler)
+        if (_handler && *_handler)
             (*_handler)(std::forward<Args>(args_)...);
     }
 
@@ -49,4 +112,4 @@ private:
     std::mutex _mtx;
     std::optional<std::function<HandlerSignature>> _handler;
 };
-}
\ No newline at end of file
+}
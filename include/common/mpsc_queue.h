@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+namespace hw::common
+{
+
+/**
+ * @brief Bounded lock-free queue for multiple producers and a single consumer.
+ *
+ * Ring buffer of cells, each carrying a sequence number telling whether the cell is free for the producer of given position or filled for
+ * the consumer. Producers claim positions with compare-and-swap on the shared enqueue position, the consumer owns the dequeue position.
+ * No operation blocks or allocates, a full queue is reported to the producer.
+ *
+ * @tparam T Type of queued values
+ */
+template <class T>
+class mpsc_queue
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param capacity_ Maximum number of queued values, rounded up to power of two
+     */
+    explicit mpsc_queue(size_t capacity_)
+        : _mask(std::bit_ceil(std::max<size_t>(capacity_, 2)) - 1)
+        , _cells(std::make_unique<cell[]>(_mask + 1))
+    {
+        for (size_t i = 0; i <= _mask; i++)
+        {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    mpsc_queue(const mpsc_queue&) = delete;
+    mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+    /**
+     * @brief Push value, may be called from any thread
+     *
+     * @param value_ Value, moved from only if pushed
+     * @return true if the value was pushed, false if the queue is full
+     */
+    bool try_push(T& value_)
+    {
+        auto pos = _enqueue_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            auto& c   = _cells[pos & _mask];
+            auto seq  = c.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0)
+            {
+                if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    c.value.emplace(std::move(value_));
+                    c.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                // Cell still holds value not taken by the consumer
+                return false;
+            }
+            else
+            {
+                pos = _enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Pop value, must be called from the consumer thread only
+     *
+     * @return Value, std::nullopt if the queue is empty
+     */
+    std::optional<T> try_pop()
+    {
+        auto& c  = _cells[_dequeue_pos & _mask];
+        auto seq = c.sequence.load(std::memory_order_acquire);
+        if (seq != _dequeue_pos + 1)
+            return std::nullopt;
+
+        std::optional<T> value(std::move(c.value));
+        c.value.reset();
+        c.sequence.store(_dequeue_pos + _mask + 1, std::memory_order_release);
+        _dequeue_pos++;
+        _dequeued.store(_dequeue_pos, std::memory_order_relaxed);
+        return value;
+    }
+
+    //! Approximate number of queued values, may be called from any thread
+    size_t size() const
+    {
+        auto enqueued = _enqueue_pos.load(std::memory_order_relaxed);
+        auto dequeued = _dequeued.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    //! Maximum number of queued values
+    size_t capacity() const { return _mask + 1; }
+
+private:
+    struct cell
+    {
+        std::atomic<size_t> sequence;
+        std::optional<T> value;
+    };
+
+private:
+    const size_t _mask;
+    std::unique_ptr<cell[]> _cells;
+    alignas(64) std::atomic<size_t> _enqueue_pos{0}; // Shared by producers, on its own cache line
+    alignas(64) size_t _dequeue_pos{0};              // Owned by the consumer
+    std::atomic<size_t> _dequeued{0};                // Copy of dequeue position readable by other threads
+};
+}
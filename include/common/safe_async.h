@@ -4,6 +4,8 @@
 
 #include <boost/asio.hpp>
 
+#include <common/handler_allocator.h>
+
 namespace hw::common
 {
 
@@ -25,6 +27,9 @@ namespace hw::common
  * wrap_member_safe(...) template functions create handlers containing weak_pointer of the parent object. When such handler gets invoked from
  * io_context, member function is invoked only if the weak pointer to parent object can locked, i.e. the object still exists.
  *
+ * Handlers created by both functions allocate their Boost.Asio operations from @ref handler_memory of the object, so posting and
+ * completing asynchronous operations does not allocate from the heap in steady state.
+ *
  * @tparam AsyncClass Asynchronous class
  */
 template <class AsyncClass>
@@ -38,6 +43,7 @@ public:
      */
     safe_async(boost::asio::io_context& ioc_)
         : _strand(ioc_)
+        , _handler_memory(std::make_shared<handler_memory>())
     {}
 
     virtual ~safe_async() = default;
@@ -61,7 +67,7 @@ public:
             }
         };
 
-        boost::asio::post(_strand, std::bind(std::move(to_post), std::forward<Args>(args_)...));
+        boost::asio::post(_strand, allocating_handler(_handler_memory, std::bind(std::move(to_post), std::forward<Args>(args_)...)));
     }
 
     /**
@@ -73,16 +79,18 @@ public:
     template <class Func>
     auto wrap_member_safe(Func func_)
     {
-        return
+        return allocating_handler(
+            _handler_memory,
             [weak_this = std::weak_ptr<AsyncClass>(std::static_pointer_cast<AsyncClass>(this->shared_from_this())), func{std::move(func_)}](auto&&... args_) {
                 if (auto locked = weak_this.lock())
                 {
                     locked->post_member_safe(std::move(func), std::forward<decltype(args_)>(args_)...);
                 }
-            };
+            });
     }
 
 protected:
     boost::asio::io_context::strand _strand;
+    std::shared_ptr<handler_memory> _handler_memory;
 };
 }
\ No newline at end of file
@@ -19,6 +19,8 @@ public:
         unknown        = 2, ///< Unknown error cause
     };
 
+    static constexpr size_t error_types_count = 3; ///< Number of possible error causes
+
 public:
     error() = default;
 
@@ -38,8 +40,13 @@ public:
 public:
     error_type err_type{error_type::unknown}; ///< Error type
 
-private:
-    // Serialize error type to string
+public:
+    /**
+     * @brief Serialize error type to string
+     *
+     * @param error_ Error type
+     * @return Readable error type
+     */
     static std::string error_type_to_string(error_type error_)
     {
         if (error_ == error_type::disc_corrupted)
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <optional>
 #include <string>
 
 #include <common/types.h>
@@ -37,5 +39,6 @@ public:
 public:
     std::string device_name{};                    ///< Device name
     message_type msg_type{message_type::unknown}; ///< Message type
+    std::optional<int64_t> device_timestamp{};    ///< Time the message was created by device in nanoseconds since Unix epoch, optional
 };
 }
\ No newline at end of file
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <algorithm>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <vector>
+
+#include <common/types.h>
+#include <device_control_messages/messages.h>
+
+namespace hw::device_control_messages
+{
+
+/**
+ * Binary wire format of device control messages:
+ *
+ * | magic (1B) | version (1B) | message type (1B) | payload length (varint) | payload |
+ *
+ * Payload:
+ * - device name length (varint), device name bytes
+ * - measurement: number of temperature sensors (varint), values as little-endian uint16_t, number of fans (varint), values as uint8_t
+ * - error: error type (1B)
+ * - optional device timestamp (varint, nanoseconds since Unix epoch), present only if the payload continues after message specific fields
+ *
+ * Varints are encoded in LEB128, i.e. 7 bits per byte with the most significant bit set on all but the last byte.
+ */
+namespace binary_converter
+{
+constexpr common::byte_t magic   = 0xe7; ///< First byte of every binary message
+constexpr common::byte_t version = 0x01; ///< Version of the binary format
+
+constexpr size_t fixed_header_len = 3;  ///< Length of magic, version and message type
+constexpr size_t max_varint_len   = 10; ///< Maximum number of bytes of a varint encoded 64-bit value
+
+/**
+ * @brief Append varint encoded value to buffer
+ *
+ * @param value_ Value to encode
+ * @param buffer_ Output buffer
+ */
+inline void encode_varint(uint64_t value_, std::vector<common::byte_t>& buffer_)
+{
+    while (value_ >= 0x80)
+    {
+        buffer_.push_back(static_cast<common::byte_t>(value_ | 0x80));
+        value_ >>= 7;
+    }
+    buffer_.push_back(static_cast<common::byte_t>(value_));
+}
+
+/**
+ * @brief Get number of bytes needed to encode value as varint
+ *
+ * @param value_ Value to encode
+ * @return Encoded length
+ */
+inline size_t varint_len(uint64_t value_)
+{
+    size_t len = 1;
+    while (value_ >= 0x80)
+    {
+        value_ >>= 7;
+        len++;
+    }
+    return len;
+}
+
+/**
+ * @brief Decode varint value
+ *
+ * @param data_ Pointer to the first byte of varint
+ * @param len_ Number of bytes available
+ * @return Tuple: 1. decoded value, if the varint is complete and valid, 2. number of bytes the varint occupies.
+ */
+inline std::tuple<std::optional<uint64_t>, size_t> decode_varint(const common::byte_t* data_, size_t len_)
+{
+    uint64_t value{0};
+    for (size_t i = 0; i < len_ && i < max_varint_len; i++)
+    {
+        value |= static_cast<uint64_t>(data_[i] & 0x7f) << (7 * i);
+        if (!(data_[i] & 0x80))
+            return std::make_tuple(value, i + 1);
+    }
+    return std::make_tuple(std::nullopt, 0);
+}
+
+/**
+ * @brief Sequential reader of binary message payload
+ */
+class payload_reader
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param data_ Payload start
+     * @param len_ Payload length
+     */
+    payload_reader(const common::byte_t* data_, size_t len_)
+        : _data(data_)
+        , _len(len_)
+    {}
+
+    //! Read varint from payload
+    std::optional<uint64_t> read_varint()
+    {
+        auto [value, bytes] = decode_varint(_data + _pos, _len - _pos);
+        _pos += bytes;
+        return value;
+    }
+
+    //! Read one byte from payload
+    std::optional<common::byte_t> read_byte()
+    {
+        if (_pos >= _len)
+            return std::nullopt;
+        return _data[_pos++];
+    }
+
+    //! Read little-endian uint16_t from payload
+    std::optional<uint16_t> read_uint16()
+    {
+        if (_len - _pos < 2)
+            return std::nullopt;
+        uint16_t value = static_cast<uint16_t>(_data[_pos] | (_data[_pos + 1] << 8));
+        _pos += 2;
+        return value;
+    }
+
+    //! Read string of given length from payload
+    std::optional<std::string> read_string(size_t len_)
+    {
+        if (_len - _pos < len_)
+            return std::nullopt;
+        std::string str(reinterpret_cast<const char*>(_data + _pos), len_);
+        _pos += len_;
+        return str;
+    }
+
+    //! Number of bytes left in payload
+    size_t remaining() const { return _len - _pos; }
+
+private:
+    const common::byte_t* _data;
+    size_t _len;
+    size_t _pos{0};
+};
+
+/**
+ * @brief Get length of measurement specific payload
+ *
+ * @param measurement_ Input message
+ * @return Payload length in bytes
+ */
+inline size_t payload_len(const measurement& measurement_)
+{
+    return varint_len(measurement_.temperature_sensors.size()) + 2 * measurement_.temperature_sensors.size() + varint_len(measurement_.fans_speed.size())
+           + measurement_.fans_speed.size();
+}
+
+/**
+ * @brief Get length of error specific payload
+ *
+ * @return Payload length in bytes
+ */
+inline size_t payload_len(const error&)
+{
+    return 1;
+}
+
+/**
+ * @brief Append payload of measurement message to buffer
+ *
+ * @param measurement_ Input message
+ * @param buffer_ Output buffer
+ */
+inline void serialize_payload(const measurement& measurement_, std::vector<common::byte_t>& buffer_)
+{
+    encode_varint(measurement_.temperature_sensors.size(), buffer_);
+    for (auto temp : measurement_.temperature_sensors)
+    {
+        buffer_.push_back(static_cast<common::byte_t>(temp & 0xff));
+        buffer_.push_back(static_cast<common::byte_t>(temp >> 8));
+    }
+    encode_varint(measurement_.fans_speed.size(), buffer_);
+    buffer_.insert(buffer_.end(), measurement_.fans_speed.begin(), measurement_.fans_speed.end());
+}
+
+/**
+ * @brief Append payload of error message to buffer
+ *
+ * @param error_ Input message
+ * @param buffer_ Output buffer
+ */
+inline void serialize_payload(const error& error_, std::vector<common::byte_t>& buffer_)
+{
+    buffer_.push_back(static_cast<common::byte_t>(error_.err_type));
+}
+
+/**
+ * @brief Read measurement specific payload
+ *
+ * @param reader_ Payload reader positioned after device name
+ * @param measurement_ Output message
+ * @return true if payload is valid, false otherwise
+ */
+inline bool deserialize_payload(payload_reader& reader_, measurement& measurement_)
+{
+    auto temps_count = reader_.read_varint();
+    if (!temps_count || *temps_count > reader_.remaining() / 2)
+        return false;
+
+    measurement_.temperature_sensors.reserve(*temps_count);
+    for (uint64_t i = 0; i < *temps_count; i++)
+    {
+        measurement_.temperature_sensors.push_back(*reader_.read_uint16());
+    }
+
+    auto fans_count = reader_.read_varint();
+    if (!fans_count || *fans_count > reader_.remaining())
+        return false;
+
+    measurement_.fans_speed.reserve(*fans_count);
+    for (uint64_t i = 0; i < *fans_count; i++)
+    {
+        measurement_.fans_speed.push_back(*reader_.read_byte());
+    }
+    return true;
+}
+
+/**
+ * @brief Read error specific payload
+ *
+ * @param reader_ Payload reader positioned after device name
+ * @param error_ Output message
+ * @return true if payload is valid, false otherwise
+ */
+inline bool deserialize_payload(payload_reader& reader_, error& error_)
+{
+    auto err_type = reader_.read_byte();
+    if (!err_type || *err_type > static_cast<common::byte_t>(error::error_type::unknown))
+        return false;
+
+    error_.err_type = static_cast<error::error_type>(*err_type);
+    return true;
+}
+
+/**
+ * @brief Serialize device control message into binary format
+ *
+ * @tparam MessageType Type of message to serialize
+ * @param message_ Message to serialize
+ * @param buffer_ Output buffer, serialized message is appended to it
+ */
+template <class MessageType>
+void serialize_to_binary(const MessageType& message_, std::vector<common::byte_t>& buffer_)
+{
+    auto len = varint_len(message_.device_name.size()) + message_.device_name.size() + payload_len(message_);
+    if (message_.device_timestamp)
+        len += varint_len(static_cast<uint64_t>(*message_.device_timestamp));
+    buffer_.reserve(buffer_.size() + fixed_header_len + varint_len(len) + len);
+
+    buffer_.push_back(magic);
+    buffer_.push_back(version);
+    buffer_.push_back(static_cast<common::byte_t>(message_.msg_type));
+    encode_varint(len, buffer_);
+    encode_varint(message_.device_name.size(), buffer_);
+    buffer_.insert(buffer_.end(), message_.device_name.begin(), message_.device_name.end());
+    serialize_payload(message_, buffer_);
+    if (message_.device_timestamp)
+        encode_varint(static_cast<uint64_t>(*message_.device_timestamp), buffer_);
+}
+
+/**
+ * @brief Deserialize device control message from binary payload
+ *
+ * @tparam MessageType Type of message to deserialize
+ * @param msg_type_ Message type read from the fixed header
+ * @param payload_ Payload start
+ * @param len_ Payload length
+ * @return Message if the payload can be deserialized as MessageType type, std::nullopt otherwise.
+ */
+template <class MessageType>
+std::optional<MessageType> deserialize_from_binary(message_type msg_type_, const common::byte_t* payload_, size_t len_)
+{
+    payload_reader reader(payload_, len_);
+
+    auto name_len = reader.read_varint();
+    if (!name_len)
+        return std::nullopt;
+    auto name = reader.read_string(*name_len);
+    if (!name)
+        return std::nullopt;
+
+    MessageType message;
+    message.device_name = std::move(*name);
+    message.msg_type    = msg_type_;
+    if (!deserialize_payload(reader, message))
+        return std::nullopt;
+
+    if (reader.remaining() != 0)
+    {
+        auto device_timestamp = reader.read_varint();
+        if (!device_timestamp || reader.remaining() != 0)
+            return std::nullopt;
+        message.device_timestamp = static_cast<int64_t>(*device_timestamp);
+    }
+
+    return message;
+}
+} // namespace binary_converter
+
+/** @brief Serialer/Deserializer for device control messages to compact binary format (and vice versa) */
+class binary_serializer
+{
+public:
+    /**
+     * @brief Serialize any device control message to byte vector
+     *
+     * @param message_ Input message
+     * @return Input message serialized to bytes
+     */
+    static std::vector<common::byte_t> serialize(const device_message_type& message_)
+    {
+        std::vector<common::byte_t> buffer;
+        serialize(message_, buffer);
+        return buffer;
+    }
+
+    /**
+     * @brief Serialize any device control message and append it to buffer
+     *
+     * @param message_ Input message
+     * @param buffer_ Output buffer
+     */
+    static void serialize(const device_message_type& message_, std::vector<common::byte_t>& buffer_)
+    {
+        std::visit([&buffer_](const auto& msg_) { binary_converter::serialize_to_binary(msg_, buffer_); }, message_);
+    }
+
+    /**
+     * @brief Deserialize device control message from the beginning of provided data
+     *
+     * @param data_ Data to deserialize from
+     * @return Tuple: 1. message, if it can be deserialized from the provied data, 2. number of bytes consumed from the input data. If no
+     * bytes are consumed, more data is needed. If bytes are consumed but no message is returned, the consumed bytes were malformed.
+     */
+    static std::tuple<std::optional<device_message_type>, size_t> deserialize(std::span<const common::byte_t> data_)
+    {
+        if (data_.empty())
+            return std::make_tuple(std::nullopt, 0);
+        if (data_[0] != binary_converter::magic)
+        {
+            // Skip garbage up to the next possible message start
+            auto next_magic = std::find(data_.begin(), data_.end(), binary_converter::magic);
+            return std::make_tuple(std::nullopt, static_cast<size_t>(next_magic - data_.begin()));
+        }
+        if (data_.size() < binary_converter::fixed_header_len)
+            return std::make_tuple(std::nullopt, 0);
+        if (data_[1] != binary_converter::version)
+            return std::make_tuple(std::nullopt, 1);
+
+        auto [payload_len, varint_len] =
+            binary_converter::decode_varint(data_.data() + binary_converter::fixed_header_len, data_.size() - binary_converter::fixed_header_len);
+        if (!payload_len)
+        {
+            if (data_.size() - binary_converter::fixed_header_len >= binary_converter::max_varint_len)
+                return std::make_tuple(std::nullopt, 1);
+            return std::make_tuple(std::nullopt, 0);
+        }
+
+        auto header_len = binary_converter::fixed_header_len + varint_len;
+        if (data_.size() - header_len < *payload_len)
+            return std::make_tuple(std::nullopt, 0);
+
+        auto payload   = data_.data() + header_len;
+        auto frame_len = header_len + *payload_len;
+        auto msg_type  = static_cast<message_type>(data_[2]);
+
+        if (msg_type == message_type::error)
+            return std::make_tuple(binary_converter::deserialize_from_binary<device_control_messages::error>(msg_type, payload, *payload_len), frame_len);
+        else if (msg_type == message_type::measurement)
+            return std::make_tuple(binary_converter::deserialize_from_binary<device_control_messages::measurement>(msg_type, payload, *payload_len),
+                                   frame_len);
+        else
+            return std::make_tuple(std::nullopt, frame_len);
+    }
+};
+}
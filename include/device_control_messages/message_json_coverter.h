@@ -1,6 +1,6 @@
 #pragma once
 
-#include <sstream>
+#include <span>
 #include <tuple>
 
 #include <nlohmann/json.hpp>
@@ -53,11 +53,36 @@ namespace keys
 {
 constexpr char device_name[]         = "device_name";
 constexpr char message_type[]        = "message_type";
+constexpr char device_timestamp[]    = "device_timestamp";
 constexpr char temperature_sensors[] = "temperature_sensors";
 constexpr char fans_speed[]          = "fans_speed";
 constexpr char err_type[]            = "err_type";
 }
 
+/**
+ * @brief Convert optional header fields to JSON, fields without value are omitted
+ *
+ * @param json_ Output JSON object
+ * @param header_ Input message header
+ */
+inline void optional_header_to_json(nlohmann::json& json_, const header& header_)
+{
+    if (header_.device_timestamp)
+        json_[keys::device_timestamp] = *header_.device_timestamp;
+}
+
+/**
+ * @brief Read optional header fields from JSON
+ *
+ * @param json_ Input JSON object
+ * @param header_ Output message header
+ */
+inline void optional_header_from_json(const nlohmann::json& json_, header& header_)
+{
+    if (json_.contains(keys::device_timestamp))
+        header_.device_timestamp = json_.at(keys::device_timestamp).get<int64_t>();
+}
+
 NLOHMANN_JSON_SERIALIZE_ENUM(device_control_messages::message_type,
                              {
                                  {device_control_messages::message_type::measurement, "measurement"},
@@ -74,6 +99,7 @@ inline void to_json(nlohmann::json& json_, const measurement& measurement_)
 {
     json_[keys::device_name]         = measurement_.device_name;
     json_[keys::message_type]        = measurement_.msg_type;
+    optional_header_to_json(json_, measurement_);
     json_[keys::temperature_sensors] = nlohmann::json::array();
     for (auto temp : measurement_.temperature_sensors)
     {
@@ -98,6 +124,7 @@ inline void from_json(const nlohmann::json& json_, measurement& measurement_)
     json_.at(keys::message_type).get_to(measurement_.msg_type);
     json_.at(keys::temperature_sensors).get_to(measurement_.temperature_sensors);
     json_.at(keys::fans_speed).get_to(measurement_.fans_speed);
+    optional_header_from_json(json_, measurement_);
 }
 
 NLOHMANN_JSON_SERIALIZE_ENUM(error::error_type,
@@ -118,6 +145,7 @@ inline void to_json(nlohmann::json& json_, const error& error_)
     json_[keys::device_name]  = error_.device_name;
     json_[keys::message_type] = error_.msg_type;
     json_[keys::err_type]     = error_.err_type;
+    optional_header_to_json(json_, error_);
 }
 
 /**
@@ -131,9 +159,104 @@ inline void from_json(const nlohmann::json& json_, error& error_)
     json_.at(keys::device_name).get_to(error_.device_name);
     json_.at(keys::message_type).get_to(error_.msg_type);
     json_.at(keys::err_type).get_to(error_.err_type);
+    optional_header_from_json(json_, error_);
 }
 
-/** @brief Serialer/Deserializer for device control messages to JSON (and vice versa) */
+/**
+ * @brief Incremental framer finding boundaries of JSON objects in a byte stream.
+ *
+ * Every byte is scanned only once: when a call does not find the end of an object, the scanning state is kept and the next call continues
+ * where the previous one stopped. Because of that, consecutive calls must be given data starting at the same byte until a complete frame is
+ * reported. Once a frame is reported, the caller is expected to drop it and the framer starts over from the beginning of the provided data.
+ */
+class json_framer
+{
+public:
+    /** @brief Result of the framing */
+    enum class status
+    {
+        incomplete, ///< End of the object was not found yet
+        complete,   ///< Complete object was found
+        invalid,    ///< Data does not start with JSON object
+    };
+
+public:
+    /**
+     * @brief Find next JSON object in data
+     *
+     * @param data_ Data starting with JSON object, optionally preceded by whitespace
+     * @return Tuple: 1. framing status, 2. length of the complete object or of the invalid prefix, 0 when the object is incomplete.
+     */
+    std::tuple<status, size_t> next(std::span<const common::byte_t> data_)
+    {
+        for (; _scanned < data_.size(); _scanned++)
+        {
+            auto byte = data_[_scanned];
+
+            if (_depth == 0)
+            {
+                if (is_whitespace(byte))
+                    continue;
+                if (byte != '{')
+                {
+                    auto invalid_len = _scanned + 1;
+                    reset();
+                    return std::make_tuple(status::invalid, invalid_len);
+                }
+                _depth = 1;
+                continue;
+            }
+
+            if (_in_string)
+            {
+                if (_escape)
+                    _escape = false;
+                else if (byte == '\\')
+                    _escape = true;
+                else if (byte == '"')
+                    _in_string = false;
+                continue;
+            }
+
+            if (byte == '"')
+                _in_string = true;
+            else if (byte == '{' || byte == '[')
+                _depth++;
+            else if ((byte == '}' || byte == ']') && --_depth == 0)
+            {
+                auto frame_len = _scanned + 1;
+                reset();
+                return std::make_tuple(status::complete, frame_len);
+            }
+        }
+        return std::make_tuple(status::incomplete, 0);
+    }
+
+    /** @brief Forget scanning state, next call starts at the beginning of the provided data */
+    void reset()
+    {
+        _scanned   = 0;
+        _depth     = 0;
+        _in_string = false;
+        _escape    = false;
+    }
+
+private:
+    // Check whether byte is JSON whitespace
+    static bool is_whitespace(common::byte_t byte_) { return byte_ == ' ' || byte_ == '\t' || byte_ == '\n' || byte_ == '\r'; }
+
+private:
+    size_t _scanned{0};
+    size_t _depth{0};
+    bool _in_string{false};
+    bool _escape{false};
+};
+
+/**
+ * @brief Serialer/Deserializer for device control messages to JSON (and vice versa)
+ *
+ * Deserialization keeps framing state between calls, see @ref json_framer. Each connection therefore needs its own instance.
+ */
 class json_serializer
 {
 public:
@@ -145,54 +268,54 @@ public:
      */
     static std::vector<common::byte_t> serialize(const device_message_type& message_)
     {
-        auto serializing_visitor = [](auto msg_) {
-            auto str_json = json_converter::serialize_to_json(msg_).dump();
-            std::vector<common::byte_t> buffer(str_json.size());
-            std::copy(str_json.begin(), str_json.end(), buffer.begin());
-            return buffer;
-        };
-
-        return std::visit(serializing_visitor, message_);
+        std::vector<common::byte_t> buffer;
+        serialize(message_, buffer);
+        return buffer;
+    }
+
+    /**
+     * @brief Serialize any device control message and append it to buffer
+     *
+     * @param message_ Input message
+     * @param buffer_ Output buffer
+     */
+    static void serialize(const device_message_type& message_, std::vector<common::byte_t>& buffer_)
+    {
+        auto str_json = std::visit([](const auto& msg_) { return json_converter::serialize_to_json(msg_).dump(); }, message_);
+        buffer_.insert(buffer_.end(), str_json.begin(), str_json.end());
     }
 
     /**
-     * @brief Deserialize byte vector to device control message
+     * @brief Deserialize device control message from the beginning of provided data
      *
      * @param data_ Data to deserialize from
-     * @return Tuple: 1. message, if it can be deserialized from the provied data, 2. number of bytes consumed from the input vector.
+     * @return Tuple: 1. message, if it can be deserialized from the provied data, 2. number of bytes consumed from the input data. If no
+     * bytes are consumed, more data is needed. If bytes are consumed but no message is returned, the consumed bytes were malformed.
      */
-    static std::tuple<std::optional<device_message_type>, size_t> deserialize(const std::vector<common::byte_t>& data_)
+    std::tuple<std::optional<device_message_type>, size_t> deserialize(std::span<const common::byte_t> data_)
     {
-        try
-        {
-            // NOTE: In nlohmann::json library, incremental json parsing can be achieved only if input data is provided in std::istream.
-            // Therefore, if the application allows sending multiple json messages via one connection, data must be copied into input
-            // stream first.
-            std::stringstream ss;
-            for (auto byte : data_)
-            {
-                ss << byte;
-            }
+        auto [status, frame_len] = _framer.next(data_);
+        if (status != json_framer::status::complete)
+            return std::make_tuple(std::nullopt, frame_len);
 
-            nlohmann::json json;
-            ss >> json;
-            std::string rest;
-            ss >> rest;
+        auto json = nlohmann::json::parse(data_.begin(), data_.begin() + frame_len, nullptr, false);
+        if (json.is_discarded())
+            return std::make_tuple(std::nullopt, frame_len);
 
-            message_type msg_type;
-            json[keys::message_type].get_to(msg_type);
+        auto msg_type_iter = json.find(keys::message_type);
+        if (msg_type_iter == json.end() || !msg_type_iter->is_string())
+            return std::make_tuple(std::nullopt, frame_len);
 
-            if (msg_type == message_type::error)
-                return std::make_tuple(json_converter::deserialize_from_json<device_control_messages::error>(json), data_.size() - rest.size());
-            else if (msg_type == message_type::measurement)
-                return std::make_tuple(json_converter::deserialize_from_json<device_control_messages::measurement>(json), data_.size() - rest.size());
-            else
-                return std::make_tuple(std::nullopt, 0);
-        }
-        catch (const nlohmann::json::exception& e_)
-        {
-            return std::make_tuple(std::nullopt, 0);
-        }
+        auto msg_type = msg_type_iter->get<message_type>();
+        if (msg_type == message_type::error)
+            return std::make_tuple(json_converter::deserialize_from_json<device_control_messages::error>(json), frame_len);
+        else if (msg_type == message_type::measurement)
+            return std::make_tuple(json_converter::deserialize_from_json<device_control_messages::measurement>(json), frame_len);
+        else
+            return std::make_tuple(std::nullopt, frame_len);
     }
+
+private:
+    json_framer _framer;
 };
 }
@@ -1,22 +1,136 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
 
 #include <device_control_messages/messages.h>
+#include <metrics/metrics.h>
+#include <storage/column_aggregate.h>
+#include <storage/device_history.h>
+#include <storage/device_statistics.h>
+#include <storage/message_log.h>
+#include <storage/message_view.h>
+#include <storage/retention_policy.h>
+#include <storage/rollup_tiers.h>
+#include <storage/statistics_snapshot.h>
+#include <storage/streaming_aggregates.h>
+#include <storage/types.h>
 
 namespace hw
 {
 
+/** @brief What is kept about received messages */
+enum class storage_mode
+{
+    full,        ///< Messages are stored and counted
+    counts_only, ///< Messages are counted only, message bodies are dropped
+};
+
+/** @brief Configuration of @ref device_messages_storage */
+struct storage_config
+{
+    storage_mode mode{storage_mode::full};          ///< Storage mode
+    size_t shards_count{16};                        ///< Number of independently locked shards devices are distributed to
+    size_t block_capacity{1024};                    ///< Number of measurements stored in one columnar block
+    bool compress_blocks{true};                     ///< Seal full blocks of measurements into compressed blocks
+    storage::retention_policy retention{};          ///< Limits of stored history of each device
+    storage::aggregation_config aggregation{};      ///< Windows of per-sensor summaries maintained at ingest
+    storage::rollup_config rollups{};               ///< Downsampling tiers of measurements maintained at ingest
+    std::chrono::milliseconds snapshot_interval{0}; ///< Interval of publishing statistics snapshots, 0 publishes on request only
+};
+
+/** @brief Message together with time of its reception */
+struct received_message
+{
+    storage::timestamp_t timestamp;                       ///< Time of reception
+    device_control_messages::device_message_type message; ///< Message
+};
+
 /**
  * @brief Class storing device control messages and providing methods for accessing them.
+ *
+ * Numbers of received messages are maintained when messages are stored, so statistics can be read without touching the stored messages.
+ *
+ * Devices are distributed to shards by hash of device name. Each shard has its own reader-writer lock, so messages from different devices
+ * can be stored concurrently and queries take shared locks only.
+ *
+ * Optionally, received messages are persisted to append-only @ref storage::message_log, see @ref enable_persistence.
+ *
+ * Message counters of all devices are periodically published as immutable @ref storage::statistics_snapshot. Reporters read the latest
+ * snapshot by @ref get_statistics_snapshot without taking any storage lock, so they do not contend with storing of messages.
  */
 class device_messages_storage
 {
 public:
-    device_messages_storage() = default;
+    /**
+     * @brief Constructor
+     *
+     * @param config_ Storage configuration
+     */
+    device_messages_storage(const storage_config& config_ = {})
+        : _mode(config_.mode)
+        , _block_capacity(std::max<size_t>(config_.block_capacity, 1))
+        , _compress_blocks(config_.compress_blocks)
+        , _retention(config_.retention)
+        , _aggregation(config_.aggregation)
+        , _rollups(config_.rollups)
+        , _shards(std::max<size_t>(config_.shards_count, 1))
+        , _snapshot_interval(config_.snapshot_interval)
+        , _snapshot(std::make_shared<const storage::statistics_snapshot>())
+        , _stored_messages(metrics::default_registry().add_counter("hw_storage_messages_total", "Messages stored"))
+        , _stored_bytes(metrics::default_registry().add_gauge("hw_storage_stored_bytes", "Memory occupied by stored messages and aggregates in bytes"))
+    {
+        if (_snapshot_interval.count() > 0)
+            _snapshot_publisher = std::thread([this] { snapshot_publisher_loop(); });
+    }
+
+    /** @brief Destructor, persists all stored messages when persistence is enabled */
+    ~device_messages_storage()
+    {
+        if (_snapshot_publisher.joinable())
+        {
+            {
+                std::lock_guard lock(_snapshot_mtx);
+                _snapshot_stop = true;
+            }
+            _snapshot_cv.notify_one();
+            _snapshot_publisher.join();
+        }
+        if (_log)
+            _log->close();
+
+        for (auto& shard : _shards)
+        {
+            for (const auto& [name, record] : shard.devices)
+            {
+                _stored_bytes.add(-static_cast<int64_t>(record.memory_size()));
+            }
+        }
+    }
+
+    /**
+     * @brief Recover state persisted in log directory and persist all new messages there.
+     * Message counters and stored history are restored from the last checkpoint and only messages received after the checkpoint are replayed
+     * from the log, so recovery does not depend on the length of stored history. Aggregates and rollups are rebuilt from restored history.
+     * Must be called before any message is stored.
+     *
+     * @param config_ Log configuration
+     * @return true on success, false if the log cannot be read or written
+     */
+    bool enable_persistence(const storage::message_log_config& config_);
 
     /**
      * @brief Store new message
@@ -25,20 +139,35 @@ public:
      */
     void new_message(device_control_messages::device_message_type message_)
     {
-        std::scoped_lock lock(_internal_access_mtx);
-        new_message_impl(std::move(message_));
+        auto timestamp = storage::now();
+        auto& shard    = shard_for(std::visit([](const auto& msg_) -> const std::string& { return msg_.device_name; }, message_));
+        std::unique_lock lock(shard.mtx);
+        new_message_impl(shard, timestamp, message_);
+        _stored_messages.add();
+        // Appending under the shard lock keeps the log order consistent with checkpointed state
+        if (_log)
+            _log->append(timestamp, message_);
     }
 
+    /**
+     * @brief Store batch of messages received earlier.
+     * Messages are grouped by shard and each shard is locked once for the whole batch, messages of one device are stored in batch order.
+     *
+     * @param messages_ messages with times of their reception
+     */
+    void new_messages(std::span<const received_message> messages_);
+
     /**
      * @brief Get messages from given device
      *
      * @param device_name_ device to get messages from
-     * @return vector of device messages
+     * @return vector of device messages, empty in @ref storage_mode::counts_only mode
      */
     std::vector<device_control_messages::device_message_type> get_device_messages(const std::string& device_name_)
     {
-        std::scoped_lock lock(_internal_access_mtx);
-        return get_device_messages_impl(device_name_);
+        auto& shard = shard_for(device_name_);
+        std::shared_lock lock(shard.mtx);
+        return get_device_messages_impl(shard, device_name_);
     }
 
     /**
@@ -46,13 +175,313 @@ public:
      *
      * @tparam ReuqestedMessageType Type of messages to retrieve
      * @param device_name_ device to get messages from
-     * @return vector of @ref RequestMessagesType messages
+     * @return vector of @ref RequestMessagesType messages, empty in @ref storage_mode::counts_only mode
      */
     template <class ReuqestedMessageType>
     std::vector<ReuqestedMessageType> get_device_messages_of_type(const std::string& device_name_)
     {
-        std::scoped_lock lock(_internal_access_mtx);
-        return get_device_messages_of_type_impl<ReuqestedMessageType>(device_name_);
+        auto& shard = shard_for(device_name_);
+        std::shared_lock lock(shard.mtx);
+        return get_device_messages_of_type_impl<ReuqestedMessageType>(shard, device_name_);
+    }
+
+    /**
+     * @brief Visit messages received from given device in order of reception without copying them.
+     * Visitor runs under shared lock of the shard the device belongs to, so it must not call the storage and views passed to it must not
+     * outlive the call. Storing messages of devices in the same shard waits until the visit finishes.
+     *
+     * @tparam Visitor Callable accepting both `const storage::measurement_view&` and `const storage::error_view&`
+     * @param device_name_ device to visit messages of
+     * @param visitor_ visitor, not called in @ref storage_mode::counts_only mode
+     */
+    template <class Visitor>
+    void for_each_message(const std::string& device_name_, Visitor&& visitor_)
+    {
+        auto& shard = shard_for(device_name_);
+        std::shared_lock lock(shard.mtx);
+        auto iter = shard.devices.find(device_name_);
+        if (iter != shard.devices.end())
+            iter->second.history.for_each_message(iter->first, visitor_);
+    }
+
+    /**
+     * @brief Visit messages received from given device in time range without copying them.
+     * The same rules as for @ref for_each_message apply.
+     *
+     * @tparam Visitor Callable accepting both `const storage::measurement_view&` and `const storage::error_view&`
+     * @param device_name_ device to visit messages of
+     * @param from_ start of the range (reception time), inclusive
+     * @param to_ end of the range (reception time), exclusive
+     * @param visitor_ visitor
+     */
+    template <class Visitor>
+    void for_each_message_between(const std::string& device_name_, storage::timestamp_t from_, storage::timestamp_t to_, Visitor&& visitor_)
+    {
+        auto& shard = shard_for(device_name_);
+        std::shared_lock lock(shard.mtx);
+        auto iter = shard.devices.find(device_name_);
+        if (iter != shard.devices.end())
+            iter->second.history.for_each_message_between(iter->first, from_, to_, visitor_);
+    }
+
+    /**
+     * @brief Get messages received from given device in time range
+     *
+     * @param device_name_ device to get messages from
+     * @param from_ start of the range (reception time), inclusive
+     * @param to_ end of the range (reception time), exclusive
+     * @return vector of device messages, empty in @ref storage_mode::counts_only mode
+     */
+    std::vector<device_control_messages::device_message_type> get_device_messages_between(const std::string& device_name_,
+                                                                                          storage::timestamp_t from_,
+                                                                                          storage::timestamp_t to_)
+    {
+        std::vector<device_control_messages::device_message_type> result;
+        for_each_message_between(device_name_, from_, to_, [&result](const auto& view_) { result.emplace_back(view_.to_message()); });
+        return result;
+    }
+
+    /**
+     * @brief Count stored messages received from given device in time range
+     *
+     * @param device_name_ device to count messages of
+     * @param from_ start of the range (reception time), inclusive
+     * @param to_ end of the range (reception time), exclusive
+     * @return number of stored messages, 0 in @ref storage_mode::counts_only mode
+     */
+    size_t count_device_messages_between(const std::string& device_name_, storage::timestamp_t from_, storage::timestamp_t to_)
+    {
+        auto& shard = shard_for(device_name_);
+        std::shared_lock lock(shard.mtx);
+        auto iter = shard.devices.find(device_name_);
+        return iter != shard.devices.end() ? iter->second.history.count_between(from_, to_) : 0;
+    }
+
+    /**
+     * @brief Visit messages of provided type received from given device without copying them.
+     * The same rules as for @ref for_each_message apply.
+     *
+     * @tparam ReuqestedMessageType Type of messages to visit
+     * @tparam Visitor Callable accepting `const storage::measurement_view&` or `const storage::error_view&` according to message type
+     * @param device_name_ device to visit messages of
+     * @param visitor_ visitor
+     */
+    template <class ReuqestedMessageType, class Visitor>
+    void for_each_message_of_type(const std::string& device_name_, Visitor&& visitor_)
+    {
+        auto& shard = shard_for(device_name_);
+        std::shared_lock lock(shard.mtx);
+        auto iter = shard.devices.find(device_name_);
+        if (iter == shard.devices.end())
+            return;
+
+        if constexpr (std::is_same_v<ReuqestedMessageType, device_control_messages::error>)
+            iter->second.history.for_each_error(iter->first, visitor_);
+        else
+            iter->second.history.for_each_measurement(iter->first, visitor_);
+    }
+
+    /**
+     * @brief Get number of messages of provided type received from given device
+     *
+     * @tparam ReuqestedMessageType Type of messages to count
+     * @param device_name_ device to count messages of
+     * @return number of messages
+     */
+    template <class ReuqestedMessageType>
+    size_t get_device_messages_count(const std::string& device_name_)
+    {
+        return get_device_statistics(device_name_).template count<ReuqestedMessageType>();
+    }
+
+    /**
+     * @brief Get numbers of messages received from given device
+     *
+     * @param device_name_ device to get statistics of
+     * @return message counters
+     */
+    storage::device_statistics get_device_statistics(const std::string& device_name_)
+    {
+        auto& shard = shard_for(device_name_);
+        std::shared_lock lock(shard.mtx);
+        return get_device_statistics_impl(shard, device_name_);
+    }
+
+    /**
+     * @brief Get the latest published snapshot of message counters of all devices. Takes no storage lock.
+     *
+     * @return snapshot, empty until the first one is published
+     */
+    std::shared_ptr<const storage::statistics_snapshot> get_statistics_snapshot() const { return _snapshot.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Take snapshot of message counters of all devices and publish it to readers of @ref get_statistics_snapshot.
+     * Called periodically when @ref storage_config::snapshot_interval is set. Each shard is locked shared once.
+     */
+    void publish_statistics_snapshot();
+
+    /**
+     * @brief Aggregate stored values of temperature sensor of given device
+     *
+     * @param device_name_ device to aggregate values of
+     * @param sensor_ index of temperature sensor
+     * @return aggregate over whole stored history, values signaling sensor error are counted separately
+     */
+    storage::column_aggregate get_temperature_aggregate(const std::string& device_name_, size_t sensor_)
+    {
+        auto& shard = shard_for(device_name_);
+        std::shared_lock lock(shard.mtx);
+        auto iter = shard.devices.find(device_name_);
+        return iter != shard.devices.end() ? iter->second.history.aggregate_temperature(sensor_) : storage::column_aggregate{};
+    }
+
+    /**
+     * @brief Aggregate stored speeds of fan of given device
+     *
+     * @param device_name_ device to aggregate values of
+     * @param fan_ index of fan
+     * @return aggregate over whole stored history, values signaling fan error are counted separately
+     */
+    storage::column_aggregate get_fan_speed_aggregate(const std::string& device_name_, size_t fan_)
+    {
+        auto& shard = shard_for(device_name_);
+        std::shared_lock lock(shard.mtx);
+        auto iter = shard.devices.find(device_name_);
+        return iter != shard.devices.end() ? iter->second.history.aggregate_fan_speed(fan_) : storage::column_aggregate{};
+    }
+
+    /**
+     * @brief Count stored values of temperature sensor of given device above threshold
+     *
+     * @param device_name_ device to count values of
+     * @param sensor_ index of temperature sensor
+     * @param threshold_ threshold
+     * @return number of valid values greater than threshold in whole stored history
+     */
+    size_t count_temperature_above(const std::string& device_name_, size_t sensor_, uint16_t threshold_)
+    {
+        auto& shard = shard_for(device_name_);
+        std::shared_lock lock(shard.mtx);
+        auto iter = shard.devices.find(device_name_);
+        return iter != shard.devices.end() ? iter->second.history.count_temperature_above(sensor_, threshold_) : 0;
+    }
+
+    /**
+     * @brief Count stored speeds of fan of given device above threshold
+     *
+     * @param device_name_ device to count values of
+     * @param fan_ index of fan
+     * @param threshold_ threshold
+     * @return number of valid values greater than threshold in whole stored history
+     */
+    size_t count_fan_speed_above(const std::string& device_name_, size_t fan_, uint8_t threshold_)
+    {
+        auto& shard = shard_for(device_name_);
+        std::shared_lock lock(shard.mtx);
+        auto iter = shard.devices.find(device_name_);
+        return iter != shard.devices.end() ? iter->second.history.count_fan_speed_above(fan_, threshold_) : 0;
+    }
+
+    /**
+     * @brief Get summary of temperature sensor of given device maintained at ingest.
+     * Cost of the query depends on number of kept aggregation windows only, not on the length of stored history.
+     *
+     * @param device_name_ device to get summary of
+     * @param sensor_ index of temperature sensor
+     * @param range_ summarized time range ending now, 0 for all kept windows. Rounded to whole windows.
+     * @return summary including percentiles, values signaling sensor error are counted separately
+     */
+    storage::temperature_summary get_temperature_summary(const std::string& device_name_, size_t sensor_, std::chrono::seconds range_ = {})
+    {
+        auto since  = summary_since(range_);
+        auto& shard = shard_for(device_name_);
+        std::shared_lock lock(shard.mtx);
+        auto iter = shard.devices.find(device_name_);
+        return iter != shard.devices.end() ? iter->second.aggregates.temperature(sensor_, since) : storage::temperature_summary{};
+    }
+
+    /**
+     * @brief Get summary of fan speeds of given device maintained at ingest.
+     * Cost of the query depends on number of kept aggregation windows only, not on the length of stored history.
+     *
+     * @param device_name_ device to get summary of
+     * @param fan_ index of fan
+     * @param range_ summarized time range ending now, 0 for all kept windows. Rounded to whole windows.
+     * @return summary including percentiles, values signaling fan error are counted separately
+     */
+    storage::fan_speed_summary get_fan_speed_summary(const std::string& device_name_, size_t fan_, std::chrono::seconds range_ = {})
+    {
+        auto since  = summary_since(range_);
+        auto& shard = shard_for(device_name_);
+        std::shared_lock lock(shard.mtx);
+        auto iter = shard.devices.find(device_name_);
+        return iter != shard.devices.end() ? iter->second.aggregates.fan_speed(fan_, since) : storage::fan_speed_summary{};
+    }
+
+    /**
+     * @brief Get downsampled values of temperature sensor of given device.
+     * Values are taken from the coarsest rollup tier satisfying requested range and resolution, see @ref storage::rollup_tiers.
+     *
+     * @param device_name_ device to get values of
+     * @param sensor_ index of temperature sensor
+     * @param from_ start of the range (reception time), inclusive
+     * @param to_ end of the range (reception time), exclusive
+     * @param resolution_ requested length of time buckets
+     * @return series of min/max/avg/count per time bucket
+     */
+    storage::rollup_series get_temperature_rollup(const std::string& device_name_,
+                                                  size_t sensor_,
+                                                  storage::timestamp_t from_,
+                                                  storage::timestamp_t to_,
+                                                  std::chrono::seconds resolution_)
+    {
+        auto& shard = shard_for(device_name_);
+        std::shared_lock lock(shard.mtx);
+        auto iter = shard.devices.find(device_name_);
+        return iter != shard.devices.end() ? iter->second.rollups.temperature(sensor_, from_, to_, resolution_) : storage::rollup_series{};
+    }
+
+    /**
+     * @brief Get downsampled speeds of fan of given device.
+     * Values are taken from the coarsest rollup tier satisfying requested range and resolution, see @ref storage::rollup_tiers.
+     *
+     * @param device_name_ device to get values of
+     * @param fan_ index of fan
+     * @param from_ start of the range (reception time), inclusive
+     * @param to_ end of the range (reception time), exclusive
+     * @param resolution_ requested length of time buckets
+     * @return series of min/max/avg/count per time bucket
+     */
+    storage::rollup_series get_fan_speed_rollup(const std::string& device_name_,
+                                                size_t fan_,
+                                                storage::timestamp_t from_,
+                                                storage::timestamp_t to_,
+                                                std::chrono::seconds resolution_)
+    {
+        auto& shard = shard_for(device_name_);
+        std::shared_lock lock(shard.mtx);
+        auto iter = shard.devices.find(device_name_);
+        return iter != shard.devices.end() ? iter->second.rollups.fan_speed(fan_, from_, to_, resolution_) : storage::rollup_series{};
+    }
+
+    /**
+     * @brief Evict stored messages exceeding retention limits of all devices.
+     * Limits are enforced whenever a message is stored, this method additionally evicts messages of devices which stopped reporting.
+     */
+    void apply_retention()
+    {
+        auto timestamp = storage::now();
+        for (auto& shard : _shards)
+        {
+            std::unique_lock lock(shard.mtx);
+            for (auto& [name, record] : shard.devices)
+            {
+                auto memory_size = record.memory_size();
+                record.history.enforce_retention(timestamp);
+                record.rollups.enforce_retention(timestamp);
+                _stored_bytes.add(static_cast<int64_t>(record.memory_size()) - static_cast<int64_t>(memory_size));
+            }
+        }
     }
 
     /**
@@ -62,45 +491,125 @@ public:
      */
     std::vector<std::string> get_devices()
     {
-        std::scoped_lock lock(_internal_access_mtx);
-        return get_devices_impl();
+        std::vector<std::string> devices;
+        for (auto& shard : _shards)
+        {
+            std::shared_lock lock(shard.mtx);
+            get_devices_impl(shard, devices);
+        }
+        return devices;
     }
 
 private:
+    // Messages and counters of one device
+    struct device_record
+    {
+        device_record(size_t block_capacity_,
+                      const storage::retention_policy& retention_,
+                      const storage::aggregation_config& aggregation_,
+                      const storage::rollup_config& rollups_,
+                      std::pmr::memory_resource* resource_,
+                      bool compress_blocks_)
+            : history(block_capacity_, retention_, resource_, compress_blocks_)
+            , aggregates(aggregation_)
+            , rollups(rollups_)
+        {}
+
+        // Memory occupied by stored messages, aggregates and rollups
+        size_t memory_size() const { return history.memory_size() + aggregates.memory_size() + rollups.memory_size(); }
+
+        storage::device_history history;
+        storage::device_statistics statistics;
+        storage::streaming_aggregates aggregates;
+        storage::rollup_tiers rollups;
+    };
+
+    // Independently locked part of the storage. Aligned to cache line to avoid false sharing of locks.
+    struct alignas(64) shard
+    {
+        std::shared_mutex mtx;
+        // Stored messages of devices of the shard are allocated from this pool, it is used under exclusive lock only. Declared before
+        // devices, so it outlives them. Blocks of default capacity fit into pooled chunks.
+        std::pmr::unsynchronized_pool_resource pool{std::pmr::pool_options{0, 1 << 20}};
+        std::unordered_map<std::string, device_record> devices;
+    };
+
+private:
+    // Start of summarized time range
+    static storage::timestamp_t summary_since(std::chrono::seconds range_)
+    {
+        return range_.count() ? storage::now() - std::chrono::duration_cast<std::chrono::nanoseconds>(range_).count()
+                              : std::numeric_limits<storage::timestamp_t>::min();
+    }
+
+    // Get record of device, create it if it does not exist yet. Shard must be locked exclusively.
+    device_record& record_for(shard& shard_, const std::string& device_)
+    {
+        return shard_.devices.try_emplace(device_, _block_capacity, _retention, _aggregation, _rollups, &shard_.pool, _compress_blocks).first->second;
+    }
+
+    // Get shard device belongs to
+    shard& shard_for(const std::string& device_) { return _shards[std::hash<std::string>{}(device_) % _shards.size()]; }
+
     // Thread-unsafe implementation of new_message(...) public method
-    void new_message_impl(const device_control_messages::device_message_type& message_);
+    void new_message_impl(shard& shard_, storage::timestamp_t timestamp_, const device_control_messages::device_message_type& message_);
+
+    // Get index of shard device of message belongs to
+    size_t shard_index(const device_control_messages::device_message_type& message_)
+    {
+        const auto& name = std::visit([](const auto& msg_) -> const std::string& { return msg_.device_name; }, message_);
+        return std::hash<std::string>{}(name) % _shards.size();
+    }
 
     // Thread-unsafe implementation of get_device_messages(...) public method
-    std::vector<device_control_messages::device_message_type> get_device_messages_impl(const std::string& device_);
+    std::vector<device_control_messages::device_message_type> get_device_messages_impl(shard& shard_, const std::string& device_);
 
     // Thread-unsafe implementation of get_device_messages_of_type_impl<...>(...) public method
     template <class ReuqestedMessageType>
-    std::vector<ReuqestedMessageType> get_device_messages_of_type_impl(const std::string& name_)
+    std::vector<ReuqestedMessageType> get_device_messages_of_type_impl(shard& shard_, const std::string& name_)
     {
-        auto messages = get_device_messages_impl(name_);
         std::vector<ReuqestedMessageType> result;
-        for (const auto& msg : messages)
-        {
-            try
-            {
-                result.push_back(std::get<ReuqestedMessageType>(msg));
-            }
-            catch (const std::bad_variant_access&)
-            {
-                // Message of different type
-            }
-        }
+        auto iter = shard_.devices.find(name_);
+        if (iter == shard_.devices.end())
+            return result;
+
+        iter->second.history.messages(name_, result);
         return result;
     }
 
-    // Thread-unsafe implementation of get_devices_impl(...) public method
-    std::vector<std::string> get_devices_impl();
+    // Thread-unsafe implementation of get_device_statistics(...) public method
+    storage::device_statistics get_device_statistics_impl(shard& shard_, const std::string& device_);
+
+    // Thread-unsafe implementation of get_devices_impl(...) public method, appends devices of one shard
+    void get_devices_impl(shard& shard_, std::vector<std::string>& devices_);
+
+    // Capture counters and stored history of all devices together with log position they are valid at
+    storage::log_checkpoint make_checkpoint();
+
+    // Main loop of thread publishing statistics snapshots
+    void snapshot_publisher_loop();
 
     // Method for logging purposes
     const std::string me() { return "[device_messages_storage] "; }
 
 private:
-    std::unordered_map<std::string, std::vector<device_control_messages::device_message_type>> _messages_received;
-    std::mutex _internal_access_mtx;
+    const storage_mode _mode;
+    const size_t _block_capacity;
+    const bool _compress_blocks;
+    const storage::retention_policy _retention;
+    const storage::aggregation_config _aggregation;
+    const storage::rollup_config _rollups;
+    std::vector<shard> _shards;
+    std::unique_ptr<storage::message_log> _log;
+
+    const std::chrono::milliseconds _snapshot_interval;
+    std::atomic<std::shared_ptr<const storage::statistics_snapshot>> _snapshot;
+    std::mutex _snapshot_mtx;
+    std::condition_variable _snapshot_cv;
+    bool _snapshot_stop{false};
+    std::thread _snapshot_publisher;
+
+    metrics::counter& _stored_messages; //!< Ingest rate, messages replayed from log are not counted
+    metrics::gauge& _stored_bytes;      //!< Memory occupied by messages kept in history and by aggregates
 };
-}
\ No newline at end of file
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include <common/mpsc_queue.h>
+#include <device_messages_storage.h>
+
+namespace hw
+{
+
+/** @brief What happens to a message pushed to a full @ref ingest_queue */
+enum class ingest_overflow
+{
+    block, ///< Producer waits until the consumer makes space
+    drop,  ///< Message is dropped and counted
+};
+
+/** @brief Configuration of @ref ingest_queue */
+struct ingest_config
+{
+    size_t capacity{65536};                           ///< Maximum number of queued messages, rounded up to power of two
+    size_t max_batch{1024};                           ///< Maximum number of messages stored under one acquisition of shard locks
+    ingest_overflow overflow{ingest_overflow::block}; ///< Behaviour when the queue is full
+};
+
+/** @brief Counters of @ref ingest_queue */
+struct ingest_statistics
+{
+    size_t depth{0};          ///< Number of queued messages
+    size_t enqueued{0};       ///< Number of messages pushed to the queue
+    size_t applied{0};        ///< Number of messages stored to the storage
+    size_t dropped{0};        ///< Number of messages dropped because the queue was full
+    size_t producer_waits{0}; ///< Number of pushes which had to wait for space in the queue
+    size_t batches{0};        ///< Number of batches stored to the storage
+};
+
+/**
+ * @brief Queue decoupling receiving of messages from storing them.
+ *
+ * Network handlers push received messages to bounded lock-free @ref common::mpsc_queue, so they never wait on storage locks. Dedicated
+ * consumer thread drains the queue in batches and stores each batch by @ref device_messages_storage::new_messages, locking each shard once
+ * per batch. Reception time is taken when the message is pushed, not when it is stored.
+ *
+ * When the queue is full, the producer either waits for space or drops the message, see @ref ingest_overflow.
+ */
+class ingest_queue
+{
+public:
+    /**
+     * @brief Constructor, starts the consumer thread
+     *
+     * @param storage_ Storage messages are stored to, must outlive the queue
+     * @param config_ Queue configuration
+     */
+    ingest_queue(device_messages_storage& storage_, const ingest_config& config_ = {});
+
+    /** @brief Destructor, stores all queued messages and stops the consumer thread. No message may be pushed during destruction. */
+    ~ingest_queue();
+
+    ingest_queue(const ingest_queue&) = delete;
+    ingest_queue& operator=(const ingest_queue&) = delete;
+
+    /**
+     * @brief Push received message, may be called from any thread
+     *
+     * @param message_ message
+     * @return false if the message was dropped because the queue is full
+     */
+    bool push(device_control_messages::device_message_type message_);
+
+    /** @brief Wait until all messages pushed before the call are stored or dropped */
+    void flush();
+
+    /**
+     * @brief Get queue counters
+     *
+     * @return counters
+     */
+    ingest_statistics statistics() const;
+
+private:
+    // Consumer thread loop
+    void run();
+    // Pop up to max_batch messages
+    void pop_batch(std::vector<received_message>& batch_);
+    // Wake the consumer if it sleeps
+    void wake_consumer();
+
+private:
+    device_messages_storage& _storage;
+    const size_t _max_batch;
+    const ingest_overflow _overflow;
+    common::mpsc_queue<received_message> _queue;
+
+    std::atomic<bool> _stopping{false};
+    std::atomic<bool> _consumer_sleeping{false};
+    std::atomic<uint32_t> _wakeups{0};
+
+    std::atomic<size_t> _enqueued{0};
+    std::atomic<size_t> _applied{0};
+    std::atomic<size_t> _dropped{0};
+    std::atomic<size_t> _producer_waits{0};
+    std::atomic<size_t> _batches{0};
+
+    std::thread _consumer;
+};
+}
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace hw::metrics
+{
+
+//! Number of per-thread shards of one metric, threads beyond this number share shards
+inline constexpr size_t shards_count = 16;
+
+/**
+ * @brief Get shard of calling thread.
+ * Threads get shards round-robin on their first update of any metric, so threads updating the same metric write to different cache lines.
+ *
+ * @return Shard index
+ */
+inline size_t shard_index()
+{
+    static std::atomic<size_t> next{0};
+    thread_local const size_t index = next.fetch_add(1, std::memory_order_relaxed) % shards_count;
+    return index;
+}
+
+/**
+ * @brief Monotonic counter.
+ * Every thread adds to its own shard with one uncontended relaxed atomic addition, reading sums the shards.
+ */
+class counter
+{
+public:
+    /**
+     * @brief Increase counter
+     *
+     * @param value_ Increment
+     */
+    void add(uint64_t value_ = 1) { _shards[shard_index()].value.fetch_add(value_, std::memory_order_relaxed); }
+
+    //! Current value
+    uint64_t value() const
+    {
+        uint64_t sum{0};
+        for (const auto& shard : _shards)
+        {
+            sum += shard.value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+private:
+    struct alignas(64) shard
+    {
+        std::atomic<uint64_t> value{0};
+    };
+
+    std::array<shard, shards_count> _shards;
+};
+
+/**
+ * @brief Gauge of value going up and down, e.g. number of open connections.
+ * Updated by increments like @ref counter, a shard may go negative when increments and decrements come from different threads.
+ */
+class gauge
+{
+public:
+    /**
+     * @brief Change gauge
+     *
+     * @param value_ Increment, negative to decrease
+     */
+    void add(int64_t value_) { _shards[shard_index()].value.fetch_add(value_, std::memory_order_relaxed); }
+
+    //! Current value
+    int64_t value() const
+    {
+        int64_t sum{0};
+        for (const auto& shard : _shards)
+        {
+            sum += shard.value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+private:
+    struct alignas(64) shard
+    {
+        std::atomic<int64_t> value{0};
+    };
+
+    std::array<shard, shards_count> _shards;
+};
+
+/**
+ * @brief Histogram of observed values with fixed bucket bounds.
+ * Every thread counts into its own shard of buckets, reading sums the shards.
+ */
+class histogram
+{
+public:
+    /** @brief Counts of histogram read at one moment */
+    struct snapshot
+    {
+        std::vector<uint64_t> buckets; ///< Cumulative count of values less or equal to each bound, last item counts all values
+        double sum{0};                 ///< Sum of all observed values
+    };
+
+    /**
+     * @brief Constructor
+     *
+     * @param bounds_ Ascending upper bounds of buckets, bucket of values above the last bound is added implicitly
+     */
+    explicit histogram(std::vector<double> bounds_);
+
+    /**
+     * @brief Record value
+     *
+     * @param value_ Observed value
+     */
+    void observe(double value_);
+
+    //! Upper bounds of buckets
+    const std::vector<double>& bounds() const { return _bounds; }
+
+    //! Read current counts
+    snapshot read() const;
+
+private:
+    struct alignas(64) shard
+    {
+        std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+        std::atomic<double> sum{0};
+    };
+
+    const std::vector<double> _bounds;
+    std::array<shard, shards_count> _shards;
+};
+
+//! Type of metric in Prometheus exposition format
+enum class metric_type
+{
+    counter,
+    gauge,
+    histogram
+};
+
+/**
+ * @brief Set of named metrics rendered in Prometheus text exposition format.
+ *
+ * Metrics are created on first request for their name and labels and live as long as the registry, further requests for the same name and
+ * labels return the same metric, so all instances of a component update shared metrics. Metrics are updated without touching the registry,
+ * its mutex only protects creation and rendering.
+ *
+ * Metric names follow Prometheus conventions, labels are passed preformatted, e.g. `transport="tcp"`.
+ *
+ * Registering a name with another type, or name and labels with another kind of metric, is a programming error reported by
+ * std::invalid_argument, metrics already handed out are never replaced.
+ */
+class registry
+{
+public:
+    /**
+     * @brief Get or create counter
+     *
+     * @param name_ Metric name
+     * @param help_ Description
+     * @param labels_ Labels, empty for metric without labels
+     * @return Counter
+     */
+    counter& add_counter(const std::string& name_, const std::string& help_, const std::string& labels_ = {});
+
+    /**
+     * @brief Get or create gauge
+     *
+     * @param name_ Metric name
+     * @param help_ Description
+     * @param labels_ Labels, empty for metric without labels
+     * @return Gauge
+     */
+    gauge& add_gauge(const std::string& name_, const std::string& help_, const std::string& labels_ = {});
+
+    /**
+     * @brief Get or create histogram
+     *
+     * @param name_ Metric name
+     * @param help_ Description
+     * @param bounds_ Ascending upper bounds of buckets, used only when the histogram is created
+     * @param labels_ Labels, empty for metric without labels
+     * @return Histogram
+     */
+    histogram& add_histogram(const std::string& name_, const std::string& help_, std::vector<double> bounds_, const std::string& labels_ = {});
+
+    /**
+     * @brief Add metric whose value is read by callback when rendered, e.g. statistics kept by a component anyway.
+     * Callback of already registered name and labels is replaced, a counter, gauge or histogram of them is not.
+     *
+     * @param name_ Metric name
+     * @param help_ Description
+     * @param type_ Counter or gauge
+     * @param read_ Callback returning current value, invoked from rendering thread
+     * @param labels_ Labels, empty for metric without labels
+     */
+    void add_callback(const std::string& name_, const std::string& help_, metric_type type_, std::function<double()> read_, const std::string& labels_ = {});
+
+    /**
+     * @brief Remove metric read by callback, e.g. when the component owning the value is destroyed
+     *
+     * @param name_ Metric name
+     * @param labels_ Labels
+     */
+    void remove_callback(const std::string& name_, const std::string& labels_ = {});
+
+    /**
+     * @brief Render all metrics in Prometheus text exposition format
+     *
+     * @param os_ Output stream
+     */
+    void write(std::ostream& os_) const;
+
+private:
+    using value_t = std::variant<std::unique_ptr<counter>, std::unique_ptr<gauge>, std::unique_ptr<histogram>, std::function<double()>>;
+
+    struct series
+    {
+        std::string labels;
+        value_t value;
+    };
+
+    struct family
+    {
+        std::string name;
+        std::string help;
+        metric_type type;
+        std::vector<series> entries;
+    };
+
+    // Find series or create empty one, must be called with mutex held
+    series& find_series(const std::string& name_, const std::string& help_, metric_type type_, const std::string& labels_);
+
+    // Get metric of series or create it in empty series
+    template <typename Metric, typename... Args>
+    Metric& get_or_create(const std::string& name_, const std::string& help_, metric_type type_, const std::string& labels_, Args&&... args_);
+
+    // Whether series was just created by find_series and holds no metric yet
+    static bool empty(const series& entry_);
+
+    mutable std::mutex _mtx;
+    std::vector<std::unique_ptr<family>> _families;
+};
+
+/**
+ * @brief Get process-wide registry used by instrumented components and exposed by the device monitor
+ *
+ * @return Registry
+ */
+registry& default_registry();
+}
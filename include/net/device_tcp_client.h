@@ -1,5 +1,6 @@
 #pragma once
 
+#include <type_traits>
 #include <vector>
 
 #include <boost/asio.hpp>
@@ -20,19 +21,22 @@ namespace hw::net
  * Providing interface for transferring device control messages over TCP.
  *
  * @tparam MessageSerializer Type of message serializer/deserializer
+ * @tparam Protocol Boost.Asio stream protocol, TCP or local (AF_UNIX) stream protocol
  */
-template <class MessageSerializer>
-class device_tcp_client : public common::safe_async<device_tcp_client<MessageSerializer>>
+template <class MessageSerializer, class Protocol = boost::asio::ip::tcp>
+class device_tcp_client : public common::safe_async<device_tcp_client<MessageSerializer, Protocol>>
 {
 public:
     /**
      * @brief Constructor
      *
      * @param ioc_ Boost.Asio io_context
+     * @param config_ Tuning parameters of the connection
      */
-    device_tcp_client(boost::asio::io_context& ioc_)
-        : common::safe_async<device_tcp_client<MessageSerializer>>(ioc_)
+    device_tcp_client(boost::asio::io_context& ioc_, const connection_config& config_ = {})
+        : common::safe_async<device_tcp_client<MessageSerializer, Protocol>>(ioc_)
         , _sock(ioc_)
+        , _config(config_)
     {}
 
     /**
@@ -42,8 +46,20 @@ public:
      * @param tcp_port_ TCP port of the center
      */
     void connect(const ip_address_t& ip_address_, port_t tcp_port_)
+        requires std::is_same_v<Protocol, boost::asio::ip::tcp>
+    {
+        this->post_member_safe(&device_tcp_client::connect_ip_impl, std::move(ip_address_), tcp_port_);
+    }
+
+    /**
+     * @brief Connect to device monitoring center listening on Unix domain socket
+     *
+     * @param socket_path_ Path of the socket
+     */
+    void connect(const std::string& socket_path_)
+        requires std::is_same_v<Protocol, boost::asio::local::stream_protocol>
     {
-        this->post_member_safe(&device_tcp_client::connect_impl, std::move(ip_address_), tcp_port_);
+        this->post_member_safe(&device_tcp_client::connect_path_impl, std::move(socket_path_));
     }
 
     /**
@@ -77,7 +93,7 @@ private:
     }
 
     // Connect internal implementation - must be invoked from within strand context
-    void connect_impl(const ip_address_t& ip_address_, port_t tcp_port_)
+    void connect_ip_impl(const ip_address_t& ip_address_, port_t tcp_port_)
     {
         if (_connected)
         {
@@ -95,8 +111,37 @@ private:
             return;
         }
 
-        boost::asio::ip::tcp::endpoint ep(ip, tcp_port_);
-        _sock.async_connect(ep, this->wrap_member_safe(&device_tcp_client<MessageSerializer>::handle_connected));
+        connect_endpoint(boost::asio::ip::tcp::endpoint(ip, tcp_port_));
+    }
+
+    // Connect internal implementation - must be invoked from within strand context
+    void connect_path_impl(const std::string& socket_path_)
+    {
+        if (_connected)
+        {
+            std::cerr << me() << "Connect refused. REASON(already connected)" << std::endl;
+            return;
+        }
+
+        typename Protocol::endpoint ep;
+        try
+        {
+            ep = typename Protocol::endpoint(socket_path_);
+        }
+        catch (const boost::system::system_error& e)
+        {
+            std::cerr << me() << "Error forming socket path. EC(" << e.code() << ")" << std::endl;
+            on_error();
+            return;
+        }
+
+        connect_endpoint(ep);
+    }
+
+    // Start connecting to endpoint
+    void connect_endpoint(const typename Protocol::endpoint& ep_)
+    {
+        _sock.async_connect(ep_, this->wrap_member_safe(&device_tcp_client::handle_connected));
     }
 
     // Handler called when TCP connection is established
@@ -110,10 +155,10 @@ private:
             return;
         }
 
-        _connection             = std::make_shared<device_tcp_connection<MessageSerializer>>(this->_strand.context(), std::move(_sock));
-        _connection->on_message = this->wrap_member_safe(&device_tcp_client<MessageSerializer>::handle_conn_message);
-        _connection->on_close   = this->wrap_member_safe(&device_tcp_client<MessageSerializer>::handle_conn_close);
-        _connection->on_error   = this->wrap_member_safe(&device_tcp_client<MessageSerializer>::handle_conn_error);
+        _connection             = std::make_shared<device_tcp_connection<MessageSerializer, Protocol>>(this->_strand.context(), std::move(_sock), _config);
+        _connection->on_message = this->wrap_member_safe(&device_tcp_client::handle_conn_message);
+        _connection->on_close   = this->wrap_member_safe(&device_tcp_client::handle_conn_close);
+        _connection->on_error   = this->wrap_member_safe(&device_tcp_client::handle_conn_error);
 
         on_connect();
     }
@@ -127,10 +172,13 @@ private:
     std::string me() const { return "[device_tcp_client] "; }
 
 private:
-    boost::asio::ip::tcp::socket _sock;
-    std::shared_ptr<device_tcp_connection<MessageSerializer>> _connection;
-    std::vector<hw::common::byte_t> _recv_buffer;
-    std::vector<hw::common::byte_t> _unprocessed_recv_data;
+    typename Protocol::socket _sock;
+    const connection_config _config;
+    std::shared_ptr<device_tcp_connection<MessageSerializer, Protocol>> _connection;
     bool _connected{false};
 };
-}
\ No newline at end of file
+
+//! Client connecting to device monitoring center over Unix domain socket
+template <class MessageSerializer>
+using device_unix_client = device_tcp_client<MessageSerializer, boost::asio::local::stream_protocol>;
+}
@@ -10,6 +10,9 @@
 #include <common/safe_async.h>
 #include <common/types.h>
 #include <device_control_messages/messages.h>
+#include <net/receive_buffer.h>
+#include <net/transport_metrics.h>
+#include <net/types.h>
 
 namespace hw::net
 {
@@ -17,25 +20,38 @@ namespace hw::net
  * @brief Class transferring device control messages over TCP connection
  *
  * @tparam MessageSerializer Type of message serializer/deserializer
+ * @tparam Protocol Boost.Asio stream protocol, TCP or local (AF_UNIX) stream protocol
  */
-template <class MessageSerializer>
-class device_tcp_connection : public common::safe_async<device_tcp_connection<MessageSerializer>>
+template <class MessageSerializer, class Protocol = boost::asio::ip::tcp>
+class device_tcp_connection : public common::safe_async<device_tcp_connection<MessageSerializer, Protocol>>
 {
 public:
     /**
      * @brief Constructor
      *
-     * @param sock_ Connected TCP socket
+     * @param ioc_ Boost.Asio io_context
+     * @param sock_ Connected socket
+     * @param config_ Connection tuning parameters
      */
-    device_tcp_connection(boost::asio::io_context& ioc_, boost::asio::ip::tcp::socket sock_)
-        : common::safe_async<device_tcp_connection<MessageSerializer>>(ioc_)
+    device_tcp_connection(boost::asio::io_context& ioc_, typename Protocol::socket sock_, const connection_config& config_ = {})
+        : common::safe_async<device_tcp_connection<MessageSerializer, Protocol>>(ioc_)
         , _sock(std::move(sock_))
-        , _recv_buffer(recv_buffer_len)
+        , _recv_buffer(config_.initial_recv_buffer_len, config_.max_recv_buffer_len)
+        , _config(config_)
         , _connection_id(generate_id())
-    {}
+        , _metrics(stream_transport_metrics<Protocol>())
+    {
+        _metrics.connections_open.add(1);
+    }
+
+    ~device_tcp_connection()
+    {
+        _metrics.connections_open.add(-1);
+        _metrics.send_queue_depth.add(-static_cast<int64_t>(_messages_to_send.size()));
+    }
 
     /** @brief Start receiving messages */
-    void start_receive() { this->post_member_safe(&device_tcp_connection<MessageSerializer>::start_receive_impl); }
+    void start_receive() { this->post_member_safe(&device_tcp_connection<MessageSerializer, Protocol>::start_receive_impl); }
 
     /**
      * @brief Send device control message
@@ -44,7 +60,7 @@ public:
      */
     void send(device_control_messages::device_message_type message_)
     {
-        this->post_member_safe(&device_tcp_connection<MessageSerializer>::send_impl, std::move(message_));
+        this->post_member_safe(&device_tcp_connection<MessageSerializer, Protocol>::send_impl, std::move(message_));
     }
 
     /**
@@ -62,20 +78,32 @@ public:
     //! Callback triggered when connection is closed. Callback type: connection ID.
     common::handler_holder<void(size_t)> on_close;
 
-private:
-    // Data is read in buffers of this size
-    static constexpr size_t recv_buffer_len = 1024;
-
 private:
     // Start receive internal implementation - must be invoked from within strand context
-    void start_receive_impl() { _sock.async_receive(boost::asio::buffer(_recv_buffer), this->wrap_member_safe(&device_tcp_connection::handle_receive)); }
+    void start_receive_impl() { receive_next(); }
+
+    // Receive next data directly into receive buffer
+    void receive_next()
+    {
+        auto buffer = _recv_buffer.prepare();
+        if (buffer.empty())
+        {
+            std::cerr << me() << "Receive buffer full, message too long. LENGTH(" << _recv_buffer.size() << ")" << std::endl;
+            on_error(_connection_id);
+            return;
+        }
+
+        _sock.async_receive(boost::asio::buffer(buffer.data(), buffer.size()),
+                            this->wrap_member_safe(&device_tcp_connection<MessageSerializer, Protocol>::handle_receive));
+    }
 
     // Send internal implementaiton - must be invoked from within strand context
     void send_impl(device_control_messages::device_message_type message_)
     {
         _messages_to_send.push_back(std::move(message_));
-        if (_messages_to_send.size() == 1)
-            send_next_message();
+        _metrics.send_queue_depth.add(1);
+        if (!_sending)
+            send_next_batch();
     }
 
     // Handler called when data is received on socket
@@ -96,35 +124,65 @@ private:
             return;
         }
 
-        std::copy(_recv_buffer.begin(), _recv_buffer.begin() + bytes_read_, std::back_inserter(_unprocessed_recv_data));
-        auto [message, bytes_read] = MessageSerializer::deserialize(_unprocessed_recv_data);
-        while (message)
+        _recv_buffer.commit(bytes_read_);
+        _metrics.received_bytes.add(bytes_read_);
+        _metrics.receive_bytes.observe(static_cast<double>(bytes_read_));
+
+        auto [message, bytes_read] = _serializer.deserialize(_recv_buffer.data());
+        while (bytes_read != 0)
         {
-            assert(bytes_read != 0);
-            on_message(std::move(*message));
-            _unprocessed_recv_data.erase(_unprocessed_recv_data.begin(), _unprocessed_recv_data.begin() + bytes_read);
+            if (message)
+            {
+                _metrics.received_messages.add();
+                on_message(std::move(*message));
+            }
+            else
+            {
+                _metrics.parse_failures.add();
+                std::cerr << me() << "Dropping malformed data. LENGTH(" << bytes_read << ")" << std::endl;
+            }
+            _recv_buffer.consume(bytes_read);
 
-            std::tie(message, bytes_read) = MessageSerializer::deserialize(_unprocessed_recv_data);
+            std::tie(message, bytes_read) = _serializer.deserialize(_recv_buffer.data());
         }
 
-        _sock.async_receive(boost::asio::buffer(_recv_buffer), this->wrap_member_safe(&device_tcp_connection<MessageSerializer>::handle_receive));
+        receive_next();
     }
 
-    // Send next message in queue
-    void send_next_message()
+    // Send queued messages in one gather write, limited by batch size configuration. At least one message is sent even if limits are zero.
+    void send_next_batch()
     {
-        _sending_buffer = MessageSerializer::serialize(_messages_to_send.front());
-        boost::asio::async_write(
-            _sock, boost::asio::buffer(_sending_buffer), this->wrap_member_safe(&device_tcp_connection<MessageSerializer>::handle_message_sent));
+        _sending_sequence.clear();
+        size_t batch_bytes{0};
 
-        _messages_to_send.pop_front();
+        while (!_messages_to_send.empty()
+               && (_sending_sequence.empty() || (_sending_sequence.size() < _config.max_batch_messages && batch_bytes < _config.max_batch_bytes)))
+        {
+            if (_sending_buffers.size() == _sending_sequence.size())
+                _sending_buffers.emplace_back();
+
+            auto& buffer = _sending_buffers[_sending_sequence.size()];
+            buffer.clear();
+            MessageSerializer::serialize(_messages_to_send.front(), buffer);
+            _messages_to_send.pop_front();
+
+            batch_bytes += buffer.size();
+            _sending_sequence.push_back(boost::asio::buffer(buffer));
+        }
+        _metrics.send_queue_depth.add(-static_cast<int64_t>(_sending_sequence.size()));
+
+        _sending = true;
+        boost::asio::async_write(_sock, _sending_sequence, this->wrap_member_safe(&device_tcp_connection<MessageSerializer, Protocol>::handle_message_sent));
     }
 
     // Handler called when data is sent to socket
-    void handle_message_sent(boost::system::error_code ec_, size_t)
+    void handle_message_sent(boost::system::error_code ec_, size_t bytes_sent_)
     {
         if (ec_)
         {
+            // Connection stays marked as sending, so messages sent later are only queued and no write is started on the broken socket
+            _sending_sequence.clear();
+            _sending_buffers.clear();
             if (ec_ != boost::asio::error::operation_aborted)
             {
                 std::cerr << me() << "Error sending message. EC(" << ec_ << ")" << std::endl;
@@ -133,8 +191,12 @@ private:
             return;
         }
 
+        _metrics.sent_bytes.add(bytes_sent_);
+        _metrics.sent_messages.add(_sending_sequence.size());
+
+        _sending = false;
         if (!_messages_to_send.empty())
-            send_next_message();
+            send_next_batch();
     }
 
     // Generate unique connection ID
@@ -147,11 +209,15 @@ private:
     std::string me() const { return std::string{"[device_tcp_connection/"} + std::to_string(_connection_id) + std::string{"] "}; }
 
 private:
-    boost::asio::ip::tcp::socket _sock;
+    typename Protocol::socket _sock;
     std::deque<device_control_messages::device_message_type> _messages_to_send;
-    std::vector<hw::common::byte_t> _sending_buffer;
-    std::vector<common::byte_t> _recv_buffer;
-    std::vector<common::byte_t> _unprocessed_recv_data;
+    std::vector<std::vector<common::byte_t>> _sending_buffers;
+    std::vector<boost::asio::const_buffer> _sending_sequence;
+    bool _sending{false};
+    receive_buffer _recv_buffer;
+    const connection_config _config;
+    MessageSerializer _serializer;
     const size_t _connection_id;
+    transport_metrics& _metrics;
 };
 }
\ No newline at end of file
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <filesystem>
+#include <type_traits>
+
 #include <boost/asio.hpp>
 
 #include <common/handler_holder.h>
@@ -7,6 +10,8 @@
 #include <common/types.h>
 #include <device_control_messages/messages.h>
 #include <net/device_tcp_connection.h>
+#include <net/io_context_pool.h>
+#include <net/transport_metrics.h>
 #include <net/types.h>
 
 namespace hw::net
@@ -15,21 +20,48 @@ namespace hw::net
 /**
  * @brief TCP server listening for connection from devices
  *
+ * By default accepted connections run on the io_context of the server and deliver received messages through the server strand, so
+ * @ref on_message is never invoked concurrently. When constructed with an @ref io_context_pool, accepted connections are spread over the
+ * io_contexts of the pool round-robin and every connection invokes @ref on_message directly from its own io_context. Messages are then
+ * delivered from all threads of the pool concurrently without passing through the server strand, the callback must be thread-safe. Each
+ * connection takes a copy of the callback when it is accepted, so @ref on_message must be set before listening.
+ *
+ * With local stream protocol the server listens on a Unix domain socket path instead of IP address and TCP port, which avoids TCP
+ * loopback overhead for devices running on the same host.
+ *
  * @tparam MessageSerializer Type of message serializer/deserializer
+ * @tparam Protocol Boost.Asio stream protocol, TCP or local (AF_UNIX) stream protocol
  */
-template <class MessageSerializer>
-class device_tcp_server : public common::safe_async<device_tcp_server<MessageSerializer>>
+template <class MessageSerializer, class Protocol = boost::asio::ip::tcp>
+class device_tcp_server : public common::safe_async<device_tcp_server<MessageSerializer, Protocol>>
 {
 public:
     /**
      * @brief Constructor
      *
      * @param ioc_ Boost.Asio io_context
+     * @param config_ Tuning parameters of accepted connections
      */
-    device_tcp_server(boost::asio::io_context& ioc_)
-        : common::safe_async<device_tcp_server<MessageSerializer>>(ioc_)
+    device_tcp_server(boost::asio::io_context& ioc_, const connection_config& config_ = {})
+        : common::safe_async<device_tcp_server<MessageSerializer, Protocol>>(ioc_)
         , _acceptor(ioc_)
         , _sock(ioc_)
+        , _config(config_)
+    {}
+
+    /**
+     * @brief Constructor of server distributing connections over io_context pool
+     *
+     * @param ioc_ Boost.Asio io_context of the acceptor
+     * @param pool_ Pool of io_contexts accepted connections run on, must outlive the server
+     * @param config_ Tuning parameters of accepted connections
+     */
+    device_tcp_server(boost::asio::io_context& ioc_, io_context_pool& pool_, const connection_config& config_ = {})
+        : common::safe_async<device_tcp_server<MessageSerializer, Protocol>>(ioc_)
+        , _acceptor(ioc_)
+        , _sock(ioc_)
+        , _config(config_)
+        , _pool(&pool_)
     {}
 
     /**
@@ -39,8 +71,21 @@ public:
      * @param tcp_port_ TCP port to listen on
      */
     void listen(const ip_address_t& ip_address_, port_t tcp_port_)
+        requires std::is_same_v<Protocol, boost::asio::ip::tcp>
+    {
+        this->post_member_safe(&device_tcp_server::listen_ip_impl, std::move(ip_address_), tcp_port_);
+    }
+
+    /**
+     * @brief Start listening on Unix domain socket. Stale socket left at the path by previous server is removed, @ref on_error is
+     * triggered if another server still accepts connections on the path.
+     *
+     * @param socket_path_ Path of the socket
+     */
+    void listen(const std::string& socket_path_)
+        requires std::is_same_v<Protocol, boost::asio::local::stream_protocol>
     {
-        this->post_member_safe(&device_tcp_server<MessageSerializer>::listen_impl, std::move(ip_address_), tcp_port_);
+        this->post_member_safe(&device_tcp_server::listen_path_impl, std::move(socket_path_));
     }
 
 public:
@@ -51,7 +96,7 @@ public:
 
 private:
     // Listen internal implementation - must be invoked from within strand context
-    void listen_impl(const ip_address_t& ip_address_, port_t tcp_port_)
+    void listen_ip_impl(const ip_address_t& ip_address_, port_t tcp_port_)
     {
         if (_acceptor.is_open())
             return;
@@ -66,16 +111,63 @@ private:
             return;
         }
 
-        boost::asio::ip::tcp::endpoint ep(ip, tcp_port_);
+        listen_endpoint(boost::asio::ip::tcp::endpoint(ip, tcp_port_));
+    }
+
+    // Listen internal implementation - must be invoked from within strand context
+    void listen_path_impl(const std::string& socket_path_)
+    {
+        if (_acceptor.is_open())
+            return;
+
+        typename Protocol::endpoint ep;
+        try
+        {
+            ep = typename Protocol::endpoint(socket_path_);
+        }
+        catch (const boost::system::system_error& e)
+        {
+            std::cerr << me() << "Error forming socket path. EC(" << e.code() << ")" << std::endl;
+            on_error();
+            return;
+        }
+
+        std::error_code fs_ec;
+        if (std::filesystem::is_socket(socket_path_, fs_ec))
+        {
+            // Socket file is stale only if nobody listens on it, connection of the probe is refused then
+            typename Protocol::socket probe(this->_strand.context());
+            boost::system::error_code ec;
+            probe.open(ep.protocol(), ec);
+            if (!ec)
+                probe.non_blocking(true, ec);
+            if (!ec)
+                probe.connect(ep, ec);
+            if (ec != boost::asio::error::connection_refused)
+            {
+                std::cerr << me() << "Socket path in use. EC(" << boost::system::error_code(boost::asio::error::address_in_use) << ")" << std::endl;
+                on_error();
+                return;
+            }
+            std::filesystem::remove(socket_path_, fs_ec);
+        }
 
-        _acceptor.open(ep.protocol(), ec);
+        listen_endpoint(ep);
+    }
+
+    // Open, bind and start accepting on endpoint
+    void listen_endpoint(const typename Protocol::endpoint& ep_)
+    {
+        boost::system::error_code ec;
+        _acceptor.open(ep_.protocol(), ec);
         if (ec)
         {
             std::cerr << me() << "Error opening acceptor. EC(" << ec << ")" << std::endl;
             on_error();
         }
 
-        _acceptor.set_option(boost::asio::socket_base::reuse_address(true), ec);
+        if constexpr (std::is_same_v<Protocol, boost::asio::ip::tcp>)
+            _acceptor.set_option(boost::asio::socket_base::reuse_address(true), ec);
         if (ec)
         {
             std::cerr << me() << "Error seting acceptor options. EC(" << ec << ")" << std::endl;
@@ -83,7 +175,7 @@ private:
             return;
         }
 
-        _acceptor.bind(ep, ec);
+        _acceptor.bind(ep_, ec);
         if (ec)
         {
             std::cerr << me() << "Error binding acceptor. EC(" << ec << ")" << std::endl;
@@ -99,7 +191,15 @@ private:
             return;
         }
 
-        _acceptor.async_accept(_sock, this->wrap_member_safe(&device_tcp_server<MessageSerializer>::handle_accept));
+        accept_next();
+    }
+
+    // Accept next connection into socket bound to io_context the connection will run on
+    void accept_next()
+    {
+        _sock_context = _pool ? &_pool->get_io_context() : &this->_strand.context();
+        _sock         = typename Protocol::socket(*_sock_context);
+        _acceptor.async_accept(_sock, this->wrap_member_safe(&device_tcp_server::handle_accept));
     }
 
     // Handler called when new TCP connection is accepted
@@ -115,20 +215,34 @@ private:
             return;
         }
 
-        auto conn        = std::make_shared<device_tcp_connection<MessageSerializer>>(this->_strand.context(), std::move(_sock));
-        conn->on_message = this->wrap_member_safe(&device_tcp_server<MessageSerializer>::handle_conn_message);
-        conn->on_close   = this->wrap_member_safe(&device_tcp_server<MessageSerializer>::remove_connection);
-        conn->on_error   = this->wrap_member_safe(&device_tcp_server<MessageSerializer>::remove_connection);
+        stream_transport_metrics<Protocol>().connections_accepted.add();
+
+        auto conn      = std::make_shared<device_tcp_connection<MessageSerializer, Protocol>>(*_sock_context, std::move(_sock), _config);
+        conn->on_close = this->wrap_member_safe(&device_tcp_server::remove_connection);
+        conn->on_error = this->wrap_member_safe(&device_tcp_server::remove_connection);
+        if (_pool)
+        {
+            // Deliver from the io_context of the connection, the server strand is only used to add and remove connections
+            conn->on_message = on_message.get();
+        }
+        else
+        {
+            conn->on_message = this->wrap_member_safe(&device_tcp_server::handle_conn_message);
+        }
 
         conn->start_receive();
         auto id = conn->get_connection_id();
         _connections.emplace(id, std::move(conn));
 
-        _acceptor.async_accept(_sock, this->wrap_member_safe(&device_tcp_server<MessageSerializer>::handle_accept));
+        accept_next();
     }
 
     // Callback for connection close and error
-    void remove_connection(size_t id_) { _connections.erase(id_); }
+    void remove_connection(size_t id_)
+    {
+        if (_connections.erase(id_))
+            stream_transport_metrics<Protocol>().connections_closed.add();
+    }
 
     // Callback for connection message
     void handle_conn_message(device_control_messages::device_message_type message_) { on_message(std::move(message_)); }
@@ -137,8 +251,15 @@ private:
     std::string me() const { return "[device_tcp_server] "; }
 
 private:
-    boost::asio::ip::tcp::acceptor _acceptor;
-    boost::asio::ip::tcp::socket _sock;
-    std::unordered_map<size_t, std::shared_ptr<device_tcp_connection<MessageSerializer>>> _connections;
+    typename Protocol::acceptor _acceptor;
+    typename Protocol::socket _sock;
+    boost::asio::io_context* _sock_context{nullptr};
+    const connection_config _config;
+    io_context_pool* _pool{nullptr};
+    std::unordered_map<size_t, std::shared_ptr<device_tcp_connection<MessageSerializer, Protocol>>> _connections;
 };
-}
\ No newline at end of file
+
+//! Server accepting device connections on Unix domain socket
+template <class MessageSerializer>
+using device_unix_server = device_tcp_server<MessageSerializer, boost::asio::local::stream_protocol>;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include <common/handler_holder.h>
+#include <common/safe_async.h>
+#include <common/types.h>
+#include <device_control_messages/messages.h>
+#include <net/types.h>
+
+namespace hw::net
+{
+
+/**
+ * @brief UDP client reporting messages to device monitoring center.
+ * Every message is sent as one datagram. Delivery is not confirmed, messages lost in network are not detected.
+ *
+ * @tparam MessageSerializer Type of message serializer/deserializer
+ */
+template <class MessageSerializer>
+class device_udp_client : public common::safe_async<device_udp_client<MessageSerializer>>
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param ioc_ Boost.Asio io_context
+     */
+    explicit device_udp_client(boost::asio::io_context& ioc_)
+        : common::safe_async<device_udp_client<MessageSerializer>>(ioc_)
+        , _sock(ioc_)
+    {}
+
+    /**
+     * @brief Set address of device monitoring center, @ref on_connect is triggered once messages can be sent
+     *
+     * @param ip_address_ IP address of the center
+     * @param udp_port_ UDP port of the center
+     */
+    void connect(const ip_address_t& ip_address_, port_t udp_port_)
+    {
+        this->post_member_safe(&device_udp_client::connect_impl, std::move(ip_address_), udp_port_);
+    }
+
+    /**
+     * @brief Send device control message to device monitoring center
+     *
+     * @param message_ Message to send
+     */
+    void send(device_control_messages::device_message_type message_) { this->post_member_safe(&device_udp_client::send_impl, std::move(message_)); }
+
+public:
+    //! Callback triggered when client is ready to send messages
+    common::handler_holder<void()> on_connect;
+    //! Callback triggered when error occurs
+    common::handler_holder<void()> on_error;
+
+private:
+    // Connect internal implementation - must be invoked from within strand context
+    void connect_impl(const ip_address_t& ip_address_, port_t udp_port_)
+    {
+        if (_sock.is_open())
+        {
+            std::cerr << me() << "Connect refused. REASON(already connected)" << std::endl;
+            return;
+        }
+
+        boost::system::error_code ec;
+        auto ip = boost::asio::ip::make_address(ip_address_, ec);
+        if (ec)
+        {
+            std::cerr << me() << "Error forming IP address. EC(" << ec << ")" << std::endl;
+            on_error();
+            return;
+        }
+
+        // Connected datagram socket only fixes the destination, no packet is sent
+        _sock.connect(boost::asio::ip::udp::endpoint(ip, udp_port_), ec);
+        if (ec)
+        {
+            std::cerr << me() << "Error during connecting. EC(" << ec << ")" << std::endl;
+            on_error();
+            return;
+        }
+
+        on_connect();
+    }
+
+    // Send internal implementaiton - must be invoked from within strand context
+    void send_impl(device_control_messages::device_message_type message_)
+    {
+        if (!_sock.is_open())
+        {
+            std::cerr << me() << "Send refused. REASON(not connected)" << std::endl;
+            return;
+        }
+
+        _messages_to_send.push_back(std::move(message_));
+        if (!_sending)
+            send_next();
+    }
+
+    // Send oldest queued message as one datagram
+    void send_next()
+    {
+        _sending_buffer.clear();
+        MessageSerializer::serialize(_messages_to_send.front(), _sending_buffer);
+        _messages_to_send.pop_front();
+
+        _sending = true;
+        _sock.async_send(boost::asio::buffer(_sending_buffer), this->wrap_member_safe(&device_udp_client<MessageSerializer>::handle_message_sent));
+    }
+
+    // Handler called when datagram is sent
+    void handle_message_sent(boost::system::error_code ec_, size_t)
+    {
+        _sending = false;
+        if (ec_)
+        {
+            if (ec_ == boost::asio::error::operation_aborted)
+                return;
+
+            // Datagram errors, e.g. ICMP port unreachable reported for previous datagram, do not break the socket
+            std::cerr << me() << "Error sending message. EC(" << ec_ << ")" << std::endl;
+            on_error();
+        }
+
+        if (!_messages_to_send.empty())
+            send_next();
+    }
+
+    // For logging purposes
+    std::string me() const { return "[device_udp_client] "; }
+
+private:
+    boost::asio::ip::udp::socket _sock;
+    std::deque<device_control_messages::device_message_type> _messages_to_send;
+    std::vector<common::byte_t> _sending_buffer;
+    bool _sending{false};
+};
+}
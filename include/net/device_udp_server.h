@@ -0,0 +1,293 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#if defined(__linux__)
+#include <sys/socket.h>
+#endif
+
+#include <common/handler_holder.h>
+#include <common/safe_async.h>
+#include <common/types.h>
+#include <device_control_messages/messages.h>
+#include <net/transport_metrics.h>
+#include <net/types.h>
+
+namespace hw::net
+{
+
+/**
+ * @brief UDP server receiving messages from devices
+ *
+ * Every datagram carries exactly one serialized device control message, there is no per-device connection state. Datagrams are
+ * received in batches: the server waits until the socket is readable and then drains it with `recvmmsg`, up to
+ * @ref datagram_config::recv_batch datagrams per system call. On other platforms than Linux datagrams are drained one by one. At most
+ * @ref datagram_config::batches_per_wakeup batches are received per wakeup, then the server waits for readability again, so a flood of
+ * datagrams does not starve other handlers of the io_context.
+ * Datagrams which are not exactly one valid message are counted as malformed and skipped, datagrams dropped by the kernel are counted
+ * as dropped, see @ref statistics.
+ *
+ * @tparam MessageSerializer Type of message serializer/deserializer
+ */
+template <class MessageSerializer>
+class device_udp_server : public common::safe_async<device_udp_server<MessageSerializer>>
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param ioc_ Boost.Asio io_context
+     * @param config_ Tuning parameters of the server
+     */
+    device_udp_server(boost::asio::io_context& ioc_, const datagram_config& config_ = {})
+        : common::safe_async<device_udp_server<MessageSerializer>>(ioc_)
+        , _sock(ioc_)
+        , _config(config_)
+        , _buffers(std::max<size_t>(_config.recv_batch, 1), std::vector<common::byte_t>(_config.max_datagram_len))
+    {
+#if defined(__linux__)
+        _headers.resize(_buffers.size());
+        _iovecs.resize(_buffers.size());
+        _controls.resize(_buffers.size());
+#endif
+    }
+
+    /**
+     * @brief Start listening
+     *
+     * @param ip_address_ IP address to listen on
+     * @param udp_port_ UDP port to listen on
+     */
+    void listen(const ip_address_t& ip_address_, port_t udp_port_)
+    {
+        this->post_member_safe(&device_udp_server<MessageSerializer>::listen_impl, std::move(ip_address_), udp_port_);
+    }
+
+    //! Counters of received, malformed and dropped datagrams
+    datagram_statistics statistics() const
+    {
+        return {_received.load(std::memory_order_relaxed), _malformed.load(std::memory_order_relaxed), _dropped.load(std::memory_order_relaxed)};
+    }
+
+public:
+    //! Callback triggered when device control message is received. Callback parameter: deserialized device control message.
+    common::handler_holder<void(device_control_messages::device_message_type)> on_message;
+    //! Callback triggered when error occurs.
+    common::handler_holder<void()> on_error;
+
+private:
+    // Listen internal implementation - must be invoked from within strand context
+    void listen_impl(const ip_address_t& ip_address_, port_t udp_port_)
+    {
+        if (_sock.is_open())
+            return;
+
+        boost::system::error_code ec;
+        auto ip = boost::asio::ip::make_address(ip_address_, ec);
+        if (ec)
+        {
+            std::cerr << me() << "Error forming IP address. EC(" << ec << ")" << std::endl;
+            on_error();
+            return;
+        }
+
+        boost::asio::ip::udp::endpoint ep(ip, udp_port_);
+
+        _sock.open(ep.protocol(), ec);
+        if (ec)
+        {
+            std::cerr << me() << "Error opening socket. EC(" << ec << ")" << std::endl;
+            on_error();
+            return;
+        }
+
+        if (_config.socket_recv_buffer_len)
+            _sock.set_option(boost::asio::socket_base::receive_buffer_size(static_cast<int>(_config.socket_recv_buffer_len)), ec);
+        if (!ec)
+            _sock.non_blocking(true, ec);
+        if (ec)
+        {
+            std::cerr << me() << "Error seting socket options. EC(" << ec << ")" << std::endl;
+            on_error();
+            return;
+        }
+
+#if defined(__linux__)
+        // Kernel reports number of datagrams dropped on full receive buffer with every received datagram
+        int enable = 1;
+        if (::setsockopt(_sock.native_handle(), SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable)) != 0)
+            std::cerr << me() << "Counting of dropped datagrams not available" << std::endl;
+#endif
+
+        _sock.bind(ep, ec);
+        if (ec)
+        {
+            std::cerr << me() << "Error binding socket. EC(" << ec << ")" << std::endl;
+            on_error();
+            return;
+        }
+
+        wait_readable();
+    }
+
+    // Wait until socket has datagrams to receive
+    void wait_readable()
+    {
+        _sock.async_wait(boost::asio::socket_base::wait_read, this->wrap_member_safe(&device_udp_server<MessageSerializer>::handle_readable));
+    }
+
+    // Handler called when socket has datagrams to receive
+    void handle_readable(boost::system::error_code ec_)
+    {
+        if (ec_)
+        {
+            if (ec_ != boost::asio::error::operation_aborted)
+            {
+                std::cerr << me() << "Error waiting for datagrams. EC(" << ec_ << ")" << std::endl;
+                on_error();
+            }
+            return;
+        }
+
+        boost::system::error_code ec;
+        bool more{true};
+        for (size_t batch = 0; more && batch < std::max<size_t>(_config.batches_per_wakeup, 1); batch++)
+        {
+            more = receive_batch(ec);
+        }
+        if (ec)
+        {
+            std::cerr << me() << "Error receiving. EC(" << ec << ")" << std::endl;
+            on_error();
+            return;
+        }
+
+        wait_readable();
+    }
+
+#if defined(__linux__)
+    // Receive up to one batch of datagrams, returns whether the batch was full and more datagrams may be waiting
+    bool receive_batch(boost::system::error_code& ec_)
+    {
+        for (size_t i = 0; i < _buffers.size(); i++)
+        {
+            _iovecs[i]            = {_buffers[i].data(), _buffers[i].size()};
+            auto& header          = _headers[i].msg_hdr;
+            header                = {};
+            header.msg_iov        = &_iovecs[i];
+            header.msg_iovlen     = 1;
+            header.msg_control    = _controls[i].data;
+            header.msg_controllen = sizeof(_controls[i].data);
+        }
+
+        int count = ::recvmmsg(_sock.native_handle(), _headers.data(), static_cast<unsigned>(_headers.size()), MSG_DONTWAIT, nullptr);
+        if (count < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                ec_ = boost::system::error_code(errno, boost::asio::error::get_system_category());
+            return false;
+        }
+
+        for (size_t i = 0; i < static_cast<size_t>(count); i++)
+        {
+            const auto& header = _headers[i].msg_hdr;
+            for (auto cmsg = CMSG_FIRSTHDR(&header); cmsg; cmsg = CMSG_NXTHDR(const_cast<msghdr*>(&header), cmsg))
+            {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+                {
+                    uint32_t dropped;
+                    std::memcpy(&dropped, CMSG_DATA(cmsg), sizeof(dropped));
+                    _dropped.store(dropped, std::memory_order_relaxed);
+                }
+            }
+
+            if (header.msg_flags & MSG_TRUNC)
+                count_malformed();
+            else
+                deliver(std::span<const common::byte_t>(_buffers[i].data(), _headers[i].msg_len));
+        }
+        return static_cast<size_t>(count) == _headers.size();
+    }
+#else
+    // Receive one datagram, returns whether more datagrams may be waiting
+    bool receive_batch(boost::system::error_code& ec_)
+    {
+        boost::asio::ip::udp::endpoint sender;
+        boost::system::error_code ec;
+        auto len = _sock.receive_from(boost::asio::buffer(_buffers[0]), sender, 0, ec);
+        if (ec)
+        {
+            if (ec != boost::asio::error::would_block && ec != boost::asio::error::message_size)
+                ec_ = ec;
+            if (ec == boost::asio::error::message_size)
+                count_malformed();
+            return ec == boost::asio::error::message_size;
+        }
+
+        deliver(std::span<const common::byte_t>(_buffers[0].data(), len));
+        return true;
+    }
+#endif
+
+    // Deserialize datagram and deliver its message
+    void deliver(std::span<const common::byte_t> datagram_)
+    {
+        // Serializer may keep state of partially received data, datagrams are independent of each other
+        MessageSerializer serializer;
+        metrics().received_bytes.add(datagram_.size());
+        auto [message, bytes_read] = serializer.deserialize(datagram_);
+        if (!message || bytes_read != datagram_.size())
+        {
+            count_malformed();
+            return;
+        }
+
+        _received.fetch_add(1, std::memory_order_relaxed);
+        metrics().received_messages.add();
+        on_message(std::move(*message));
+    }
+
+    // Count datagram which is not one valid message
+    void count_malformed()
+    {
+        _malformed.fetch_add(1, std::memory_order_relaxed);
+        metrics().parse_failures.add();
+    }
+
+    // Metrics shared by all UDP servers
+    static transport_metrics& metrics()
+    {
+        static transport_metrics instance("udp");
+        return instance;
+    }
+
+    // For logging purposes
+    std::string me() const { return "[device_udp_server] "; }
+
+private:
+#if defined(__linux__)
+    struct control_buffer
+    {
+        alignas(cmsghdr) char data[CMSG_SPACE(sizeof(uint32_t))];
+    };
+#endif
+
+    boost::asio::ip::udp::socket _sock;
+    const datagram_config _config;
+    std::vector<std::vector<common::byte_t>> _buffers;
+#if defined(__linux__)
+    std::vector<mmsghdr> _headers;
+    std::vector<iovec> _iovecs;
+    std::vector<control_buffer> _controls;
+#endif
+    std::atomic<uint64_t> _received{0};
+    std::atomic<uint64_t> _malformed{0};
+    std::atomic<uint64_t> _dropped{0};
+};
+}
@@ -0,0 +1,434 @@
+#pragma once
+
+#if defined(HW_WITH_IO_URING)
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <span>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include <netinet/in.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <common/handler_holder.h>
+#include <common/types.h>
+#include <device_control_messages/messages.h>
+#include <net/io_uring.h>
+#include <net/receive_buffer.h>
+#include <net/transport_metrics.h>
+#include <net/types.h>
+
+namespace hw::net
+{
+
+/**
+ * @brief TCP server receiving messages from devices through io_uring instead of the Boost.Asio reactor
+ *
+ * The server runs its own thread driving one io_uring instance. Connections are accepted by one multishot accept and every connection
+ * receives by one multishot receive selecting buffers from a ring of buffers shared by all connections, so no operation has to be
+ * re-armed after each completion. All operations queued while processing completions are submitted together with waiting for the next
+ * completions, i.e. by one system call per loop iteration regardless of number of connections.
+ *
+ * Messages are deserialized directly from the provided buffer, only an incomplete message at its end is copied to the receive buffer of
+ * the connection. @ref on_message is invoked from the thread of the server, never concurrently.
+ *
+ * Use @ref io_uring_backend_supported to check whether the kernel supports the server before creating it.
+ *
+ * @tparam MessageSerializer Type of message serializer/deserializer
+ */
+template <class MessageSerializer>
+class device_uring_server
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param config_ Tuning parameters of accepted connections
+     * @param uring_config_ Tuning parameters of the io_uring instance
+     */
+    explicit device_uring_server(const connection_config& config_ = {}, const io_uring_config& uring_config_ = {})
+        : _config(config_)
+        , _uring_config(uring_config_)
+        , _metrics(metrics())
+    {}
+
+    ~device_uring_server()
+    {
+        stop();
+        _metrics.connections_open.add(-static_cast<int64_t>(_connections.size()));
+        // Operations still pending in the ring keep the sockets referenced until the ring is torn down, shutdown releases the port
+        // and the devices immediately
+        for (const auto& [fd, conn] : _connections)
+        {
+            ::shutdown(fd, SHUT_RDWR);
+            ::close(fd);
+        }
+        if (_listen_fd >= 0)
+        {
+            ::shutdown(_listen_fd, SHUT_RDWR);
+            ::close(_listen_fd);
+        }
+        if (_wake_fd >= 0)
+            ::close(_wake_fd);
+    }
+
+    device_uring_server(const device_uring_server&)            = delete;
+    device_uring_server& operator=(const device_uring_server&) = delete;
+
+    /**
+     * @brief Start listening and start the thread of the server
+     *
+     * @param ip_address_ IP address to listen on
+     * @param tcp_port_ TCP port to listen on
+     */
+    void listen(const ip_address_t& ip_address_, port_t tcp_port_)
+    {
+        if (_listen_fd >= 0)
+            return;
+
+        boost::system::error_code ec;
+        auto ip = boost::asio::ip::make_address(ip_address_, ec);
+        if (ec)
+        {
+            std::cerr << me() << "Error forming IP address. EC(" << ec << ")" << std::endl;
+            on_error();
+            return;
+        }
+        boost::asio::ip::tcp::endpoint ep(ip, tcp_port_);
+
+        if (!_ring.open(_uring_config.queue_entries) || !_buffers.open(_ring, 0, _uring_config.buffers_count, _uring_config.buffer_len))
+        {
+            std::cerr << me() << "Error creating io_uring instance. ERROR(" << std::strerror(errno) << ")" << std::endl;
+            on_error();
+            return;
+        }
+
+        _wake_fd   = ::eventfd(0, EFD_CLOEXEC);
+        _listen_fd = ::socket(ep.protocol().family(), SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (_wake_fd < 0 || _listen_fd < 0)
+        {
+            std::cerr << me() << "Error opening socket. ERROR(" << std::strerror(errno) << ")" << std::endl;
+            on_error();
+            return;
+        }
+
+        int enable = 1;
+        if (::setsockopt(_listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) != 0
+            || ::bind(_listen_fd, ep.data(), static_cast<socklen_t>(ep.size())) != 0 || ::listen(_listen_fd, SOMAXCONN) != 0)
+        {
+            std::cerr << me() << "Error during listen. ERROR(" << std::strerror(errno) << ")" << std::endl;
+            on_error();
+            return;
+        }
+
+        arm_accept();
+        arm_wake();
+        _thread = std::thread([this] { run(); });
+    }
+
+    /** @brief Stop the thread of the server, connections stay open until the server is destroyed */
+    void stop()
+    {
+        if (!_thread.joinable())
+            return;
+
+        _stopping.store(true, std::memory_order_relaxed);
+        uint64_t value{1};
+        if (::write(_wake_fd, &value, sizeof(value)) != sizeof(value))
+            std::cerr << me() << "Error waking server thread. ERROR(" << std::strerror(errno) << ")" << std::endl;
+        _thread.join();
+    }
+
+public:
+    //! Callback triggered when device control message is received. Callback parameter: deserialized device control message.
+    common::handler_holder<void(device_control_messages::device_message_type)> on_message;
+    //! Callback triggered when error occurs.
+    common::handler_holder<void()> on_error;
+
+private:
+    // Operation of completion, stored in upper half of user data, lower half is file descriptor
+    enum class operation : uint64_t
+    {
+        accept = 1,
+        receive,
+        wake
+    };
+
+    struct connection
+    {
+        connection(const connection_config& config_)
+            : recv_buffer(config_.initial_recv_buffer_len, config_.max_recv_buffer_len)
+        {}
+
+        receive_buffer recv_buffer;
+        MessageSerializer serializer;
+        bool closing{false};
+    };
+
+    // Thread loop: submit queued operations and process completions
+    void run()
+    {
+        while (!_stopping.load(std::memory_order_relaxed))
+        {
+            auto ret = _ring.submit_and_wait(1);
+            if (ret < 0 && ret != -EINTR && ret != -EBUSY)
+            {
+                std::cerr << me() << "Error submitting operations. ERROR(" << std::strerror(-ret) << ")" << std::endl;
+                on_error();
+                return;
+            }
+
+            _ring.for_each_completion([this](const io_uring_cqe& cqe_) {
+                auto fd = static_cast<int>(cqe_.user_data & 0xffffffff);
+                switch (static_cast<operation>(cqe_.user_data >> 32))
+                {
+                case operation::accept:
+                    handle_accept(cqe_);
+                    break;
+                case operation::receive:
+                    handle_receive(fd, cqe_);
+                    break;
+                case operation::wake:
+                    if (!_stopping.load(std::memory_order_relaxed))
+                        arm_wake();
+                    break;
+                default:
+                    // Failure of giving buffer back, the buffer is lost
+                    break;
+                }
+            });
+
+            // Completions are drained, the ring accepts submissions again
+            arm_deferred();
+        }
+    }
+
+    // Get submission queue entry for operation on file descriptor, submits queued entries if the queue is full.
+    // When the kernel refuses the submission (e.g. -EBUSY until completions are reaped) the operation is deferred and nullptr returned.
+    io_uring_sqe* prepare(operation op_, uint8_t opcode_, int fd_)
+    {
+        auto sqe = _ring.get_sqe();
+        if (!sqe && _ring.submit_and_wait(0) >= 0)
+            sqe = _ring.get_sqe();
+        if (!sqe)
+        {
+            _deferred.emplace_back(op_, fd_);
+            return nullptr;
+        }
+
+        sqe->opcode    = opcode_;
+        sqe->fd        = fd_;
+        sqe->user_data = (static_cast<uint64_t>(op_) << 32) | static_cast<uint32_t>(fd_);
+        return sqe;
+    }
+
+    // Queue operations deferred by full submission queue, they stay deferred if the queue is still full
+    void arm_deferred()
+    {
+        if (_deferred.empty())
+            return;
+
+        std::vector<std::pair<operation, int>> deferred;
+        deferred.swap(_deferred);
+        for (auto [op, fd] : deferred)
+        {
+            if (_stopping.load(std::memory_order_relaxed))
+                return;
+
+            switch (op)
+            {
+            case operation::accept:
+                arm_accept();
+                break;
+            case operation::receive:
+                if (_connections.contains(fd))
+                    arm_receive(fd);
+                break;
+            case operation::wake:
+                arm_wake();
+                break;
+            }
+        }
+    }
+
+    // Queue multishot accept, one completion per accepted connection
+    void arm_accept()
+    {
+        auto sqe = prepare(operation::accept, IORING_OP_ACCEPT, _listen_fd);
+        if (!sqe)
+            return;
+
+        sqe->ioprio       = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_CLOEXEC;
+    }
+
+    // Queue multishot receive into provided buffers, one completion per filled buffer
+    void arm_receive(int fd_)
+    {
+        auto sqe = prepare(operation::receive, IORING_OP_RECV, fd_);
+        if (!sqe)
+            return;
+
+        sqe->ioprio    = IORING_RECV_MULTISHOT;
+        sqe->flags     = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = _buffers.group();
+    }
+
+    // Queue read of wake event, completes when the server is stopped
+    void arm_wake()
+    {
+        auto sqe = prepare(operation::wake, IORING_OP_READ, _wake_fd);
+        if (!sqe)
+            return;
+
+        sqe->addr = reinterpret_cast<uint64_t>(&_wake_value);
+        sqe->len  = sizeof(_wake_value);
+    }
+
+    // Handler called when connection is accepted
+    void handle_accept(const io_uring_cqe& cqe_)
+    {
+        if (cqe_.res >= 0)
+        {
+            _connections.try_emplace(cqe_.res, _config);
+            _metrics.connections_accepted.add();
+            _metrics.connections_open.add(1);
+            arm_receive(cqe_.res);
+        }
+        else if (cqe_.res != -ECANCELED)
+        {
+            // Accepting continues, e.g. running out of file descriptors does not stop the server
+            std::cerr << me() << "Error during accept. ERROR(" << std::strerror(-cqe_.res) << ")" << std::endl;
+        }
+
+        if (!(cqe_.flags & IORING_CQE_F_MORE) && !_stopping.load(std::memory_order_relaxed))
+            arm_accept();
+    }
+
+    // Handler called when data is received on connection or its multishot receive terminates
+    void handle_receive(int fd_, const io_uring_cqe& cqe_)
+    {
+        auto it = _connections.find(fd_);
+        if (cqe_.flags & IORING_CQE_F_BUFFER)
+        {
+            auto id = static_cast<uint16_t>(cqe_.flags >> IORING_CQE_BUFFER_SHIFT);
+            if (cqe_.res > 0 && it != _connections.end() && !it->second.closing && !receive_data(it->second, _buffers.data(id, static_cast<size_t>(cqe_.res))))
+            {
+                // Shutdown terminates the multishot receive, the connection is closed on its last completion
+                it->second.closing = true;
+                ::shutdown(fd_, SHUT_RDWR);
+            }
+            _buffers.recycle(id);
+        }
+
+        if (it == _connections.end() || (cqe_.flags & IORING_CQE_F_MORE))
+            return;
+
+        if (!it->second.closing)
+        {
+            // Receive terminated by running out of provided buffers or by the kernel, the connection stays open
+            if (cqe_.res > 0 || cqe_.res == -ENOBUFS)
+            {
+                arm_receive(fd_);
+                return;
+            }
+            if (cqe_.res < 0 && cqe_.res != -ECONNRESET && cqe_.res != -ECANCELED)
+                std::cerr << me() << "Error receiving. ERROR(" << std::strerror(-cqe_.res) << ")" << std::endl;
+        }
+
+        ::close(fd_);
+        _connections.erase(it);
+        _metrics.connections_closed.add();
+        _metrics.connections_open.add(-1);
+    }
+
+    // Deserialize received data, returns false if the connection has to be closed
+    bool receive_data(connection& conn_, std::span<const common::byte_t> data_)
+    {
+        _metrics.received_bytes.add(data_.size());
+        _metrics.receive_bytes.observe(static_cast<double>(data_.size()));
+
+        // Nothing pending from previous receives, messages are deserialized in place
+        if (conn_.recv_buffer.size() == 0)
+            data_ = data_.subspan(deliver(conn_.serializer, data_));
+
+        while (!data_.empty())
+        {
+            auto buffer = conn_.recv_buffer.prepare();
+            if (buffer.empty())
+            {
+                std::cerr << me() << "Receive buffer full, message too long. LENGTH(" << conn_.recv_buffer.size() << ")" << std::endl;
+                return false;
+            }
+
+            auto len = std::min(buffer.size(), data_.size());
+            std::memcpy(buffer.data(), data_.data(), len);
+            conn_.recv_buffer.commit(len);
+            data_ = data_.subspan(len);
+
+            conn_.recv_buffer.consume(deliver(conn_.serializer, conn_.recv_buffer.data()));
+        }
+        return true;
+    }
+
+    // Deliver all complete messages from the beginning of data, returns number of processed bytes
+    size_t deliver(MessageSerializer& serializer_, std::span<const common::byte_t> data_)
+    {
+        size_t processed{0};
+        auto [message, bytes_read] = serializer_.deserialize(data_);
+        while (bytes_read != 0)
+        {
+            if (message)
+            {
+                _metrics.received_messages.add();
+                on_message(std::move(*message));
+            }
+            else
+            {
+                _metrics.parse_failures.add();
+                std::cerr << me() << "Dropping malformed data. LENGTH(" << bytes_read << ")" << std::endl;
+            }
+            processed += bytes_read;
+
+            std::tie(message, bytes_read) = serializer_.deserialize(data_.subspan(processed));
+        }
+        return processed;
+    }
+
+    // Metrics shared by all io_uring servers
+    static transport_metrics& metrics()
+    {
+        static transport_metrics instance("io_uring");
+        return instance;
+    }
+
+    // For logging purposes
+    std::string me() const { return "[device_uring_server] "; }
+
+private:
+    const connection_config _config;
+    const io_uring_config _uring_config;
+    transport_metrics& _metrics;
+    // Buffers are registered with the ring, the ring has to be destroyed first
+    provided_buffer_ring _buffers;
+    io_uring_ring _ring;
+    int _listen_fd{-1};
+    int _wake_fd{-1};
+    uint64_t _wake_value{0};
+    std::unordered_map<int, connection> _connections;
+    std::vector<std::pair<operation, int>> _deferred;
+    std::atomic<bool> _stopping{false};
+    std::thread _thread;
+};
+}
+
+#endif
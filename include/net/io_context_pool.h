@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+
+#include <boost/asio.hpp>
+
+namespace hw::net
+{
+
+/**
+ * @brief Pool of independent io_contexts, each run by its own thread.
+ *
+ * Objects bound to one io_context of the pool are only ever touched by the thread running it, so connections spread over the pool share
+ * no strand and no handler queue. Work is distributed by @ref get_io_context, which returns the io_contexts round-robin.
+ */
+class io_context_pool
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param size_ Number of io_contexts, 0 for one io_context per hardware thread
+     * @param pin_threads_ Pin thread running i-th io_context to i-th CPU
+     */
+    explicit io_context_pool(size_t size_, bool pin_threads_ = false)
+        : _pin_threads(pin_threads_)
+    {
+        if (size_ == 0)
+            size_ = std::max(std::thread::hardware_concurrency(), 1u);
+
+        for (size_t i = 0; i < size_; i++)
+        {
+            // Each io_context is run by a single thread. The hint lets handlers posted from that thread skip the locked queue and waking other
+            // threads, the queue stays locked for operations started from other threads, e.g. the server accepting connections.
+            auto& ioc = _contexts.emplace_back(std::make_unique<boost::asio::io_context>(1));
+            _guards.emplace_back(boost::asio::make_work_guard(*ioc));
+        }
+    }
+
+    io_context_pool(const io_context_pool&)            = delete;
+    io_context_pool& operator=(const io_context_pool&) = delete;
+
+    //! Destructor, stops io_contexts and waits for their threads
+    ~io_context_pool()
+    {
+        stop();
+        join();
+    }
+
+    //! Start one thread per io_context, returns immediately
+    void run()
+    {
+        for (size_t i = 0; i < _contexts.size(); i++)
+        {
+            _threads.emplace_back([this, i] {
+                if (_pin_threads)
+                    pin_to_cpu(i);
+                _contexts[i]->run();
+            });
+        }
+    }
+
+    //! Let io_contexts finish when they run out of work
+    void release() { _guards.clear(); }
+
+    //! Stop all io_contexts, pending handlers are abandoned
+    void stop()
+    {
+        for (auto& ioc : _contexts)
+        {
+            ioc->stop();
+        }
+    }
+
+    //! Wait for threads started by @ref run
+    void join()
+    {
+        for (auto& t : _threads)
+        {
+            if (t.joinable())
+                t.join();
+        }
+        _threads.clear();
+    }
+
+    //! Next io_context in round-robin order
+    boost::asio::io_context& get_io_context() { return *_contexts[_next.fetch_add(1, std::memory_order_relaxed) % _contexts.size()]; }
+
+    //! Number of io_contexts
+    size_t size() const { return _contexts.size(); }
+
+private:
+    void pin_to_cpu(size_t index_)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(index_ % std::max(std::thread::hardware_concurrency(), 1u), &cpus);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0)
+            std::cerr << "[io_context_pool] Cannot pin thread to CPU " << index_ << std::endl;
+    }
+
+    bool _pin_threads;
+    std::vector<std::unique_ptr<boost::asio::io_context>> _contexts;
+    std::vector<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> _guards;
+    std::vector<std::thread> _threads;
+    std::atomic<size_t> _next{0};
+};
+}
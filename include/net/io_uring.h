@@ -0,0 +1,201 @@
+#pragma once
+
+#if defined(HW_WITH_IO_URING)
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include <linux/io_uring.h>
+
+#include <common/types.h>
+
+namespace hw::net
+{
+
+/**
+ * @brief Minimal io_uring instance driven directly by system calls.
+ *
+ * Submission queue entries are taken by @ref get_sqe and handed to the kernel together by @ref submit_and_wait, which also waits for
+ * completions, so one system call submits any number of operations. Completions are read from the mapped completion queue by
+ * @ref for_each_completion without any system call. The ring must be used by a single thread.
+ */
+class io_uring_ring
+{
+public:
+    io_uring_ring() = default;
+    ~io_uring_ring();
+
+    io_uring_ring(const io_uring_ring&)            = delete;
+    io_uring_ring& operator=(const io_uring_ring&) = delete;
+
+    /**
+     * @brief Create ring and map its queues
+     *
+     * @param entries_ Number of submission queue entries, completion queue is four times larger
+     * @return true on success, false if the kernel does not provide io_uring
+     */
+    bool open(unsigned entries_);
+
+    //! Check whether kernel supports operation, valid after successful @ref open
+    bool supports(uint8_t opcode_) const { return opcode_ < IORING_OP_LAST && _supported[opcode_]; }
+
+    /**
+     * @brief Get free submission queue entry, cleared
+     *
+     * @return Entry, nullptr if the submission queue is full and must be submitted first
+     */
+    io_uring_sqe* get_sqe();
+
+    /**
+     * @brief Submit all entries taken by @ref get_sqe and wait for completions
+     *
+     * @param wait_nr_ Minimum number of completions to wait for, 0 does not wait
+     * @return Number of submitted entries, negative errno on error
+     */
+    int submit_and_wait(unsigned wait_nr_);
+
+    /**
+     * @brief Process and release all available completions. Completions with user data 0 belong to operations queued by the ring itself.
+     *
+     * @tparam Handler Callable taking `const io_uring_cqe&`
+     * @param handler_ Completion handler
+     * @return Number of processed completions
+     */
+    template <class Handler>
+    size_t for_each_completion(Handler&& handler_)
+    {
+        size_t count{0};
+        auto head = *_cq_head;
+        while (head != load_acquire(_cq_tail))
+        {
+            handler_(_cqes[head & *_cq_mask]);
+            store_release(_cq_head, ++head);
+            count++;
+        }
+        return count;
+    }
+
+    /**
+     * @brief Register ring of provided buffers
+     *
+     * @param ring_ Page aligned ring memory
+     * @param entries_ Number of ring entries, power of two
+     * @param group_ Buffer group ID used by operations selecting buffers
+     * @return 0 on success, negative errno on error
+     */
+    int register_buffer_ring(void* ring_, unsigned entries_, uint16_t group_);
+
+    /**
+     * @brief Unregister ring of provided buffers
+     *
+     * @param group_ Buffer group ID
+     */
+    void unregister_buffer_ring(uint16_t group_);
+
+private:
+    static unsigned load_acquire(const unsigned* value_);
+    static void store_release(unsigned* value_, unsigned new_value_);
+
+    int _fd{-1};
+    void* _sq_ring{nullptr};
+    size_t _sq_ring_size{0};
+    void* _cq_ring{nullptr};
+    size_t _cq_ring_size{0};
+    io_uring_sqe* _sqes{nullptr};
+    size_t _sqes_size{0};
+
+    unsigned* _sq_head{nullptr};
+    unsigned* _sq_tail{nullptr};
+    unsigned* _sq_mask{nullptr};
+    unsigned _sq_entries{0};
+    unsigned _sqe_tail{0};      // Entries taken by get_sqe
+    unsigned _sqe_submitted{0}; // Entries handed to the kernel
+
+    unsigned* _cq_head{nullptr};
+    unsigned* _cq_tail{nullptr};
+    unsigned* _cq_mask{nullptr};
+    io_uring_cqe* _cqes{nullptr};
+
+    bool _supported[IORING_OP_LAST]{};
+};
+
+/**
+ * @brief Buffers provided to the kernel for receives selecting a buffer from the group.
+ * Receives take the next buffer from the ring, the buffer is given back by @ref recycle once its data are processed.
+ *
+ * The buffers are registered as a buffer ring, recycling is then a plain store to memory shared with the kernel. Kernels which accept the
+ * registration but do not select buffers from the ring are detected by one test receive, the buffers are then provided by
+ * `IORING_OP_PROVIDE_BUFFERS` operations submitted together with other operations of the ring.
+ */
+class provided_buffer_ring
+{
+public:
+    provided_buffer_ring() = default;
+    ~provided_buffer_ring();
+
+    provided_buffer_ring(const provided_buffer_ring&)            = delete;
+    provided_buffer_ring& operator=(const provided_buffer_ring&) = delete;
+
+    /**
+     * @brief Allocate buffers and register them with ring
+     *
+     * @param ring_ Ring the buffers are registered with
+     * @param group_ Buffer group ID
+     * @param count_ Number of buffers, rounded up to power of two
+     * @param buffer_len_ Length of one buffer in bytes
+     * @return true on success, false if the kernel does not support provided buffers
+     */
+    bool open(io_uring_ring& ring_, uint16_t group_, unsigned count_, size_t buffer_len_);
+
+    /**
+     * @brief Get received data
+     *
+     * @param id_ Buffer ID reported by completion
+     * @param len_ Number of received bytes
+     * @return Data
+     */
+    std::span<const common::byte_t> data(uint16_t id_, size_t len_) const
+    {
+        return std::span<const common::byte_t>(_buffers + static_cast<size_t>(id_) * _buffer_len, len_);
+    }
+
+    /**
+     * @brief Give buffer back to the kernel
+     *
+     * @param id_ Buffer ID
+     */
+    void recycle(uint16_t id_);
+
+    //! Buffer group ID
+    uint16_t group() const { return _group; }
+
+private:
+    // Receive one byte from socket pair to check that the kernel selects buffers from the registered ring
+    bool selects_buffers();
+
+    // Queue operation providing buffers starting at ID
+    bool provide(uint16_t id_, unsigned count_, uint8_t sqe_flags_);
+
+    io_uring_ring* _uring{nullptr};
+    bool _mapped{false};
+    io_uring_buf_ring* _ring{nullptr};
+    size_t _ring_size{0};
+    common::byte_t* _buffers{nullptr};
+    size_t _buffers_size{0};
+    size_t _buffer_len{0};
+    unsigned _count{0};
+    uint16_t _tail{0};
+    uint16_t _group{0};
+};
+
+/**
+ * @brief Check whether the running kernel provides everything the io_uring backend needs: multishot accept and receive and provided
+ * buffers (Linux 6.0 and newer).
+ *
+ * @return true if the backend can be used
+ */
+bool io_uring_backend_supported();
+}
+
+#endif
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <istream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+#include <boost/asio.hpp>
+
+#include <common/handler_holder.h>
+#include <common/safe_async.h>
+#include <metrics/metrics.h>
+#include <net/types.h>
+
+namespace hw::net
+{
+
+/**
+ * @brief Minimal HTTP server exposing metrics registry at `GET /metrics` in Prometheus text exposition format.
+ *
+ * Every request is answered on its own connection which is closed after the response, as Prometheus scrapes do not need keep-alive.
+ * Connections not finished within the request timeout are closed, so idle clients cannot exhaust file descriptors.
+ * Metrics are rendered from the thread handling the request, updates of metrics are not blocked meanwhile.
+ */
+class metrics_http_server : public common::safe_async<metrics_http_server>
+{
+public:
+    static constexpr size_t max_request_len = 8192;                     //!< Requests with longer header are dropped
+    static constexpr std::chrono::milliseconds accept_retry_delay{100}; //!< Delay of accepting again after accept failure
+
+    /**
+     * @brief Constructor
+     *
+     * @param ioc_ Boost.Asio io_context
+     * @param registry_ Registry to expose, must outlive the server
+     * @param request_timeout_ Time limit for receiving request and sending response of one connection
+     */
+    metrics_http_server(boost::asio::io_context& ioc_, metrics::registry& registry_ = metrics::default_registry(),
+                        std::chrono::milliseconds request_timeout_ = std::chrono::seconds(10))
+        : common::safe_async<metrics_http_server>(ioc_)
+        , _acceptor(ioc_)
+        , _sock(ioc_)
+        , _accept_timer(ioc_)
+        , _registry(registry_)
+        , _request_timeout(request_timeout_)
+    {}
+
+    /**
+     * @brief Start listening
+     *
+     * @param ip_address_ IP address to listen on
+     * @param tcp_port_ TCP port to listen on
+     */
+    void listen(const ip_address_t& ip_address_, port_t tcp_port_)
+    {
+        this->post_member_safe(&metrics_http_server::listen_impl, std::move(ip_address_), tcp_port_);
+    }
+
+public:
+    //! Callback triggered when error occurs.
+    common::handler_holder<void()> on_error;
+
+private:
+    // State of one HTTP connection
+    struct session
+    {
+        explicit session(boost::asio::ip::tcp::socket&& sock_)
+            : sock(std::move(sock_))
+            , timer(sock.get_executor())
+            , request(max_request_len)
+        {}
+
+        boost::asio::ip::tcp::socket sock;
+        boost::asio::steady_timer timer;
+        boost::asio::streambuf request;
+        std::string response;
+    };
+
+    // Listen internal implementation - must be invoked from within strand context
+    void listen_impl(const ip_address_t& ip_address_, port_t tcp_port_)
+    {
+        if (_acceptor.is_open())
+            return;
+
+        boost::system::error_code ec;
+        auto ip = boost::asio::ip::make_address(ip_address_, ec);
+        if (ec)
+        {
+            std::cerr << me() << "Error forming IP address. EC(" << ec << ")" << std::endl;
+            on_error();
+            return;
+        }
+
+        boost::asio::ip::tcp::endpoint ep(ip, tcp_port_);
+        _acceptor.open(ep.protocol(), ec);
+        if (!ec)
+            _acceptor.set_option(boost::asio::socket_base::reuse_address(true), ec);
+        if (!ec)
+            _acceptor.bind(ep, ec);
+        if (!ec)
+            _acceptor.listen(boost::asio::socket_base::max_listen_connections, ec);
+        if (ec)
+        {
+            std::cerr << me() << "Error during listen. EC(" << ec << ")" << std::endl;
+            on_error();
+            return;
+        }
+
+        accept();
+    }
+
+    // Accept next connection
+    void accept()
+    {
+        _sock = boost::asio::ip::tcp::socket(this->_strand.context());
+        _acceptor.async_accept(_sock, this->wrap_member_safe(&metrics_http_server::handle_accept));
+    }
+
+    // Handler called when new connection is accepted
+    void handle_accept(boost::system::error_code ec_)
+    {
+        if (ec_)
+        {
+            if (ec_ != boost::asio::error::operation_aborted)
+            {
+                // Accepting continues, e.g. running out of file descriptors does not stop the server. The delay avoids spinning on pending connection.
+                std::cerr << me() << "Error during accept. EC(" << ec_ << ")" << std::endl;
+                _accept_timer.expires_after(accept_retry_delay);
+                _accept_timer.async_wait(this->wrap_member_safe(&metrics_http_server::handle_accept_retry));
+            }
+            return;
+        }
+
+        auto id    = _next_session_id++;
+        auto& sess = *_sessions.emplace(id, std::make_unique<session>(std::move(_sock))).first->second;
+
+        auto timeout_handler = this->wrap_member_safe(&metrics_http_server::handle_timeout);
+        sess.timer.expires_after(_request_timeout);
+        sess.timer.async_wait([handler = std::move(timeout_handler), id](boost::system::error_code ec_) mutable { handler(id, ec_); });
+
+        auto handler = this->wrap_member_safe(&metrics_http_server::handle_request);
+        boost::asio::async_read_until(sess.sock, sess.request, "\r\n\r\n",
+                                      [handler = std::move(handler), id](boost::system::error_code ec_, size_t) mutable { handler(id, ec_); });
+
+        accept();
+    }
+
+    // Handler called when delay after accept failure elapses
+    void handle_accept_retry(boost::system::error_code ec_)
+    {
+        if (!ec_)
+            accept();
+    }
+
+    // Handler called when connection is not finished in time, closing the socket completes its pending operation
+    void handle_timeout(size_t id_, boost::system::error_code ec_)
+    {
+        auto iter = _sessions.find(id_);
+        if (ec_ || iter == _sessions.end())
+            return;
+
+        boost::system::error_code ec;
+        iter->second->sock.close(ec);
+    }
+
+    // Handler called when request header is received
+    void handle_request(size_t id_, boost::system::error_code ec_)
+    {
+        auto iter = _sessions.find(id_);
+        if (iter == _sessions.end())
+            return;
+        if (ec_)
+        {
+            _sessions.erase(iter);
+            return;
+        }
+
+        auto& sess = *iter->second;
+        std::istream is(&sess.request);
+        std::string method, target;
+        is >> method >> target;
+        target = target.substr(0, target.find('?'));
+
+        if (method == "GET" && target == "/metrics")
+        {
+            std::ostringstream body;
+            _registry.write(body);
+            sess.response = make_response("200 OK", "text/plain; version=0.0.4; charset=utf-8", body.str());
+        }
+        else
+        {
+            sess.response = make_response("404 Not Found", "text/plain; charset=utf-8", "Not found\n");
+        }
+
+        auto handler = this->wrap_member_safe(&metrics_http_server::handle_response_sent);
+        boost::asio::async_write(sess.sock, boost::asio::buffer(sess.response),
+                                 [handler = std::move(handler), id_](boost::system::error_code, size_t) mutable { handler(id_); });
+    }
+
+    // Handler called when response is sent, connection is closed
+    void handle_response_sent(size_t id_)
+    {
+        auto iter = _sessions.find(id_);
+        if (iter == _sessions.end())
+            return;
+
+        boost::system::error_code ec;
+        iter->second->sock.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+        _sessions.erase(iter);
+    }
+
+    // Format complete HTTP response
+    static std::string make_response(const std::string& status_, const std::string& content_type_, const std::string& body_)
+    {
+        std::ostringstream os;
+        os << "HTTP/1.1 " << status_ << "\r\n"
+           << "Content-Type: " << content_type_ << "\r\n"
+           << "Content-Length: " << body_.size() << "\r\n"
+           << "Connection: close\r\n\r\n"
+           << body_;
+        return os.str();
+    }
+
+    // For logging purposes
+    std::string me() const { return "[metrics_http_server] "; }
+
+private:
+    boost::asio::ip::tcp::acceptor _acceptor;
+    boost::asio::ip::tcp::socket _sock;
+    boost::asio::steady_timer _accept_timer;
+    metrics::registry& _registry;
+    const std::chrono::milliseconds _request_timeout;
+    size_t _next_session_id{0};
+    std::unordered_map<size_t, std::unique_ptr<session>> _sessions;
+};
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#include <common/types.h>
+
+namespace hw::net
+{
+
+/**
+ * @brief Contiguous receive buffer which sockets read into directly.
+ *
+ * Received data is appended to the end of the buffer (@ref prepare, @ref commit) and processed data is released from its beginning
+ * (@ref consume). Consuming only moves the read offset, so processing of many messages from one receive does not shift the rest of the data.
+ * Unprocessed data is moved to the beginning of the buffer only when there is not enough space left behind it, i.e. at most once per receive
+ * and only the incomplete tail is moved.
+ *
+ * Size of the region offered for the next receive adapts to the traffic: it doubles whenever a receive fills it completely, up to the
+ * maximum buffer length.
+ */
+class receive_buffer
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param initial_len_ Initial buffer length and size of the first receive
+     * @param max_len_ Maximum buffer length, i.e. maximum length of one message
+     */
+    receive_buffer(size_t initial_len_, size_t max_len_)
+        : _buffer(std::min(initial_len_, max_len_))
+        , _max_len(max_len_)
+        , _receive_len(_buffer.size())
+    {}
+
+    /**
+     * @brief Get writable region for the next receive
+     *
+     * @return Writable region, empty if the buffer is full of unprocessed data and cannot grow anymore.
+     */
+    std::span<common::byte_t> prepare()
+    {
+        if (_read_pos == _write_pos)
+            _read_pos = _write_pos = 0;
+
+        if (_buffer.size() - _write_pos < _receive_len)
+        {
+            if (_buffer.size() - size() < _receive_len && _buffer.size() < _max_len)
+                _buffer.resize(std::min(_max_len, std::max(_buffer.size() * 2, size() + _receive_len)));
+
+            if (_read_pos != 0)
+            {
+                std::memmove(_buffer.data(), _buffer.data() + _read_pos, size());
+                _write_pos -= _read_pos;
+                _read_pos = 0;
+            }
+        }
+
+        _prepared = std::min(_receive_len, _buffer.size() - _write_pos);
+        return std::span<common::byte_t>(_buffer.data() + _write_pos, _prepared);
+    }
+
+    /**
+     * @brief Mark bytes written into the region returned by @ref prepare as readable
+     *
+     * @param len_ Number of bytes written
+     */
+    void commit(size_t len_)
+    {
+        _write_pos += len_;
+        if (len_ == _prepared && _receive_len < _max_len)
+            _receive_len = std::min(_max_len, _receive_len * 2);
+    }
+
+    /**
+     * @brief Get unprocessed data
+     *
+     * @return Readable data
+     */
+    std::span<const common::byte_t> data() const { return std::span<const common::byte_t>(_buffer.data() + _read_pos, size()); }
+
+    /**
+     * @brief Release processed bytes from the beginning of readable data
+     *
+     * @param len_ Number of bytes to release
+     */
+    void consume(size_t len_) { _read_pos += std::min(len_, size()); }
+
+    /**
+     * @brief Get number of unprocessed bytes
+     *
+     * @return Number of bytes
+     */
+    size_t size() const { return _write_pos - _read_pos; }
+
+private:
+    std::vector<common::byte_t> _buffer;
+    const size_t _max_len;
+    size_t _receive_len;
+    size_t _read_pos{0};
+    size_t _write_pos{0};
+    size_t _prepared{0};
+};
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <type_traits>
+
+#include <boost/asio.hpp>
+
+#include <metrics/metrics.h>
+
+namespace hw::net
+{
+
+/**
+ * @brief Metrics of one transport (tcp, unix, udp, io_uring) in the default registry, labelled by transport name.
+ * All connections and servers of the transport update the same metrics.
+ */
+struct transport_metrics
+{
+    /**
+     * @brief Constructor, gets or creates the metrics
+     *
+     * @param transport_ Transport name used as label value
+     */
+    explicit transport_metrics(const std::string& transport_)
+        : transport_metrics(metrics::default_registry(), "transport=\"" + transport_ + "\"")
+    {}
+
+    metrics::counter& connections_accepted; //!< Connections accepted by servers
+    metrics::counter& connections_closed;   //!< Accepted connections closed by peer or on error
+    metrics::gauge& connections_open;       //!< Currently open connections, both accepted and connected by clients
+    metrics::counter& received_bytes;       //!< Bytes received
+    metrics::counter& sent_bytes;           //!< Bytes sent
+    metrics::counter& received_messages;    //!< Messages deserialized from received data
+    metrics::counter& sent_messages;        //!< Messages sent
+    metrics::counter& parse_failures;       //!< Received data dropped as malformed
+    metrics::gauge& send_queue_depth;       //!< Messages queued for sending in all connections
+    metrics::histogram& receive_bytes;      //!< Bytes returned by one receive, shows how well receives batch
+
+private:
+    transport_metrics(metrics::registry& registry_, const std::string& labels_)
+        : connections_accepted(registry_.add_counter("hw_net_connections_accepted_total", "Connections accepted by servers", labels_))
+        , connections_closed(registry_.add_counter("hw_net_connections_closed_total", "Accepted connections closed", labels_))
+        , connections_open(registry_.add_gauge("hw_net_connections_open", "Currently open connections", labels_))
+        , received_bytes(registry_.add_counter("hw_net_received_bytes_total", "Bytes received from devices", labels_))
+        , sent_bytes(registry_.add_counter("hw_net_sent_bytes_total", "Bytes sent", labels_))
+        , received_messages(registry_.add_counter("hw_net_received_messages_total", "Messages received from devices", labels_))
+        , sent_messages(registry_.add_counter("hw_net_sent_messages_total", "Messages sent", labels_))
+        , parse_failures(registry_.add_counter("hw_net_parse_failures_total", "Received data dropped as malformed", labels_))
+        , send_queue_depth(registry_.add_gauge("hw_net_send_queue_depth", "Messages queued for sending", labels_))
+        , receive_bytes(registry_.add_histogram("hw_net_receive_bytes", "Bytes returned by one receive", {64, 256, 1024, 4096, 16384, 65536, 262144}, labels_))
+    {}
+};
+
+/**
+ * @brief Get metrics of stream transport
+ *
+ * @tparam Protocol Boost.Asio stream protocol, TCP or local (AF_UNIX) stream protocol
+ * @return Metrics labelled `tcp` or `unix`
+ */
+template <class Protocol>
+transport_metrics& stream_transport_metrics()
+{
+    static transport_metrics instance(std::is_same_v<Protocol, boost::asio::ip::tcp> ? "tcp" : "unix");
+    return instance;
+}
+}
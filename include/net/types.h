@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
@@ -11,4 +12,38 @@ using ip_address_t = std::string;
 //! Transport layer port type
 using port_t = uint16_t;
 
+/** @brief Tuning parameters of device connections */
+struct connection_config
+{
+    size_t initial_recv_buffer_len{1024};    ///< Initial size of receive buffer in bytes
+    size_t max_recv_buffer_len{1024 * 1024}; ///< Maximum size of receive buffer in bytes, i.e. maximum size of one received message
+    size_t max_batch_messages{64};           ///< Maximum number of queued messages sent by one write
+    size_t max_batch_bytes{64 * 1024};       ///< Serialized messages are added to one write until it reaches this size in bytes
+};
+
+/** @brief Tuning parameters of datagram servers */
+struct datagram_config
+{
+    size_t max_datagram_len{8 * 1024}; ///< Maximum size of one datagram in bytes, longer datagrams are truncated and counted as malformed
+    size_t recv_batch{32};             ///< Maximum number of datagrams received by one system call
+    size_t batches_per_wakeup{16};     ///< Maximum number of batches received before other handlers of the io_context get to run
+    size_t socket_recv_buffer_len{0};  ///< Size of socket receive buffer in bytes, 0 keeps system default
+};
+
+/** @brief Tuning parameters of io_uring server */
+struct io_uring_config
+{
+    unsigned queue_entries{256};  ///< Number of submission queue entries, i.e. operations submitted by one system call
+    unsigned buffers_count{1024}; ///< Number of provided receive buffers shared by all connections, rounded up to power of two
+    size_t buffer_len{4096};      ///< Length of one provided receive buffer in bytes
+};
+
+/** @brief Counters of datagram server */
+struct datagram_statistics
+{
+    uint64_t received{0};  ///< Datagrams deserialized to a message
+    uint64_t malformed{0}; ///< Datagrams which are not exactly one serialized message, including truncated datagrams
+    uint64_t dropped{0};   ///< Datagrams dropped by the kernel because the socket receive buffer was full (Linux only)
+};
+
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace hw::storage
+{
+
+/** @brief Writer of values of arbitrary bit width into a sequence of 64-bit words, least significant bits first */
+class bit_writer
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param words_ Output words, cleared
+     */
+    explicit bit_writer(std::vector<uint64_t>& words_)
+        : _words(words_)
+    {
+        _words.clear();
+    }
+
+    /**
+     * @brief Write value
+     *
+     * @param value_ Value, bits above the width are ignored
+     * @param bits_ Width of the value, 1 to 64
+     */
+    void write(uint64_t value_, unsigned bits_)
+    {
+        if (bits_ < 64)
+            value_ &= (uint64_t{1} << bits_) - 1;
+
+        auto offset = _bits % 64;
+        if (offset == 0)
+            _words.push_back(0);
+        _words.back() |= value_ << offset;
+        if (offset + bits_ > 64)
+            _words.push_back(value_ >> (64 - offset));
+        _bits += bits_;
+    }
+
+    //! Write single bit
+    void write_bit(bool bit_) { write(bit_ ? 1 : 0, 1); }
+
+    //! Number of written bits
+    size_t bits() const { return _bits; }
+
+private:
+    std::vector<uint64_t>& _words;
+    size_t _bits{0};
+};
+
+/** @brief Reader of values written by @ref bit_writer */
+class bit_reader
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param words_ Words to read
+     */
+    explicit bit_reader(std::span<const uint64_t> words_)
+        : _words(words_)
+    {}
+
+    /**
+     * @brief Read value
+     *
+     * @param bits_ Width of the value, 1 to 64
+     * @return Value
+     */
+    uint64_t read(unsigned bits_)
+    {
+        auto word   = _bits / 64;
+        auto offset = _bits % 64;
+        auto value  = _words[word] >> offset;
+        if (offset + bits_ > 64)
+            value |= _words[word + 1] << (64 - offset);
+        if (bits_ < 64)
+            value &= (uint64_t{1} << bits_) - 1;
+        _bits += bits_;
+        return value;
+    }
+
+    //! Read single bit
+    bool read_bit() { return read(1) != 0; }
+
+    //! Continue reading at given bit position
+    void seek(size_t bits_) { _bits = bits_; }
+
+private:
+    std::span<const uint64_t> _words;
+    size_t _bits{0};
+};
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <common/types.h>
+
+namespace hw::storage
+{
+
+/**
+ * @brief Append integer to buffer in little endian byte order
+ *
+ * @tparam IntType Type of the integer
+ * @param buffer_ Output buffer
+ * @param value_ Value
+ */
+template <class IntType>
+void put(std::vector<common::byte_t>& buffer_, IntType value_)
+{
+    for (size_t i = 0; i < sizeof(IntType); i++)
+    {
+        buffer_.push_back(static_cast<common::byte_t>(static_cast<uint64_t>(value_) >> (8 * i)));
+    }
+}
+
+/**
+ * @brief Read integer stored in little endian byte order
+ *
+ * @tparam IntType Type of the integer
+ * @param data_ Data, at least `sizeof(IntType)` bytes
+ * @return Value
+ */
+template <class IntType>
+IntType get(const common::byte_t* data_)
+{
+    uint64_t value{0};
+    for (size_t i = 0; i < sizeof(IntType); i++)
+    {
+        value |= static_cast<uint64_t>(data_[i]) << (8 * i);
+    }
+    return static_cast<IntType>(value);
+}
+
+/** @brief Bounds-checked reader of integers and byte strings written by @ref put */
+class byte_reader
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param data_ Data to read
+     */
+    explicit byte_reader(std::span<const common::byte_t> data_)
+        : _data(data_)
+    {}
+
+    /**
+     * @brief Read integer
+     *
+     * @tparam IntType Type of the integer
+     * @param value_ Read value
+     * @return false if there are not enough data, the value is then not changed
+     */
+    template <class IntType>
+    bool read(IntType& value_)
+    {
+        if (remaining() < sizeof(IntType))
+            return false;
+        value_ = get<IntType>(_data.data() + _pos);
+        _pos += sizeof(IntType);
+        return true;
+    }
+
+    /**
+     * @brief Read bytes without copying them
+     *
+     * @param len_ Number of bytes
+     * @param bytes_ Read bytes, valid as long as the data passed to the constructor
+     * @return false if there are not enough data
+     */
+    bool read(size_t len_, std::span<const common::byte_t>& bytes_)
+    {
+        if (remaining() < len_)
+            return false;
+        bytes_ = _data.subspan(_pos, len_);
+        _pos += len_;
+        return true;
+    }
+
+    //! Number of bytes not read yet
+    size_t remaining() const { return _data.size() - _pos; }
+
+private:
+    std::span<const common::byte_t> _data;
+    size_t _pos{0};
+};
+}
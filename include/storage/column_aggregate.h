@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+namespace hw::storage
+{
+
+/** @brief Aggregate of values of one temperature sensor or fan */
+struct column_aggregate
+{
+    size_t count{0};                                    ///< Number of valid values
+    size_t errors{0};                                   ///< Number of values signaling sensor error
+    uint64_t sum{0};                                    ///< Sum of valid values
+    uint16_t min{std::numeric_limits<uint16_t>::max()}; ///< Minimum of valid values
+    uint16_t max{0};                                    ///< Maximum of valid values
+
+    //! Mean of valid values, 0 if there are none
+    double mean() const { return count ? static_cast<double>(sum) / static_cast<double>(count) : 0.0; }
+
+    /**
+     * @brief Merge other aggregate into this one
+     *
+     * @param other_ Aggregate to merge
+     */
+    void merge(const column_aggregate& other_)
+    {
+        count += other_.count;
+        errors += other_.errors;
+        sum += other_.sum;
+        min = std::min(min, other_.min);
+        max = std::max(max, other_.max);
+    }
+};
+
+/**
+ * @brief Aggregate column of sensor values
+ *
+ * @tparam ValueType Type of sensor values
+ * @param column_ Values
+ * @param error_value_ Value signaling sensor error, such values are counted as errors and excluded from aggregate
+ * @param aggregate_ Aggregate the column is merged into
+ */
+template <class ValueType>
+void aggregate_column(std::span<const ValueType> column_, ValueType error_value_, column_aggregate& aggregate_)
+{
+    for (auto value : column_)
+    {
+        if (value == error_value_)
+        {
+            aggregate_.errors++;
+            continue;
+        }
+        aggregate_.count++;
+        aggregate_.sum += value;
+        aggregate_.min = std::min<uint16_t>(aggregate_.min, value);
+        aggregate_.max = std::max<uint16_t>(aggregate_.max, value);
+    }
+}
+}
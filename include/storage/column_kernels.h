@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include <storage/column_aggregate.h>
+
+/**
+ * @brief Vectorized scans of stored sensor value columns.
+ *
+ * Kernels are implemented for SSE4.1 and AVX2 and for plain C++ (scalar). Instruction set is selected at runtime according to the CPU,
+ * on non-x86 platforms scalar kernels are used only. All kernels give identical results.
+ */
+namespace hw::storage::kernels
+{
+
+/** @brief Instruction set kernels are implemented with */
+enum class isa
+{
+    scalar, ///< Plain C++
+    sse4,   ///< SSE4.1, 128-bit vectors
+    avx2,   ///< AVX2, 256-bit vectors
+};
+
+/**
+ * @brief Get the best instruction set supported by the CPU
+ *
+ * @return Instruction set, detected once
+ */
+isa best_isa();
+
+/**
+ * @brief Check whether the CPU supports instruction set
+ *
+ * @param isa_ Instruction set
+ * @return true if kernels of the instruction set can be used
+ */
+bool supported(isa isa_);
+
+/**
+ * @brief Get name of instruction set
+ *
+ * @param isa_ Instruction set
+ * @return Name
+ */
+const char* isa_name(isa isa_);
+
+/**
+ * @brief Aggregate column of temperatures
+ *
+ * @param column_ Values
+ * @param error_value_ Value signaling sensor error, such values are counted as errors and excluded from aggregate
+ * @param aggregate_ Aggregate the column is merged into
+ * @param isa_ Instruction set, scalar kernel is used if it is not supported
+ */
+void aggregate(std::span<const uint16_t> column_, uint16_t error_value_, column_aggregate& aggregate_, isa isa_ = best_isa());
+
+/**
+ * @brief Aggregate column of fan speeds
+ *
+ * @param column_ Values
+ * @param error_value_ Value signaling fan error, such values are counted as errors and excluded from aggregate
+ * @param aggregate_ Aggregate the column is merged into
+ * @param isa_ Instruction set, scalar kernel is used if it is not supported
+ */
+void aggregate(std::span<const uint8_t> column_, uint8_t error_value_, column_aggregate& aggregate_, isa isa_ = best_isa());
+
+/**
+ * @brief Count temperatures above threshold
+ *
+ * @param column_ Values
+ * @param threshold_ Threshold
+ * @param error_value_ Value signaling sensor error, such values are not counted
+ * @param isa_ Instruction set, scalar kernel is used if it is not supported
+ * @return Number of valid values greater than threshold
+ */
+size_t count_above(std::span<const uint16_t> column_, uint16_t threshold_, uint16_t error_value_, isa isa_ = best_isa());
+
+/**
+ * @brief Count fan speeds above threshold
+ *
+ * @param column_ Values
+ * @param threshold_ Threshold
+ * @param error_value_ Value signaling fan error, such values are not counted
+ * @param isa_ Instruction set, scalar kernel is used if it is not supported
+ * @return Number of valid values greater than threshold
+ */
+size_t count_above(std::span<const uint8_t> column_, uint8_t threshold_, uint8_t error_value_, isa isa_ = best_isa());
+}
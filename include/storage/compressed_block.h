@@ -0,0 +1,280 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <device_control_messages/measurement.h>
+#include <common/types.h>
+#include <storage/bit_stream.h>
+#include <storage/byte_stream.h>
+#include <storage/column_aggregate.h>
+#include <storage/measurement_block.h>
+#include <storage/types.h>
+
+namespace hw::storage
+{
+
+/**
+ * @brief Immutable compressed block of measurements of the same shape.
+ *
+ * A full @ref measurement_block is sealed into a compressed block. All columns are encoded one after another into a single bit stream:
+ *  - timestamps are stored as delta-of-delta, a zero takes one bit and other values take 12, 20, 32 or 64 bits plus a short prefix, so
+ *    periodic reports received with small jitter cost a few bits each,
+ *  - values of every temperature sensor and fan are stored as zigzag-encoded deltas bit-packed to the width of the largest delta of the
+ *    column. An unchanged value takes one bit and a column which does not change at all takes no bits per measurement.
+ *
+ * Measurements are read one at a time by @ref row_cursor or all at once by decoding the block into a @ref measurement_block, see
+ * @ref decode. Scans of a single column decode only that column into a small fixed buffer, see @ref visit_temperatures. Blocks of at least @ref indexed_size measurements also keep position and
+ * aggregate of every column computed when the block is sealed, so a column is decoded without skipping the preceding ones and whole-block
+ * aggregates need no decoding at all. Oldest measurements can be dropped in constant time, the block is released once all of them are
+ * dropped.
+ */
+class compressed_block
+{
+public:
+    static constexpr size_t decode_chunk = 256; //!< Number of values passed at once by column visits
+    static constexpr size_t indexed_size = 64;  //!< Smaller blocks keep no column positions and aggregates, they are cheap to decode
+
+    class row_cursor;
+
+    /**
+     * @brief Constructor, encodes measurements of block
+     *
+     * @param block_ Block to encode
+     * @param buffer_ Scratch buffer reused between encodings
+     * @param resource_ Memory resource the encoded data are allocated from
+     */
+    compressed_block(const measurement_block& block_, std::vector<uint64_t>& buffer_, std::pmr::memory_resource* resource_);
+
+    /**
+     * @brief Decode stored measurements
+     *
+     * @param block_ Output block, reset to the shape of this block. Capacity must be at least the number of encoded measurements.
+     */
+    void decode(measurement_block& block_) const;
+
+    /**
+     * @brief Append encoded block to buffer, e.g. to checkpoint it, see @ref load
+     *
+     * @param buffer_ Output buffer
+     */
+    void save(std::vector<common::byte_t>& buffer_) const;
+
+    /**
+     * @brief Read block written by @ref save
+     *
+     * @param reader_ Reader positioned at the block
+     * @param resource_ Memory resource the encoded data are allocated from
+     * @return Block, std::nullopt if the data are malformed
+     */
+    static std::optional<compressed_block> load(byte_reader& reader_, std::pmr::memory_resource* resource_);
+
+    /**
+     * @brief Decode values of temperature sensor of stored measurements in order of reception, without decoding other columns
+     *
+     * @tparam Visitor Callable accepting `std::span<const uint16_t>` of at most @ref decode_chunk values
+     * @param sensor_ Index of temperature sensor
+     * @param visitor_ Visitor
+     */
+    template <class Visitor>
+    void visit_temperatures(size_t sensor_, Visitor&& visitor_) const
+    {
+        visit_column<uint16_t>(sensor_, visitor_);
+    }
+
+    /**
+     * @brief Decode speeds of fan of stored measurements in order of reception, without decoding other columns
+     *
+     * @tparam Visitor Callable accepting `std::span<const uint8_t>` of at most @ref decode_chunk values
+     * @param fan_ Index of fan
+     * @param visitor_ Visitor
+     */
+    template <class Visitor>
+    void visit_fans(size_t fan_, Visitor&& visitor_) const
+    {
+        visit_column<uint8_t>(_temperatures_count + fan_, visitor_);
+    }
+
+    /**
+     * @brief Get aggregate of values of temperature sensor computed when the block was sealed
+     *
+     * @param sensor_ Index of temperature sensor
+     * @return Aggregate of all stored measurements, std::nullopt if some measurements were dropped since or the block is not indexed
+     */
+    std::optional<column_aggregate> temperature_aggregate(size_t sensor_) const
+    {
+        return _first == 0 && !_columns.empty() ? std::optional(_columns[sensor_].aggregate) : std::nullopt;
+    }
+
+    /**
+     * @brief Get aggregate of speeds of fan computed when the block was sealed
+     *
+     * @param fan_ Index of fan
+     * @return Aggregate of all stored measurements, std::nullopt if some measurements were dropped since or the block is not indexed
+     */
+    std::optional<column_aggregate> fan_aggregate(size_t fan_) const
+    {
+        return _first == 0 && !_columns.empty() ? std::optional(_columns[_temperatures_count + fan_].aggregate) : std::nullopt;
+    }
+
+    /**
+     * @brief Count stored measurements received in time range, only timestamps are decoded
+     *
+     * @param from_ Start of the range, inclusive
+     * @param to_ End of the range, exclusive
+     * @return Number of measurements
+     */
+    size_t count_between(timestamp_t from_, timestamp_t to_) const;
+
+    /**
+     * @brief Drop stored measurements received before given time.
+     * Only timestamps are decoded, they are not decoded at all when the oldest stored measurement is not older than the time.
+     *
+     * @param timestamp_ Time
+     * @return Number of dropped measurements
+     */
+    size_t drop_front_before(timestamp_t timestamp_);
+
+    /**
+     * @brief Drop oldest measurements
+     *
+     * @param count_ Number of measurements to drop
+     */
+    void drop_front(size_t count_) { _first += std::min(count_, size()); }
+
+    //! Number of stored measurements
+    size_t size() const { return _count - _first; }
+    //! Check whether there are no stored measurements
+    bool empty() const { return size() == 0; }
+    //! Number of temperature sensors of stored measurements
+    size_t temperatures_count() const { return _temperatures_count; }
+    //! Number of fans of stored measurements
+    size_t fans_count() const { return _fans_count; }
+    //! Reception time of the newest measurement
+    timestamp_t last_timestamp() const { return _last_timestamp; }
+    //! Lower bound of reception times of stored measurements
+    timestamp_t first_timestamp() const { return _first_timestamp; }
+    //! Memory occupied by encoded data and column aggregates in bytes
+    size_t memory_size() const { return _words.size() * sizeof(uint64_t) + _columns.size() * sizeof(column); }
+
+private:
+    // Aggregate and position in bit stream of column of temperature sensor or fan
+    struct column
+    {
+        column_aggregate aggregate;
+        size_t offset;
+    };
+
+    // Position of sequential decoding of one column
+    struct column_cursor
+    {
+        bit_reader reader;
+        int64_t value;
+        unsigned width;
+        size_t index;
+    };
+
+private:
+    // Constructor of empty block filled by load(...)
+    explicit compressed_block(std::pmr::memory_resource* resource_)
+        : _words(resource_)
+        , _columns(resource_)
+    {}
+
+    // Start decoding of column, columns of fans follow columns of temperature sensors. Preceding columns are skipped if block is not indexed.
+    column_cursor open_column(size_t column_, unsigned value_bits_) const;
+    // Start decoding of column of given number of values at position of reader
+    static column_cursor start_column(bit_reader reader_, unsigned value_bits_, size_t count_);
+    // Decode next value of column into cursor
+    static void advance_column(column_cursor& cursor_);
+    // Decode next values of column
+    template <class ValueType>
+    static void read_column(column_cursor& cursor_, ValueType* values_, size_t count_);
+
+    // Implementation of visit_temperatures(...) and visit_fans(...), dropped measurements are decoded and skipped
+    template <class ValueType, class Visitor>
+    void visit_column(size_t column_, Visitor& visitor_) const
+    {
+        std::array<ValueType, decode_chunk> values;
+        auto cursor = open_column(column_, sizeof(ValueType) * 8);
+        for (size_t index = 0; index < _count;)
+        {
+            auto count = std::min(decode_chunk, _count - index);
+            read_column(cursor, values.data(), count);
+            auto skip = index < _first ? std::min(_first - index, count) : 0;
+            if (skip < count)
+                visitor_(std::span<const ValueType>(values.data() + skip, count - skip));
+            index += count;
+        }
+    }
+
+private:
+    size_t _count{0};
+    size_t _first{0};
+    size_t _temperatures_count{0};
+    size_t _fans_count{0};
+    timestamp_t _first_timestamp{0};
+    timestamp_t _last_timestamp{0};
+    std::pmr::vector<uint64_t> _words;
+    std::pmr::vector<column> _columns;
+};
+
+/**
+ * @brief Sequential decoder of measurements stored in @ref compressed_block, one measurement at a time.
+ *
+ * All columns are decoded side by side, so no block of measurements is materialized. Positions of up to @ref inline_columns columns are
+ * kept inside the cursor, only measurements with more sensors and fans allocate. The block must outlive the cursor.
+ */
+class compressed_block::row_cursor
+{
+public:
+    static constexpr size_t inline_columns = 32; //!< Number of temperature sensors and fans decoded without allocation
+
+    /**
+     * @brief Constructor, the cursor is placed before the oldest stored measurement
+     *
+     * @param block_ Block to decode
+     */
+    explicit row_cursor(const compressed_block& block_);
+
+    row_cursor(const row_cursor&)            = delete;
+    row_cursor& operator=(const row_cursor&) = delete;
+
+    /**
+     * @brief Move to next stored measurement
+     *
+     * @return false if all stored measurements were visited
+     */
+    bool next();
+
+    //! Reception time of current measurement
+    timestamp_t timestamp() const { return _timestamp; }
+    //! Number of temperature sensors
+    size_t temperatures_count() const { return _block._temperatures_count; }
+    //! Value of given temperature sensor of current measurement
+    uint16_t temperature(size_t sensor_) const { return static_cast<uint16_t>(_columns[sensor_].value); }
+    //! Number of fans
+    size_t fans_count() const { return _block._fans_count; }
+    //! Speed of given fan of current measurement
+    uint8_t fan_speed(size_t fan_) const { return static_cast<uint8_t>(_columns[_block._temperatures_count + fan_].value); }
+
+    //! Copy current measurement into message
+    device_control_messages::measurement to_message(const std::string& device_name_) const;
+
+private:
+    const compressed_block& _block;
+    bit_reader _timestamps;
+    timestamp_t _timestamp{0};
+    int64_t _delta{0};
+    size_t _index{0};
+    alignas(column_cursor) std::array<std::byte, inline_columns * sizeof(column_cursor)> _buffer;
+    std::pmr::monotonic_buffer_resource _resource;
+    std::pmr::vector<column_cursor> _columns;
+};
+}
@@ -0,0 +1,400 @@
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <common/types.h>
+#include <device_control_messages/messages.h>
+#include <storage/byte_stream.h>
+#include <storage/column_aggregate.h>
+#include <storage/compressed_block.h>
+#include <storage/measurement_block.h>
+#include <storage/message_view.h>
+#include <storage/retention_policy.h>
+#include <storage/types.h>
+
+namespace hw::storage
+{
+
+/**
+ * @brief History of messages received from one device
+ *
+ * Measurements are stored in chunks of columnar @ref measurement_block blocks, a new block is started when the current one is full or when
+ * the shape of measurements (number of sensors and fans) changes. Error messages are rare and are stored in a separate list together with
+ * their position in the measurement sequence, so the original order of messages can be reconstructed.
+ *
+ * Reception timestamps of stored messages never decrease (a timestamp older than the previous one, e.g. after a wall clock adjustment, is
+ * raised to the previous one), so blocks and errors are ordered by time. Time-range queries binary-search the blocks by their first and
+ * last timestamp and then the timestamps within the boundary blocks, they never walk the whole history.
+ *
+ * Stored history is bounded by @ref retention_policy. Blocks act as fixed-capacity segments: oldest measurements are dropped from the front
+ * block in constant time and an emptied block is kept for reuse, so eviction neither frees nor allocates memory in the steady state.
+ *
+ * Optionally, full blocks are sealed into immutable @ref compressed_block blocks and only the block being filled is kept uncompressed.
+ * Queries decode sealed blocks one at a time while scanning, so they see the same columns regardless of compression.
+ *
+ * Segments of blocks, blocks and errors are allocated from the memory resource passed to the constructor, typically a pool shared by
+ * histories of several devices. A segment released by eviction is then reused by any of them instead of going back to the heap.
+ */
+class device_history
+{
+public:
+    /** @brief Stored error message */
+    struct stored_error
+    {
+        timestamp_t timestamp;                               ///< Time of reception
+        device_control_messages::error::error_type err_type; ///< Error type
+        size_t measurement_position;                         ///< Number of measurements received before the error
+    };
+
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param block_capacity_ Number of measurements in one block
+     * @param retention_ Limits of stored history
+     * @param resource_ Memory resource stored messages are allocated from, must outlive the history
+     * @param compress_ Seal full blocks into compressed blocks
+     */
+    device_history(size_t block_capacity_,
+                   const retention_policy& retention_ = {},
+                   std::pmr::memory_resource* resource_ = std::pmr::get_default_resource(),
+                   bool compress_ = false)
+        : _block_capacity(block_capacity_)
+        , _retention(retention_)
+        , _resource(resource_)
+        , _compress(compress_)
+        , _sealed(resource_)
+        , _blocks(resource_)
+        , _errors(resource_)
+    {}
+
+    /**
+     * @brief Append measurement
+     *
+     * @param timestamp_ Time of reception
+     * @param measurement_ Measurement
+     */
+    void append(timestamp_t timestamp_, const device_control_messages::measurement& measurement_);
+
+    /**
+     * @brief Append error
+     *
+     * @param timestamp_ Time of reception
+     * @param error_ Error
+     */
+    void append(timestamp_t timestamp_, const device_control_messages::error& error_);
+
+    /**
+     * @brief Evict messages exceeding retention limits. Called automatically when a message is appended.
+     *
+     * @param now_ Current time used for evaluating maximum age
+     */
+    void enforce_retention(timestamp_t now_);
+
+    /**
+     * @brief Append stored history to buffer, e.g. to checkpoint it, see @ref load
+     *
+     * @param buffer_ Output buffer
+     */
+    void save(std::vector<common::byte_t>& buffer_) const;
+
+    /**
+     * @brief Replace stored history with history written by @ref save. Sealed blocks are restored as they were, blocks being filled are
+     * appended again, so they adapt to block capacity of this history. Retention limits are not applied.
+     *
+     * @param data_ Saved history
+     * @return false if the data are malformed, the history is then incomplete
+     */
+    bool load(std::span<const common::byte_t> data_);
+
+    /**
+     * @brief Visit stored measurements in order of reception without copying them
+     *
+     * @tparam Visitor Callable accepting `const measurement_view&`
+     * @param device_name_ Name of the device
+     * @param visitor_ Visitor
+     */
+    template <class Visitor>
+    void for_each_measurement(const std::string& device_name_, Visitor&& visitor_) const
+    {
+        visit_measurements(device_name_, std::numeric_limits<timestamp_t>::min(), [&](const measurement_view& view_) {
+            visitor_(view_);
+            return true;
+        });
+    }
+
+    /**
+     * @brief Visit stored errors in order of reception without copying them
+     *
+     * @tparam Visitor Callable accepting `const error_view&`
+     * @param device_name_ Name of the device
+     * @param visitor_ Visitor
+     */
+    template <class Visitor>
+    void for_each_error(const std::string& device_name_, Visitor&& visitor_) const
+    {
+        for (const auto& err : _errors)
+        {
+            visitor_(error_view(device_name_, err.timestamp, err.err_type));
+        }
+    }
+
+    /**
+     * @brief Visit all stored messages in order of reception without copying them
+     *
+     * @tparam Visitor Callable accepting both `const measurement_view&` and `const error_view&`
+     * @param device_name_ Name of the device
+     * @param visitor_ Visitor
+     */
+    template <class Visitor>
+    void for_each_message(const std::string& device_name_, Visitor&& visitor_) const
+    {
+        auto next_error   = _errors.begin();
+        auto visit_errors = [&](size_t position_) {
+            for (; next_error != _errors.end() && next_error->measurement_position <= position_; next_error++)
+            {
+                visitor_(error_view(device_name_, next_error->timestamp, next_error->err_type));
+            }
+        };
+
+        size_t position{_measurements_evicted};
+        visit_measurements(device_name_, std::numeric_limits<timestamp_t>::min(), [&](const measurement_view& view_) {
+            visit_errors(position++);
+            visitor_(view_);
+            return true;
+        });
+        visit_errors(position);
+    }
+
+    /**
+     * @brief Visit stored messages received in time range in order of reception without copying them
+     *
+     * @tparam Visitor Callable accepting both `const measurement_view&` and `const error_view&`
+     * @param device_name_ Name of the device
+     * @param from_ Start of the range, inclusive
+     * @param to_ End of the range, exclusive
+     * @param visitor_ Visitor
+     */
+    template <class Visitor>
+    void for_each_message_between(const std::string& device_name_, timestamp_t from_, timestamp_t to_, Visitor&& visitor_) const
+    {
+        auto next_error   = first_error_at(from_);
+        auto visit_errors = [&](timestamp_t until_) {
+            for (; next_error != _errors.end() && next_error->timestamp <= until_ && next_error->timestamp < to_; next_error++)
+            {
+                visitor_(error_view(device_name_, next_error->timestamp, next_error->err_type));
+            }
+        };
+
+        visit_measurements(device_name_, from_, [&](const measurement_view& view_) {
+            if (view_.timestamp() >= to_)
+                return false;
+            visit_errors(view_.timestamp());
+            visitor_(view_);
+            return true;
+        });
+        visit_errors(to_);
+    }
+
+    /**
+     * @brief Count stored messages received in time range
+     *
+     * @param from_ Start of the range, inclusive
+     * @param to_ End of the range, exclusive
+     * @return Number of messages
+     */
+    size_t count_between(timestamp_t from_, timestamp_t to_) const;
+
+    /**
+     * @brief Reconstruct stored messages in order of reception
+     *
+     * @param device_name_ Name of the device
+     * @return Messages
+     */
+    std::vector<device_control_messages::device_message_type> messages(const std::string& device_name_) const;
+
+    /**
+     * @brief Reconstruct stored measurements
+     *
+     * @param device_name_ Name of the device
+     * @param messages_ Output vector measurements are appended to
+     */
+    void messages(const std::string& device_name_, std::vector<device_control_messages::measurement>& messages_) const;
+
+    /**
+     * @brief Reconstruct stored errors
+     *
+     * @param device_name_ Name of the device
+     * @param messages_ Output vector errors are appended to
+     */
+    void messages(const std::string& device_name_, std::vector<device_control_messages::error>& messages_) const;
+
+    /**
+     * @brief Aggregate values of temperature sensor over whole history
+     *
+     * @param sensor_ Index of temperature sensor
+     * @return Aggregate, measurements without given sensor are skipped
+     */
+    column_aggregate aggregate_temperature(size_t sensor_) const;
+
+    /**
+     * @brief Aggregate speeds of fan over whole history
+     *
+     * @param fan_ Index of fan
+     * @return Aggregate, measurements without given fan are skipped
+     */
+    column_aggregate aggregate_fan_speed(size_t fan_) const;
+
+    /**
+     * @brief Count values of temperature sensor above threshold over whole history
+     *
+     * @param sensor_ Index of temperature sensor
+     * @param threshold_ Threshold
+     * @return Number of valid values greater than threshold
+     */
+    size_t count_temperature_above(size_t sensor_, uint16_t threshold_) const;
+
+    /**
+     * @brief Count speeds of fan above threshold over whole history
+     *
+     * @param fan_ Index of fan
+     * @param threshold_ Threshold
+     * @return Number of valid values greater than threshold
+     */
+    size_t count_fan_speed_above(size_t fan_, uint8_t threshold_) const;
+
+    //! Number of stored messages
+    size_t size() const { return measurements_count() + _errors.size(); }
+    //! Number of stored measurements
+    size_t measurements_count() const { return _measurements_count - _measurements_evicted; }
+    //! Memory occupied by stored messages in bytes
+    size_t memory_size() const { return _blocks_memory + _errors.size() * sizeof(stored_error); }
+    //! Reception time of the newest message ever appended, messages appended later are never older
+    timestamp_t last_timestamp() const { return _last_timestamp; }
+
+    /**
+     * @brief Get lower bound of reception times of stored messages
+     *
+     * @return Time, std::nullopt if no message is stored
+     */
+    std::optional<timestamp_t> oldest_timestamp() const
+    {
+        std::optional<timestamp_t> oldest;
+        auto consider = [&oldest](timestamp_t timestamp_) { oldest = std::min(oldest.value_or(timestamp_), timestamp_); };
+
+        if (!_errors.empty())
+            consider(_errors.front().timestamp);
+        if (!_sealed.empty())
+            consider(_sealed.front().first_timestamp());
+        else if (auto block = std::find_if(_blocks.begin(), _blocks.end(), [](const measurement_block& block_) { return !block_.empty(); });
+                 block != _blocks.end())
+            consider(block->timestamps().front());
+        return oldest;
+    }
+
+    //! Number of blocks of measurements, sealed and not sealed
+    size_t blocks_count() const { return _sealed.size() + _blocks.size(); }
+    //! Number of sealed compressed blocks of measurements
+    size_t sealed_blocks_count() const { return _sealed.size(); }
+    //! Stored errors in order of reception
+    const std::pmr::deque<stored_error>& errors() const { return _errors; }
+
+private:
+    // Visit measurements received at or after given time in order of reception, stop when the function returns false. Sealed blocks are
+    // decoded one measurement at a time by a cursor, so visits do not allocate. Scans of columns use scan_temperatures(...) and
+    // scan_fans(...) which decode only the scanned column.
+    template <class Func>
+    void visit_measurements(const std::string& device_name_, timestamp_t from_, Func&& func_) const
+    {
+        for (auto sealed = first_sealed_at(from_); sealed != _sealed.end(); sealed++)
+        {
+            compressed_block::row_cursor cursor(*sealed);
+            while (cursor.next())
+            {
+                if (cursor.timestamp() >= from_ && !func_(measurement_view(device_name_, cursor)))
+                    return;
+            }
+        }
+        for (auto block = first_block_at(from_); block != _blocks.end(); block++)
+        {
+            for (auto row = first_row_at(*block, from_); row < block->size(); row++)
+            {
+                if (!func_(measurement_view(device_name_, *block, row)))
+                    return;
+            }
+        }
+    }
+
+    // Pass values of temperature sensor of all stored measurements to values_ in chunks. Aggregate of each sealed block which has not been
+    // trimmed by retention is passed to whole_ first, the block is decoded (column by column into a fixed buffer) only if it returns false.
+    template <class Whole, class Values>
+    void scan_temperatures(size_t sensor_, Whole&& whole_, Values&& values_) const;
+    // Pass speeds of fan of all stored measurements to values_ in chunks, see scan_temperatures(...)
+    template <class Whole, class Values>
+    void scan_fans(size_t fan_, Whole&& whole_, Values&& values_) const;
+
+    // First sealed block containing measurements received at or after given time
+    std::pmr::deque<compressed_block>::const_iterator first_sealed_at(timestamp_t timestamp_) const
+    {
+        return std::partition_point(
+            _sealed.begin(), _sealed.end(), [timestamp_](const compressed_block& block_) { return block_.last_timestamp() < timestamp_; });
+    }
+
+    // First block containing measurements received at or after given time
+    std::pmr::deque<measurement_block>::const_iterator first_block_at(timestamp_t timestamp_) const
+    {
+        return std::partition_point(_blocks.begin(), _blocks.end(), [timestamp_](const measurement_block& block_) {
+            return !block_.empty() && block_.timestamps().back() < timestamp_;
+        });
+    }
+
+    // Index of first measurement of block received at or after given time
+    static size_t first_row_at(const measurement_block& block_, timestamp_t timestamp_)
+    {
+        auto timestamps = block_.timestamps();
+        return static_cast<size_t>(std::lower_bound(timestamps.begin(), timestamps.end(), timestamp_) - timestamps.begin());
+    }
+
+    // First error received at or after given time
+    std::pmr::deque<stored_error>::const_iterator first_error_at(timestamp_t timestamp_) const
+    {
+        return std::partition_point(_errors.begin(), _errors.end(), [timestamp_](const stored_error& err_) { return err_.timestamp < timestamp_; });
+    }
+
+    // Check whether the oldest stored message is error
+    bool oldest_is_error() const;
+    // Get block the measurement is appended to, start new block if the current one is full or has different shape
+    measurement_block& block_for(const device_control_messages::measurement& measurement_);
+    // Evict the oldest stored message
+    void evict_oldest();
+    // Evict the oldest block of measurements
+    void evict_oldest_block();
+    // Remove emptied block from the front, keep it for reuse
+    void recycle_front_block();
+    // Remove emptied sealed block from the front
+    void release_front_sealed();
+
+private:
+    size_t _block_capacity;
+    retention_policy _retention;
+    std::pmr::memory_resource* _resource;
+    bool _compress;
+    size_t _measurements_count{0};
+    size_t _measurements_evicted{0};
+    size_t _blocks_memory{0};
+    timestamp_t _last_timestamp{std::numeric_limits<timestamp_t>::min()};
+    std::pmr::deque<compressed_block> _sealed;
+    std::pmr::deque<measurement_block> _blocks;
+    std::optional<measurement_block> _spare_block;
+    std::pmr::deque<stored_error> _errors;
+    std::vector<uint64_t> _encode_buffer;
+};
+}
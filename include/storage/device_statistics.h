@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <variant>
+
+#include <device_control_messages/messages.h>
+
+namespace hw::storage
+{
+
+/** @brief Numbers of messages received from one device */
+struct device_statistics
+{
+    size_t measurements{0};                                                                 ///< Number of measurement messages
+    size_t errors{0};                                                                       ///< Number of error messages
+    std::array<size_t, device_control_messages::error::error_types_count> errors_by_type{}; ///< Number of error messages per error type
+
+    /**
+     * @brief Count new message
+     *
+     * @param message_ Received message
+     */
+    void record(const device_control_messages::device_message_type& message_)
+    {
+        if (auto err = std::get_if<device_control_messages::error>(&message_))
+        {
+            errors++;
+            errors_by_type[static_cast<size_t>(err->err_type)]++;
+        }
+        else
+        {
+            measurements++;
+        }
+    }
+
+    /**
+     * @brief Get number of messages of given type
+     *
+     * @tparam MessageType Type of messages
+     * @return Number of messages
+     */
+    template <class MessageType>
+    size_t count() const
+    {
+        if constexpr (std::is_same_v<MessageType, device_control_messages::error>)
+            return errors;
+        else
+            return measurements;
+    }
+
+    /**
+     * @brief Get number of error messages of given error type
+     *
+     * @param err_type_ Error type
+     * @return Number of messages
+     */
+    size_t count(device_control_messages::error::error_type err_type_) const { return errors_by_type[static_cast<size_t>(err_type_)]; }
+
+    //! Total number of messages
+    size_t total() const { return measurements + errors; }
+};
+}
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <utility>
+
+#include <device_control_messages/measurement.h>
+#include <storage/types.h>
+
+namespace hw::storage
+{
+
+/**
+ * @brief Append-only columnar block of measurements of the same shape.
+ *
+ * All measurements in a block have the same number of temperature sensors and fans. Every temperature sensor and every fan has its own
+ * contiguous column, timestamps are stored in a separate column. All columns are laid out in one segment allocated for the full block
+ * capacity up front from given memory resource, so a block costs a single allocation and appending never allocates.
+ *
+ * Oldest measurements can be dropped from the front of the block in constant time. The segment is returned to the memory resource (or the
+ * block is reused by @ref reset) only once all of its measurements are dropped.
+ */
+class measurement_block
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param temperatures_count_ Number of temperature sensors of stored measurements
+     * @param fans_count_ Number of fans of stored measurements
+     * @param capacity_ Maximum number of stored measurements
+     * @param resource_ Memory resource the segment of columns is allocated from
+     */
+    measurement_block(size_t temperatures_count_,
+                      size_t fans_count_,
+                      size_t capacity_,
+                      std::pmr::memory_resource* resource_ = std::pmr::get_default_resource())
+        : _capacity(capacity_)
+        , _resource(resource_)
+    {
+        reset(temperatures_count_, fans_count_);
+    }
+
+    measurement_block(measurement_block&& other_) noexcept
+        : _capacity(other_._capacity)
+        , _resource(other_._resource)
+        , _segment(std::exchange(other_._segment, nullptr))
+        , _segment_size(std::exchange(other_._segment_size, 0))
+        , _first(std::exchange(other_._first, 0))
+        , _size(std::exchange(other_._size, 0))
+        , _temperatures_count(std::exchange(other_._temperatures_count, 0))
+        , _fans_count(std::exchange(other_._fans_count, 0))
+    {}
+
+    measurement_block& operator=(measurement_block&& other_) noexcept
+    {
+        if (this != &other_)
+        {
+            release();
+            _capacity           = other_._capacity;
+            _resource           = other_._resource;
+            _segment            = std::exchange(other_._segment, nullptr);
+            _segment_size       = std::exchange(other_._segment_size, 0);
+            _first              = std::exchange(other_._first, 0);
+            _size               = std::exchange(other_._size, 0);
+            _temperatures_count = std::exchange(other_._temperatures_count, 0);
+            _fans_count         = std::exchange(other_._fans_count, 0);
+        }
+        return *this;
+    }
+
+    measurement_block(const measurement_block&) = delete;
+    measurement_block& operator=(const measurement_block&) = delete;
+
+    ~measurement_block() { release(); }
+
+    /**
+     * @brief Drop all measurements and prepare the block for measurements of given shape.
+     * The segment is reused, no allocation takes place if the shape does not change.
+     *
+     * @param temperatures_count_ Number of temperature sensors of stored measurements
+     * @param fans_count_ Number of fans of stored measurements
+     */
+    void reset(size_t temperatures_count_, size_t fans_count_)
+    {
+        _first              = 0;
+        _size               = 0;
+        _temperatures_count = temperatures_count_;
+        _fans_count         = fans_count_;
+
+        auto segment_size = _capacity * row_size(temperatures_count_, fans_count_);
+        if (segment_size != _segment_size)
+        {
+            release();
+            _segment      = static_cast<std::byte*>(_resource->allocate(segment_size, alignof(timestamp_t)));
+            _segment_size = segment_size;
+        }
+    }
+
+    /**
+     * @brief Check whether measurement can be appended to this block
+     *
+     * @param measurement_ Measurement
+     * @return true if the block is not full and the measurement has the shape of the block
+     */
+    bool accepts(const device_control_messages::measurement& measurement_) const
+    {
+        return !full() && measurement_.temperature_sensors.size() == _temperatures_count && measurement_.fans_speed.size() == _fans_count;
+    }
+
+    /**
+     * @brief Append measurement, @ref accepts must be true for the measurement
+     *
+     * @param timestamp_ Time of reception
+     * @param measurement_ Measurement
+     */
+    void append(timestamp_t timestamp_, const device_control_messages::measurement& measurement_)
+    {
+        timestamps_column()[_size] = timestamp_;
+        for (size_t i = 0; i < _temperatures_count; i++)
+        {
+            temperatures_column(i)[_size] = measurement_.temperature_sensors[i];
+        }
+        for (size_t i = 0; i < _fans_count; i++)
+        {
+            fans_column(i)[_size] = measurement_.fans_speed[i];
+        }
+        _size++;
+    }
+
+    /**
+     * @brief Mark first measurements of the block as stored after their values were written directly to columns, e.g. by a decoder.
+     * Columns are filled through @ref timestamps_data, @ref temperatures_data and @ref fans_data.
+     *
+     * @param size_ Number of stored measurements, at most the capacity
+     */
+    void set_size(size_t size_)
+    {
+        _first = 0;
+        _size  = std::min(size_, _capacity);
+    }
+
+    //! Writable column of reception timestamps of full block capacity
+    timestamp_t* timestamps_data() { return timestamps_column(); }
+    //! Writable column of values of given temperature sensor of full block capacity
+    uint16_t* temperatures_data(size_t sensor_) { return temperatures_column(sensor_); }
+    //! Writable column of speeds of given fan of full block capacity
+    uint8_t* fans_data(size_t fan_) { return fans_column(fan_); }
+
+    /**
+     * @brief Reconstruct stored measurement
+     *
+     * @param row_ Index of measurement in the block
+     * @param device_name_ Name of the device the block belongs to
+     * @return Measurement message
+     */
+    device_control_messages::measurement row(size_t row_, const std::string& device_name_) const
+    {
+        device_control_messages::measurement measurement(device_name_);
+        measurement.temperature_sensors.reserve(_temperatures_count);
+        for (size_t i = 0; i < _temperatures_count; i++)
+        {
+            measurement.temperature_sensors.push_back(temperatures(i)[row_]);
+        }
+        measurement.fans_speed.reserve(_fans_count);
+        for (size_t i = 0; i < _fans_count; i++)
+        {
+            measurement.fans_speed.push_back(fans(i)[row_]);
+        }
+        return measurement;
+    }
+
+    /**
+     * @brief Drop oldest measurements
+     *
+     * @param count_ Number of measurements to drop
+     */
+    void drop_front(size_t count_) { _first += std::min(count_, size()); }
+
+    //! Number of stored measurements
+    size_t size() const { return _size - _first; }
+    //! Check whether there are no stored measurements
+    bool empty() const { return size() == 0; }
+    //! Check whether block is full
+    bool full() const { return _size >= _capacity; }
+    //! Maximum number of stored measurements
+    size_t capacity() const { return _capacity; }
+    //! Number of temperature sensors of stored measurements
+    size_t temperatures_count() const { return _temperatures_count; }
+    //! Number of fans of stored measurements
+    size_t fans_count() const { return _fans_count; }
+    //! Memory occupied by columns in bytes
+    size_t memory_size() const { return _segment_size; }
+
+    //! Column of reception timestamps
+    std::span<const timestamp_t> timestamps() const { return {timestamps_column() + _first, size()}; }
+    //! Column of values of given temperature sensor
+    std::span<const uint16_t> temperatures(size_t sensor_) const { return {temperatures_column(sensor_) + _first, size()}; }
+    //! Column of speeds of given fan
+    std::span<const uint8_t> fans(size_t fan_) const { return {fans_column(fan_) + _first, size()}; }
+
+private:
+    // Bytes occupied by one measurement in all columns. Columns are ordered by alignment, so no padding is needed between them.
+    static size_t row_size(size_t temperatures_count_, size_t fans_count_)
+    {
+        return sizeof(timestamp_t) + temperatures_count_ * sizeof(uint16_t) + fans_count_ * sizeof(uint8_t);
+    }
+
+    timestamp_t* timestamps_column() const { return reinterpret_cast<timestamp_t*>(_segment); }
+    uint16_t* temperatures_column(size_t sensor_) const
+    {
+        return reinterpret_cast<uint16_t*>(_segment + _capacity * sizeof(timestamp_t)) + sensor_ * _capacity;
+    }
+    uint8_t* fans_column(size_t fan_) const
+    {
+        return reinterpret_cast<uint8_t*>(_segment + _capacity * (sizeof(timestamp_t) + _temperatures_count * sizeof(uint16_t))) + fan_ * _capacity;
+    }
+
+    // Return the segment to the memory resource
+    void release()
+    {
+        if (_segment)
+            _resource->deallocate(_segment, _segment_size, alignof(timestamp_t));
+        _segment      = nullptr;
+        _segment_size = 0;
+    }
+
+private:
+    size_t _capacity;
+    std::pmr::memory_resource* _resource;
+    std::byte* _segment{nullptr};
+    size_t _segment_size{0};
+    size_t _first{0};
+    size_t _size{0};
+    size_t _temperatures_count{0};
+    size_t _fans_count{0};
+};
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <compare>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <common/types.h>
+#include <device_control_messages/messages.h>
+#include <storage/device_statistics.h>
+#include <storage/types.h>
+
+namespace hw::storage
+{
+
+/** @brief Position in message log */
+struct log_position
+{
+    uint64_t segment{0}; ///< Index of segment file
+    uint64_t offset{0};  ///< Byte offset in the segment file
+
+    auto operator<=>(const log_position&) const = default;
+};
+
+/** @brief Configuration of @ref message_log */
+struct message_log_config
+{
+    std::filesystem::path directory;                            ///< Directory of segment and checkpoint files
+    size_t segment_size{64 * 1024 * 1024};                      ///< Segment file is closed and new one started when it reaches this size
+    std::chrono::milliseconds commit_interval{100};             ///< Appended messages are written and synced to disk in this interval
+    std::chrono::seconds checkpoint_interval{60};               ///< Interval of writing checkpoints
+};
+
+/** @brief Checkpointed state of one device */
+struct device_checkpoint
+{
+    std::string name;                    ///< Device name
+    device_statistics statistics;        ///< Message counters
+    std::vector<common::byte_t> history; ///< Stored history saved by @ref device_history::save
+};
+
+/** @brief Checkpoint of storage state: message counters and stored history of all devices valid at given log position */
+struct log_checkpoint
+{
+    log_position position;                  ///< All messages before this position are included in the state, segments before it can be deleted
+    std::vector<device_checkpoint> devices; ///< State per device
+};
+
+/**
+ * @brief Segmented append-only log of received messages.
+ *
+ * Every record consists of its length, checksum, reception timestamp and message serialized in binary format. Records are appended to
+ * segment files which are rotated when they reach configured size.
+ *
+ * Appending only serializes the message into in-memory buffer. Write-behind thread writes the buffered records to disk and syncs them
+ * once per commit interval (group commit), so storing messages never waits for disk. The same thread periodically writes checkpoints
+ * obtained from checkpoint provider. Checkpoint is written only after all records it covers are synced. Records which fail to be written
+ * or synced are kept and written again in the next commit, no checkpoint is written until they succeed.
+ *
+ * State is recovered with @ref read_checkpoint and @ref replay_log: checkpoint restores counters and stored history and only records
+ * behind the checkpoint position are replayed. Segments before the segment of that position are deleted after every checkpoint, so the log
+ * is bounded by the checkpoint interval regardless of retention of stored history.
+ */
+class message_log
+{
+public:
+    //! Function providing checkpoint of current state. Called from write-behind thread.
+    using checkpoint_provider = std::function<log_checkpoint()>;
+
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param config_ Log configuration
+     * @param start_ Position the log continues from, data behind it are discarded
+     * @param provider_ Checkpoint provider
+     */
+    message_log(const message_log_config& config_, log_position start_, checkpoint_provider provider_);
+
+    /** @brief Destructor, calls @ref close */
+    ~message_log();
+
+    message_log(const message_log&) = delete;
+    message_log& operator=(const message_log&) = delete;
+
+    /**
+     * @brief Open segment file and start write-behind thread
+     *
+     * @return true on success, false on I/O error
+     */
+    bool open();
+
+    /**
+     * @brief Append message to log
+     *
+     * @param timestamp_ Reception timestamp
+     * @param message_ Message
+     */
+    void append(timestamp_t timestamp_, const device_control_messages::device_message_type& message_);
+
+    /**
+     * @brief Get position behind the last appended record
+     *
+     * @return Log position
+     */
+    log_position position();
+
+    /**
+     * @brief Block until all appended records are written and synced to disk
+     *
+     * @return true if the records are durable, false if writing them failed (they are retried in the next commit)
+     */
+    bool flush();
+
+    /** @brief Write all appended records and final checkpoint, stop write-behind thread */
+    void close();
+
+private:
+    // Records of one segment waiting for write
+    struct chunk
+    {
+        uint64_t segment;
+        std::vector<common::byte_t> data;
+    };
+
+private:
+    // Write-behind thread main loop
+    void writer_loop();
+    // Take pending chunks and write them to segment files, failed chunks are returned to the pending queue
+    bool write_pending();
+    // Write chunk to its segment file and sync it, written data are truncated on failure
+    bool write_chunk(const chunk& chunk_, log_position& end_);
+    // Open segment file for appending
+    bool open_segment(uint64_t segment_);
+    // Atomically replace checkpoint file
+    bool write_checkpoint(const log_checkpoint& checkpoint_);
+    // Sync and close current segment file
+    void close_segment();
+    // Delete segment files before given segment
+    void remove_segments_before(uint64_t segment_);
+
+    // For logging purposes
+    std::string me() const { return "[message_log] "; }
+
+private:
+    const message_log_config _config;
+    const log_position _start;
+    checkpoint_provider _provider;
+
+    std::mutex _mtx;
+    std::condition_variable _cv;
+    std::condition_variable _durable_cv;
+    std::deque<chunk> _pending;
+    log_position _next_position;
+    log_position _durable_position;
+    bool _flush_requested{false};
+    bool _write_failed{false};
+    bool _stop{false};
+    bool _writer_stopped{true};
+
+    int _fd{-1};
+    uint64_t _fd_segment{0};
+    std::thread _writer;
+};
+
+/**
+ * @brief Read last checkpoint from log directory
+ *
+ * @param directory_ Log directory
+ * @return Checkpoint if it exists and is valid, std::nullopt otherwise
+ */
+std::optional<log_checkpoint> read_checkpoint(const std::filesystem::path& directory_);
+
+/**
+ * @brief Replay records stored in log directory
+ *
+ * @param directory_ Log directory
+ * @param from_ Position of the first replayed record, replay starts at the oldest segment if segments before it were deleted
+ * @param handler_ Function called for every valid record with its position
+ * @return Position behind the last valid record, std::nullopt if log directory cannot be read
+ */
+std::optional<log_position> replay_log(const std::filesystem::path& directory_,
+                                       log_position from_,
+                                       const std::function<void(log_position, timestamp_t, device_control_messages::device_message_type)>& handler_);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <string>
+
+#include <device_control_messages/messages.h>
+#include <storage/compressed_block.h>
+#include <storage/measurement_block.h>
+#include <storage/types.h>
+
+namespace hw::storage
+{
+
+/**
+ * @brief Read-only view of stored measurement.
+ *
+ * Values are read directly from columns of the block the measurement is stored in, or from the cursor decoding compressed block, nothing
+ * is copied. View is valid only while the lock of the storage it was obtained from is held and the cursor is not moved.
+ */
+class measurement_view
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param device_name_ Name of the device
+     * @param block_ Block the measurement is stored in
+     * @param row_ Index of the measurement in the block
+     */
+    measurement_view(const std::string& device_name_, const measurement_block& block_, size_t row_)
+        : _device_name(device_name_)
+        , _block(&block_)
+        , _row(row_)
+    {}
+
+    /**
+     * @brief Constructor
+     *
+     * @param device_name_ Name of the device
+     * @param cursor_ Cursor placed at the measurement in compressed block
+     */
+    measurement_view(const std::string& device_name_, const compressed_block::row_cursor& cursor_)
+        : _device_name(device_name_)
+        , _cursor(&cursor_)
+    {}
+
+    //! Name of the device
+    const std::string& device_name() const { return _device_name; }
+    //! Time of reception
+    timestamp_t timestamp() const { return _cursor ? _cursor->timestamp() : _block->timestamps()[_row]; }
+    //! Number of temperature sensors
+    size_t temperatures_count() const { return _cursor ? _cursor->temperatures_count() : _block->temperatures_count(); }
+    //! Value of given temperature sensor
+    uint16_t temperature(size_t sensor_) const { return _cursor ? _cursor->temperature(sensor_) : _block->temperatures(sensor_)[_row]; }
+    //! Number of fans
+    size_t fans_count() const { return _cursor ? _cursor->fans_count() : _block->fans_count(); }
+    //! Speed of given fan
+    uint8_t fan_speed(size_t fan_) const { return _cursor ? _cursor->fan_speed(fan_) : _block->fans(fan_)[_row]; }
+
+    //! Copy the measurement into message
+    device_control_messages::measurement to_message() const { return _cursor ? _cursor->to_message(_device_name) : _block->row(_row, _device_name); }
+
+private:
+    const std::string& _device_name;
+    const measurement_block* _block{nullptr};
+    const compressed_block::row_cursor* _cursor{nullptr};
+    size_t _row{0};
+};
+
+/** @brief Read-only view of stored error message. Valid only while the lock of the storage it was obtained from is held. */
+class error_view
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param device_name_ Name of the device
+     * @param timestamp_ Time of reception
+     * @param err_type_ Error type
+     */
+    error_view(const std::string& device_name_, timestamp_t timestamp_, device_control_messages::error::error_type err_type_)
+        : _device_name(device_name_)
+        , _timestamp(timestamp_)
+        , _err_type(err_type_)
+    {}
+
+    //! Name of the device
+    const std::string& device_name() const { return _device_name; }
+    //! Time of reception
+    timestamp_t timestamp() const { return _timestamp; }
+    //! Error type
+    device_control_messages::error::error_type err_type() const { return _err_type; }
+
+    //! Copy the error into message
+    device_control_messages::error to_message() const { return device_control_messages::error(_device_name, _err_type); }
+
+private:
+    const std::string& _device_name;
+    timestamp_t _timestamp;
+    device_control_messages::error::error_type _err_type;
+};
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace hw::storage
+{
+
+/**
+ * @brief Limits of stored history of one device
+ *
+ * Oldest messages are evicted when any of the limits is exceeded. Zero value means no limit. Message counters are not affected by eviction.
+ * Memory limit accounts for blocks holding stored messages, one emptied block per device kept for reuse is not included.
+ */
+struct retention_policy
+{
+    size_t max_messages{0};          ///< Maximum number of stored messages
+    std::chrono::seconds max_age{0}; ///< Maximum age of stored messages
+    size_t max_memory_bytes{0};      ///< Maximum memory occupied by stored messages, the block currently being filled is always kept
+
+    //! Check whether any limit is set
+    bool limited() const { return max_messages || max_age.count() || max_memory_bytes; }
+};
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+#include <device_control_messages/measurement.h>
+#include <storage/column_aggregate.h>
+#include <storage/types.h>
+
+namespace hw::storage
+{
+
+/** @brief Configuration of one rollup tier */
+struct rollup_tier_config
+{
+    std::chrono::seconds resolution; ///< Length of time bucket values are rolled up into
+    std::chrono::seconds retention;  ///< How long buckets are kept
+};
+
+/** @brief Configuration of @ref rollup_tiers */
+struct rollup_config
+{
+    //! Tiers, e.g. 1 min buckets for a day and 1 h buckets for a month. Empty (default) disables rollups.
+    std::vector<rollup_tier_config> tiers;
+};
+
+/** @brief Rolled up values of one sensor in one time bucket */
+struct rollup_point
+{
+    timestamp_t start;          ///< Start of the time bucket
+    column_aggregate aggregate; ///< Count, minimum, maximum, mean and number of error values in the bucket
+};
+
+/** @brief Result of rollup query */
+struct rollup_series
+{
+    std::chrono::seconds tier_resolution{0}; ///< Resolution of the tier the series was computed from
+    std::chrono::seconds resolution{0};      ///< Length of returned time buckets
+    std::vector<rollup_point> points;        ///< Non-empty buckets in order of time
+};
+
+/**
+ * @brief Downsampled history of measurements of one device at several resolutions.
+ *
+ * Every measurement is rolled up into the current bucket of each tier, so tiers are maintained at ingest without revisiting stored
+ * messages. Each tier has its own retention, buckets older than the retention (relative to the latest measurement) are dropped and their
+ * memory is reused. Aggregates of all buckets of a tier are kept in one flat ring buffer, every bucket holds a column aggregate (32 B) per
+ * temperature sensor and fan, so a tier takes about retention / resolution * 32 B per sensor.
+ *
+ * Queries pick the coarsest tier whose resolution is not coarser than requested one. If that tier does not reach back to the start of the
+ * requested range, coarser tiers are tried, as the range takes precedence over resolution. Buckets of the tier are merged into buckets of
+ * the requested resolution, so the size of the result depends on the range and resolution only.
+ */
+class rollup_tiers
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param config_ Rollup configuration
+     */
+    explicit rollup_tiers(const rollup_config& config_ = {});
+
+    /**
+     * @brief Roll up measurement into all tiers
+     *
+     * @param timestamp_ Time of reception
+     * @param measurement_ Measurement
+     */
+    void record(timestamp_t timestamp_, const device_control_messages::measurement& measurement_);
+
+    /**
+     * @brief Drop buckets exceeding tier retention. Expired buckets of a tier are also dropped whenever a new bucket is started.
+     *
+     * @param now_ Current time
+     */
+    void enforce_retention(timestamp_t now_);
+
+    /**
+     * @brief Get rolled up values of temperature sensor
+     *
+     * @param sensor_ Index of temperature sensor
+     * @param from_ Start of the range, inclusive
+     * @param to_ End of the range, exclusive
+     * @param resolution_ Requested length of time buckets
+     * @return Series of rolled up values
+     */
+    rollup_series temperature(size_t sensor_, timestamp_t from_, timestamp_t to_, std::chrono::seconds resolution_) const;
+
+    /**
+     * @brief Get rolled up speeds of fan
+     *
+     * @param fan_ Index of fan
+     * @param from_ Start of the range, inclusive
+     * @param to_ End of the range, exclusive
+     * @param resolution_ Requested length of time buckets
+     * @return Series of rolled up values
+     */
+    rollup_series fan_speed(size_t fan_, timestamp_t from_, timestamp_t to_, std::chrono::seconds resolution_) const;
+
+    //! Number of tiers
+    size_t tiers_count() const { return _tiers.size(); }
+    //! Number of kept buckets of tier
+    size_t buckets_count(size_t tier_) const { return _tiers[tier_].count; }
+    //! Memory occupied by buckets of all tiers in bytes
+    size_t memory_size() const;
+
+private:
+    // Buckets of one resolution kept in ring buffer. Bucket at ring index i has start starts[i] and aggregates of all temperature sensors
+    // followed by aggregates of all fans at aggregates[i * stride()].
+    struct tier
+    {
+        timestamp_t resolution;
+        timestamp_t retention;
+        size_t temperatures_count{0};
+        size_t fans_count{0};
+        size_t first{0};
+        size_t count{0};
+        std::vector<timestamp_t> starts{};
+        std::vector<column_aggregate> aggregates{};
+
+        // Number of aggregates per bucket
+        size_t stride() const { return temperatures_count + fans_count; }
+        // Ring index of n-th oldest bucket
+        size_t ring_index(size_t n_) const { return (first + n_) % starts.size(); }
+    };
+
+private:
+    // Get aggregates of bucket of tier measurement received at given time belongs to, bucket has room for given number of sensors
+    column_aggregate* bucket_for(tier& tier_, timestamp_t timestamp_, size_t temperatures_count_, size_t fans_count_);
+    // Reallocate ring buffer of tier to given capacity and number of sensors, kept buckets are moved to the front
+    static void reshape(tier& tier_, size_t capacity_, size_t temperatures_count_, size_t fans_count_);
+    // Drop buckets of tier exceeding its retention
+    static void drop_expired(tier& tier_, timestamp_t now_);
+    // Select tier query is answered from
+    const tier& select_tier(timestamp_t from_, timestamp_t resolution_) const;
+    // Implementation of temperature(...) and fan_speed(...) queries
+    rollup_series query(bool fans_, size_t index_, timestamp_t from_, timestamp_t to_, std::chrono::seconds resolution_) const;
+
+private:
+    std::vector<tier> _tiers;
+    timestamp_t _latest;
+};
+}
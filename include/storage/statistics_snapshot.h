@@ -0,0 +1,38 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <storage/device_statistics.h>
+#include <storage/types.h>
+
+namespace hw::storage
+{
+
+/**
+ * @brief Immutable copy of message counters of all devices taken at one moment.
+ *
+ * Snapshots are published by the storage and shared by all readers, so reading a snapshot takes no storage lock. Counters of devices in
+ * the same shard are consistent with each other, counters of devices in different shards may be taken a few messages apart.
+ */
+struct statistics_snapshot
+{
+    timestamp_t timestamp{0};                                       ///< Time the snapshot was taken, 0 if never taken
+    std::vector<std::pair<std::string, device_statistics>> devices; ///< Counters per device, sorted by device name
+
+    /**
+     * @brief Find counters of device
+     *
+     * @param device_name_ Device name
+     * @return Counters, nullptr if no message of the device was counted in the snapshot
+     */
+    const device_statistics* find(const std::string& device_name_) const
+    {
+        auto iter = std::lower_bound(
+            devices.begin(), devices.end(), device_name_, [](const auto& device_, const std::string& name_) { return device_.first < name_; });
+        return iter != devices.end() && iter->first == device_name_ ? &iter->second : nullptr;
+    }
+};
+}
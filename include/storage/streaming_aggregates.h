@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <vector>
+
+#include <device_control_messages/measurement.h>
+#include <storage/column_aggregate.h>
+#include <storage/types.h>
+#include <storage/value_histogram.h>
+
+namespace hw::storage
+{
+
+/** @brief Configuration of @ref streaming_aggregates */
+struct aggregation_config
+{
+    std::chrono::seconds window{60}; ///< Length of tumbling window
+    size_t windows_count{0};         ///< Number of most recent windows kept, 0 disables aggregation
+};
+
+/**
+ * @brief Summary of values of one temperature sensor or fan
+ *
+ * @tparam ValueType Type of sensor values
+ */
+template <class ValueType>
+struct sensor_summary
+{
+    column_aggregate aggregate;           ///< Count, minimum, maximum, mean and number of error values
+    value_histogram<ValueType> histogram; ///< Distribution of valid values
+
+    /**
+     * @brief Record value
+     *
+     * @param value_ Value
+     * @param error_value_ Value signaling sensor error, such values are counted as errors only
+     */
+    void record(ValueType value_, ValueType error_value_)
+    {
+        if (value_ == error_value_)
+        {
+            aggregate.errors++;
+            return;
+        }
+        aggregate.count++;
+        aggregate.sum += value_;
+        aggregate.min = std::min<uint16_t>(aggregate.min, value_);
+        aggregate.max = std::max<uint16_t>(aggregate.max, value_);
+        histogram.record(value_);
+    }
+
+    /**
+     * @brief Merge other summary into this one
+     *
+     * @param other_ Summary to merge
+     */
+    void merge(const sensor_summary& other_)
+    {
+        aggregate.merge(other_.aggregate);
+        histogram.merge(other_.histogram);
+    }
+
+    /**
+     * @brief Get value at given percentile
+     *
+     * @param percentile_ Percentile in range 0 - 100
+     * @return Approximate value, relative error is below 1/32, 0 if there are no valid values
+     */
+    uint16_t percentile(double percentile_) const
+    {
+        if (aggregate.count == 0)
+            return 0;
+        return std::clamp<uint16_t>(histogram.percentile(percentile_), aggregate.min, aggregate.max);
+    }
+};
+
+using temperature_summary = sensor_summary<uint16_t>; //!< Summary of temperature sensor
+using fan_speed_summary   = sensor_summary<uint8_t>;  //!< Summary of fan
+
+/**
+ * @brief Per-sensor summaries of measurements of one device maintained at ingest over tumbling time windows.
+ *
+ * Every window keeps @ref sensor_summary of each temperature sensor and fan. Only configured number of the most recent windows is kept
+ * and the oldest window is reused for the new one, so memory is bounded and queries merge at most that many summaries regardless of
+ * the length of stored history. Summary of a temperature sensor takes about 1.6 kB and summary of a fan about 0.6 kB per window, so the
+ * number of kept windows should be small when many devices report. Aggregation is disabled by default.
+ */
+class streaming_aggregates
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param config_ Aggregation configuration
+     */
+    explicit streaming_aggregates(const aggregation_config& config_ = {})
+        : _window_len(std::chrono::duration_cast<std::chrono::nanoseconds>(config_.window).count())
+        , _windows_count(config_.windows_count)
+    {
+        if (_window_len <= 0)
+            _window_len = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::seconds(1)).count();
+    }
+
+    /**
+     * @brief Record measurement
+     *
+     * @param timestamp_ Time of reception
+     * @param measurement_ Measurement
+     */
+    void record(timestamp_t timestamp_, const device_control_messages::measurement& measurement_);
+
+    /**
+     * @brief Summarize values of temperature sensor
+     *
+     * @param sensor_ Index of temperature sensor
+     * @param since_ Windows ending before this time are skipped
+     * @return Summary over kept windows
+     */
+    temperature_summary temperature(size_t sensor_, timestamp_t since_) const;
+
+    /**
+     * @brief Summarize speeds of fan
+     *
+     * @param fan_ Index of fan
+     * @param since_ Windows ending before this time are skipped
+     * @return Summary over kept windows
+     */
+    fan_speed_summary fan_speed(size_t fan_, timestamp_t since_) const;
+
+    //! Memory occupied by kept windows in bytes
+    size_t memory_size() const { return _memory_size; }
+
+private:
+    // Summaries of one time window
+    struct window
+    {
+        timestamp_t start;
+        std::vector<temperature_summary> temperatures;
+        std::vector<fan_speed_summary> fans;
+    };
+
+private:
+    // Get window measurement received at given time belongs to
+    window& window_for(timestamp_t timestamp_);
+
+private:
+    timestamp_t _window_len;
+    size_t _windows_count;
+    std::deque<window> _windows;
+    size_t _memory_size{0};
+};
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace hw::storage
+{
+
+//! Time of message reception in nanoseconds since Unix epoch
+using timestamp_t = int64_t;
+
+/**
+ * @brief Get current time as storage timestamp
+ *
+ * @return Current timestamp
+ */
+inline timestamp_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace hw::storage
+{
+
+/**
+ * @brief Mergeable histogram of unsigned sensor values with bounded relative error (HDR-style log-linear buckets).
+ *
+ * Values below 64 have their own bucket. Larger values are grouped by their most significant bit into 32 linear sub-buckets, so the
+ * relative error of reported percentiles is below 1/32. The histogram has fixed size given by the width of values (384 buckets for 16-bit
+ * values, 128 buckets for 8-bit values), recording and percentile queries take constant time.
+ *
+ * @tparam ValueType Unsigned type of recorded values, 8 or 16 bits wide
+ */
+template <class ValueType>
+class value_histogram
+{
+    static_assert(std::is_same_v<ValueType, uint8_t> || std::is_same_v<ValueType, uint16_t>, "Unsupported value type");
+
+public:
+    static constexpr unsigned value_bits        = std::numeric_limits<ValueType>::digits;                          ///< Width of values
+    static constexpr unsigned sub_bucket_bits   = 5;                                                               ///< Precision bits of large values
+    static constexpr uint32_t sub_buckets_count = 1u << sub_bucket_bits;                                           ///< Sub-buckets per power of two
+    static constexpr uint32_t linear_range      = 2 * sub_buckets_count;                                           ///< Values below have exact buckets
+    static constexpr uint32_t buckets_count     = linear_range + (value_bits - sub_bucket_bits - 1) * sub_buckets_count; ///< Total buckets
+
+    /**
+     * @brief Record value
+     *
+     * @param value_ Value
+     */
+    void record(ValueType value_)
+    {
+        _counts[bucket_index(value_)]++;
+        _total++;
+    }
+
+    /**
+     * @brief Merge other histogram into this one
+     *
+     * @param other_ Histogram to merge
+     */
+    void merge(const value_histogram& other_)
+    {
+        for (uint32_t i = 0; i < buckets_count; i++)
+        {
+            _counts[i] += other_._counts[i];
+        }
+        _total += other_._total;
+    }
+
+    /**
+     * @brief Get value at given percentile
+     *
+     * @param percentile_ Percentile in range 0 - 100
+     * @return Highest value of the bucket containing the percentile, 0 if the histogram is empty
+     */
+    ValueType percentile(double percentile_) const
+    {
+        if (_total == 0)
+            return 0;
+
+        auto rank = static_cast<uint64_t>(percentile_ / 100.0 * static_cast<double>(_total) + 0.5);
+        rank      = rank ? (rank > _total ? _total : rank) : 1;
+
+        uint64_t seen{0};
+        for (uint32_t i = 0; i < buckets_count; i++)
+        {
+            seen += _counts[i];
+            if (seen >= rank)
+                return bucket_max(i);
+        }
+        return bucket_max(buckets_count - 1);
+    }
+
+    //! Number of recorded values
+    uint64_t total() const { return _total; }
+
+    //! Index of bucket value belongs to
+    static uint32_t bucket_index(ValueType value_)
+    {
+        if (value_ < linear_range)
+            return value_;
+
+        unsigned shift = static_cast<unsigned>(std::bit_width(value_)) - sub_bucket_bits - 1;
+        return linear_range + (shift - 1) * sub_buckets_count + ((value_ >> shift) - sub_buckets_count);
+    }
+
+    //! Highest value belonging to bucket
+    static ValueType bucket_max(uint32_t index_)
+    {
+        if (index_ < linear_range)
+            return static_cast<ValueType>(index_);
+
+        unsigned shift = (index_ - linear_range) / sub_buckets_count + 1;
+        uint32_t sub   = (index_ - linear_range) % sub_buckets_count + sub_buckets_count;
+        return static_cast<ValueType>(((sub + 1) << shift) - 1);
+    }
+
+private:
+    std::array<uint32_t, buckets_count> _counts{};
+    uint64_t _total{0};
+};
+}
@@ -10,6 +10,8 @@ std::string header::as_string() const
     ss << "-----------------------------------\n";
     ss << "DEVICE NAME=" << device_name << '\n';
     ss << "MSG TYPE=" << message_type_to_string(msg_type) << '\n';
+    if (device_timestamp)
+        ss << "DEVICE TIMESTAMP=" << *device_timestamp << '\n';
     return ss.str();
 }
 }
\ No newline at end of file
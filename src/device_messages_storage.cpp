@@ -2,35 +2,199 @@
 
 namespace hw
 {
-void device_messages_storage::new_message_impl(const device_control_messages::device_message_type& message_)
+bool device_messages_storage::enable_persistence(const storage::message_log_config& config_)
 {
-    auto device_name_visitor = [](auto msg_) { return msg_.device_name; };
-    auto name                = std::visit(device_name_visitor, message_);
+    storage::log_position start;
+    if (auto checkpoint = storage::read_checkpoint(config_.directory))
+    {
+        for (auto& device : checkpoint->devices)
+        {
+            auto& shard = shard_for(device.name);
+            std::unique_lock lock(shard.mtx);
+            auto& record      = record_for(shard, device.name);
+            auto memory_size  = record.memory_size();
+            record.statistics = device.statistics;
+            if (!record.history.load(device.history))
+            {
+                std::cerr << me() << "Malformed stored history of device " << device.name << " in checkpoint" << std::endl;
+                return false;
+            }
+            // Aggregates cover restored history as they did before restart
+            if (_aggregation.windows_count || !_rollups.tiers.empty())
+            {
+                record.history.for_each_measurement(device.name, [&record](const storage::measurement_view& view_) {
+                    auto measurement = view_.to_message();
+                    record.aggregates.record(view_.timestamp(), measurement);
+                    record.rollups.record(view_.timestamp(), measurement);
+                });
+            }
+            _stored_bytes.add(static_cast<int64_t>(record.memory_size()) - static_cast<int64_t>(memory_size));
+        }
+        start = checkpoint->position;
+    }
+
+    // Only records not covered by the checkpoint are replayed
+    auto end = storage::replay_log(
+        config_.directory, start, [&](storage::log_position, storage::timestamp_t timestamp_, device_control_messages::device_message_type message_) {
+            const auto& name = std::visit([](const auto& msg_) -> const std::string& { return msg_.device_name; }, message_);
+            auto& shard      = shard_for(name);
+            std::unique_lock lock(shard.mtx);
+            new_message_impl(shard, timestamp_, message_);
+        });
+    if (!end)
+    {
+        std::cerr << me() << "Cannot read message log " << config_.directory << std::endl;
+        return false;
+    }
+    // Restored messages older than the age limit are evicted
+    apply_retention();
+
+    _log = std::make_unique<storage::message_log>(config_, *end, [this] { return make_checkpoint(); });
+    if (!_log->open())
+    {
+        _log.reset();
+        return false;
+    }
+    return true;
+}
+
+void device_messages_storage::new_messages(std::span<const received_message> messages_)
+{
+    // Counting sort of message indices by shard keeps order of messages within each shard
+    std::vector<size_t> shard_of(messages_.size());
+    std::vector<size_t> offsets(_shards.size() + 1, 0);
+    for (size_t i = 0; i < messages_.size(); i++)
+    {
+        shard_of[i] = shard_index(messages_[i].message);
+        offsets[shard_of[i] + 1]++;
+    }
+    for (size_t s = 1; s < offsets.size(); s++)
+    {
+        offsets[s] += offsets[s - 1];
+    }
+
+    std::vector<size_t> order(messages_.size());
+    auto next = offsets;
+    for (size_t i = 0; i < messages_.size(); i++)
+    {
+        order[next[shard_of[i]]++] = i;
+    }
+
+    for (size_t s = 0; s < _shards.size(); s++)
+    {
+        if (offsets[s] == offsets[s + 1])
+            continue;
+
+        std::unique_lock lock(_shards[s].mtx);
+        for (auto i = offsets[s]; i < offsets[s + 1]; i++)
+        {
+            const auto& received = messages_[order[i]];
+            new_message_impl(_shards[s], received.timestamp, received.message);
+            if (_log)
+                _log->append(received.timestamp, received.message);
+        }
+    }
+    _stored_messages.add(messages_.size());
+}
+
+void device_messages_storage::publish_statistics_snapshot()
+{
+    auto snapshot       = std::make_shared<storage::statistics_snapshot>();
+    snapshot->timestamp = storage::now();
+    for (auto& shard : _shards)
+    {
+        std::shared_lock lock(shard.mtx);
+        for (const auto& [name, record] : shard.devices)
+        {
+            snapshot->devices.emplace_back(name, record.statistics);
+        }
+    }
+    std::sort(snapshot->devices.begin(), snapshot->devices.end(), [](const auto& a_, const auto& b_) { return a_.first < b_.first; });
+
+    _snapshot.store(std::move(snapshot), std::memory_order_release);
+}
+
+void device_messages_storage::snapshot_publisher_loop()
+{
+    std::unique_lock lock(_snapshot_mtx);
+    while (!_snapshot_stop)
+    {
+        lock.unlock();
+        publish_statistics_snapshot();
+        lock.lock();
+        _snapshot_cv.wait_for(lock, _snapshot_interval, [this] { return _snapshot_stop; });
+    }
+}
+
+storage::log_checkpoint device_messages_storage::make_checkpoint()
+{
+    // All shards are locked at once, so no message can be stored between reading the state and log position. Shared locks suffice, readers
+    // do not store messages.
+    std::vector<std::shared_lock<std::shared_mutex>> locks;
+    locks.reserve(_shards.size());
+    for (auto& shard : _shards)
+    {
+        locks.emplace_back(shard.mtx);
+    }
+
+    storage::log_checkpoint checkpoint;
+    checkpoint.position = _log->position();
+    for (auto& shard : _shards)
+    {
+        for (auto& [name, record] : shard.devices)
+        {
+            auto& device      = checkpoint.devices.emplace_back();
+            device.name       = name;
+            device.statistics = record.statistics;
+            record.history.save(device.history);
+        }
+    }
+    return checkpoint;
+}
 
-    auto iter = _messages_received.find(name);
-    if (iter == _messages_received.end())
-        _messages_received[name] = {std::move(message_)};
+void device_messages_storage::new_message_impl(shard& shard_, storage::timestamp_t timestamp_, const device_control_messages::device_message_type& message_)
+{
+    auto device_name_visitor = [](const auto& msg_) -> const std::string& { return msg_.device_name; };
+    const auto& device_name  = std::visit(device_name_visitor, message_);
+    auto& record             = record_for(shard_, device_name);
+
+    auto memory_size = record.memory_size();
+
+    record.statistics.record(message_);
+    if (auto meas = std::get_if<device_control_messages::measurement>(&message_))
+    {
+        record.aggregates.record(timestamp_, *meas);
+        record.rollups.record(timestamp_, *meas);
+    }
+    if (_mode == storage_mode::full)
+        std::visit([&record, timestamp_](const auto& msg_) { record.history.append(timestamp_, msg_); }, message_);
+    _stored_bytes.add(static_cast<int64_t>(record.memory_size()) - static_cast<int64_t>(memory_size));
+}
+
+std::vector<device_control_messages::device_message_type> device_messages_storage::get_device_messages_impl(shard& shard_, const std::string& device_)
+{
+    auto iter = shard_.devices.find(device_);
+    if (iter != shard_.devices.end())
+        return iter->second.history.messages(device_);
     else
-        _messages_received[name].push_back(std::move(message_));
+        return {};
 }
 
-std::vector<device_control_messages::device_message_type> device_messages_storage::get_device_messages_impl(const std::string& device_)
+storage::device_statistics device_messages_storage::get_device_statistics_impl(shard& shard_, const std::string& device_)
 {
-    auto iter = _messages_received.find(device_);
-    if (iter != _messages_received.end())
-        return iter->second;
+    auto iter = shard_.devices.find(device_);
+    if (iter != shard_.devices.end())
+        return iter->second.statistics;
     else
         return {};
 }
 
-std::vector<std::string> device_messages_storage::get_devices_impl()
+void device_messages_storage::get_devices_impl(shard& shard_, std::vector<std::string>& devices_)
 {
-    std::vector<std::string> devices;
-    for (const auto& map_pair : _messages_received)
+    for (const auto& map_pair : shard_.devices)
     {
-        devices.push_back(map_pair.first);
+        devices_.push_back(map_pair.first);
     }
-    return devices;
 }
 
-}
\ No newline at end of file
+}
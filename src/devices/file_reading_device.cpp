@@ -1,3 +1,4 @@
+#include <chrono>
 #include <fstream>
 #include <streambuf>
 
@@ -23,6 +24,7 @@ void file_reading_device::timer_tick(boost::system::error_code ec_)
 void file_reading_device::report_measurement()
 {
     device_control_messages::measurement measurement(_name);
+    measurement.device_timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
     for (const auto& file_ : _temperature_files)
     {
         measurement.temperature_sensors.push_back(read_sensor_file(file_).value_or(device_control_messages::measurement::error_temperature));
@@ -0,0 +1,119 @@
+#include <ingest_queue.h>
+
+namespace hw
+{
+ingest_queue::ingest_queue(device_messages_storage& storage_, const ingest_config& config_)
+    : _storage(storage_)
+    , _max_batch(std::max<size_t>(config_.max_batch, 1))
+    , _overflow(config_.overflow)
+    , _queue(config_.capacity)
+    , _consumer([this] { run(); })
+{}
+
+ingest_queue::~ingest_queue()
+{
+    _stopping.store(true, std::memory_order_release);
+    wake_consumer();
+    _consumer.join();
+}
+
+bool ingest_queue::push(device_control_messages::device_message_type message_)
+{
+    received_message received{storage::now(), std::move(message_)};
+    if (!_queue.try_push(received))
+    {
+        if (_overflow == ingest_overflow::drop)
+        {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        _producer_waits.fetch_add(1, std::memory_order_relaxed);
+        do
+        {
+            wake_consumer();
+            std::this_thread::yield();
+        } while (!_queue.try_push(received));
+    }
+    _enqueued.fetch_add(1, std::memory_order_relaxed);
+
+    // Pairs with the fence in run(), either the consumer sees the pushed message or the producer sees the consumer sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_consumer_sleeping.load(std::memory_order_relaxed))
+        wake_consumer();
+    return true;
+}
+
+void ingest_queue::flush()
+{
+    auto target = _enqueued.load(std::memory_order_relaxed);
+    while (_applied.load(std::memory_order_acquire) < target)
+    {
+        std::this_thread::yield();
+    }
+}
+
+ingest_statistics ingest_queue::statistics() const
+{
+    ingest_statistics stats;
+    stats.depth          = _queue.size();
+    stats.enqueued       = _enqueued.load(std::memory_order_relaxed);
+    stats.applied        = _applied.load(std::memory_order_relaxed);
+    stats.dropped        = _dropped.load(std::memory_order_relaxed);
+    stats.producer_waits = _producer_waits.load(std::memory_order_relaxed);
+    stats.batches        = _batches.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void ingest_queue::run()
+{
+    std::vector<received_message> batch;
+    batch.reserve(_max_batch);
+
+    while (true)
+    {
+        pop_batch(batch);
+        if (!batch.empty())
+        {
+            _storage.new_messages(batch);
+            _batches.fetch_add(1, std::memory_order_relaxed);
+            _applied.fetch_add(batch.size(), std::memory_order_release);
+            batch.clear();
+            continue;
+        }
+
+        if (_stopping.load(std::memory_order_acquire))
+        {
+            // Messages pushed before the destructor was called might have been published after the last pop
+            pop_batch(batch);
+            if (batch.empty())
+                break;
+            continue;
+        }
+
+        auto wakeups = _wakeups.load(std::memory_order_acquire);
+        _consumer_sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_queue.size() == 0 && !_stopping.load(std::memory_order_acquire))
+            _wakeups.wait(wakeups, std::memory_order_acquire);
+        _consumer_sleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
+void ingest_queue::pop_batch(std::vector<received_message>& batch_)
+{
+    while (batch_.size() < _max_batch)
+    {
+        auto received = _queue.try_pop();
+        if (!received)
+            break;
+        batch_.push_back(std::move(*received));
+    }
+}
+
+void ingest_queue::wake_consumer()
+{
+    _wakeups.fetch_add(1, std::memory_order_release);
+    _wakeups.notify_one();
+}
+}
@@ -0,0 +1,213 @@
+#include <metrics/metrics.h>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace hw::metrics
+{
+namespace
+{
+const char* type_name(metric_type type_)
+{
+    switch (type_)
+    {
+    case metric_type::counter:
+        return "counter";
+    case metric_type::gauge:
+        return "gauge";
+    case metric_type::histogram:
+        return "histogram";
+    }
+    return "untyped";
+}
+
+// Write name with labels, extra label is appended to labels of the series
+void write_series_name(std::ostream& os_, const std::string& name_, const std::string& labels_, const std::string& extra_label_ = {})
+{
+    os_ << name_;
+    if (labels_.empty() && extra_label_.empty())
+        return;
+
+    os_ << '{' << labels_;
+    if (!labels_.empty() && !extra_label_.empty())
+        os_ << ',';
+    os_ << extra_label_ << '}';
+}
+}
+
+histogram::histogram(std::vector<double> bounds_)
+    : _bounds(std::move(bounds_))
+{
+    for (auto& shard : _shards)
+    {
+        shard.buckets = std::make_unique<std::atomic<uint64_t>[]>(_bounds.size() + 1);
+    }
+}
+
+void histogram::observe(double value_)
+{
+    auto bucket = static_cast<size_t>(std::lower_bound(_bounds.begin(), _bounds.end(), value_) - _bounds.begin());
+    auto& shard = _shards[shard_index()];
+    shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value_, std::memory_order_relaxed);
+}
+
+histogram::snapshot histogram::read() const
+{
+    snapshot result;
+    result.buckets.resize(_bounds.size() + 1);
+    for (const auto& shard : _shards)
+    {
+        for (size_t i = 0; i < result.buckets.size(); i++)
+        {
+            result.buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+        }
+        result.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    for (size_t i = 1; i < result.buckets.size(); i++)
+    {
+        result.buckets[i] += result.buckets[i - 1];
+    }
+    return result;
+}
+
+counter& registry::add_counter(const std::string& name_, const std::string& help_, const std::string& labels_)
+{
+    return get_or_create<counter>(name_, help_, metric_type::counter, labels_);
+}
+
+gauge& registry::add_gauge(const std::string& name_, const std::string& help_, const std::string& labels_)
+{
+    return get_or_create<gauge>(name_, help_, metric_type::gauge, labels_);
+}
+
+histogram& registry::add_histogram(const std::string& name_, const std::string& help_, std::vector<double> bounds_, const std::string& labels_)
+{
+    return get_or_create<histogram>(name_, help_, metric_type::histogram, labels_, std::move(bounds_));
+}
+
+void registry::add_callback(const std::string& name_, const std::string& help_, metric_type type_, std::function<double()> read_, const std::string& labels_)
+{
+    std::scoped_lock lock(_mtx);
+    auto& entry = find_series(name_, help_, type_, labels_);
+    // Metrics handed out by reference must stay alive, only previous callback can be replaced
+    if (!empty(entry) && !std::holds_alternative<std::function<double()>>(entry.value))
+        throw std::invalid_argument("Metric " + name_ + "{" + labels_ + "} is already registered as another kind of metric");
+    entry.value = std::move(read_);
+}
+
+void registry::remove_callback(const std::string& name_, const std::string& labels_)
+{
+    std::scoped_lock lock(_mtx);
+    for (auto& fam : _families)
+    {
+        if (fam->name != name_)
+            continue;
+        std::erase_if(fam->entries, [&labels_](const series& entry_) {
+            return entry_.labels == labels_ && std::holds_alternative<std::function<double()>>(entry_.value);
+        });
+    }
+}
+
+void registry::write(std::ostream& os_) const
+{
+    std::scoped_lock lock(_mtx);
+    // Values read by callbacks are doubles, keep integral counts exact
+    auto precision = os_.precision(15);
+    for (const auto& fam : _families)
+    {
+        if (fam->entries.empty())
+            continue;
+
+        os_ << "# HELP " << fam->name << ' ' << fam->help << '\n';
+        os_ << "# TYPE " << fam->name << ' ' << type_name(fam->type) << '\n';
+        for (const auto& entry : fam->entries)
+        {
+            if (empty(entry))
+                continue;
+            if (auto hist = std::get_if<std::unique_ptr<histogram>>(&entry.value); hist && *hist)
+            {
+                auto counts = (*hist)->read();
+                for (size_t i = 0; i < counts.buckets.size(); i++)
+                {
+                    std::ostringstream le;
+                    le << "le=\"";
+                    if (i < (*hist)->bounds().size())
+                        le << (*hist)->bounds()[i];
+                    else
+                        le << "+Inf";
+                    le << '"';
+                    write_series_name(os_, fam->name + "_bucket", entry.labels, le.str());
+                    os_ << ' ' << counts.buckets[i] << '\n';
+                }
+                write_series_name(os_, fam->name + "_sum", entry.labels);
+                os_ << ' ' << counts.sum << '\n';
+                write_series_name(os_, fam->name + "_count", entry.labels);
+                os_ << ' ' << counts.buckets.back() << '\n';
+                continue;
+            }
+
+            write_series_name(os_, fam->name, entry.labels);
+            os_ << ' ';
+            std::visit(
+                [&os_](const auto& value_) {
+                    using value_type = std::decay_t<decltype(value_)>;
+                    if constexpr (std::is_same_v<value_type, std::function<double()>>)
+                        os_ << value_();
+                    else if constexpr (!std::is_same_v<value_type, std::unique_ptr<histogram>>)
+                        os_ << value_->value();
+                },
+                entry.value);
+            os_ << '\n';
+        }
+    }
+    os_.precision(precision);
+}
+
+registry::series& registry::find_series(const std::string& name_, const std::string& help_, metric_type type_, const std::string& labels_)
+{
+    auto fam = std::find_if(_families.begin(), _families.end(), [&name_](const auto& fam_) { return fam_->name == name_; });
+    if (fam == _families.end())
+    {
+        _families.push_back(std::make_unique<family>(family{name_, help_, type_, {}}));
+        fam = std::prev(_families.end());
+    }
+    else if ((*fam)->type != type_)
+    {
+        throw std::invalid_argument("Metric " + name_ + " is already registered as " + type_name((*fam)->type));
+    }
+
+    auto& entries = (*fam)->entries;
+    auto entry    = std::find_if(entries.begin(), entries.end(), [&labels_](const series& entry_) { return entry_.labels == labels_; });
+    if (entry != entries.end())
+        return *entry;
+    return entries.emplace_back(series{labels_, {}});
+}
+
+template <typename Metric, typename... Args>
+Metric& registry::get_or_create(const std::string& name_, const std::string& help_, metric_type type_, const std::string& labels_, Args&&... args_)
+{
+    std::scoped_lock lock(_mtx);
+    auto& entry = find_series(name_, help_, type_, labels_);
+    if (auto metric = std::get_if<std::unique_ptr<Metric>>(&entry.value); metric && *metric)
+        return **metric;
+    if (!empty(entry))
+        throw std::invalid_argument("Metric " + name_ + "{" + labels_ + "} is already registered as callback");
+    return *entry.value.emplace<std::unique_ptr<Metric>>(std::make_unique<Metric>(std::forward<Args>(args_)...));
+}
+
+bool registry::empty(const series& entry_)
+{
+    auto metric = std::get_if<std::unique_ptr<counter>>(&entry_.value);
+    return metric && !*metric;
+}
+
+registry& default_registry()
+{
+    static registry instance;
+    return instance;
+}
+}
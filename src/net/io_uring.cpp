@@ -0,0 +1,312 @@
+#if defined(HW_WITH_IO_URING)
+
+#include <net/io_uring.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+namespace hw::net
+{
+namespace
+{
+int sys_io_uring_setup(unsigned entries_, io_uring_params* params_)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries_, params_));
+}
+
+int sys_io_uring_enter(int fd_, unsigned to_submit_, unsigned min_complete_, unsigned flags_)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd_, to_submit_, min_complete_, flags_, nullptr, 0));
+}
+
+int sys_io_uring_register(int fd_, unsigned opcode_, const void* arg_, unsigned nr_args_)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd_, opcode_, arg_, nr_args_));
+}
+
+void* map_ring(int fd_, size_t size_, off_t offset_)
+{
+    auto ptr = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset_);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+}
+
+std::string me()
+{
+    return "[io_uring] ";
+}
+}
+
+io_uring_ring::~io_uring_ring()
+{
+    if (_sqes)
+        ::munmap(_sqes, _sqes_size);
+    if (_cq_ring && _cq_ring != _sq_ring)
+        ::munmap(_cq_ring, _cq_ring_size);
+    if (_sq_ring)
+        ::munmap(_sq_ring, _sq_ring_size);
+    if (_fd >= 0)
+        ::close(_fd);
+}
+
+bool io_uring_ring::open(unsigned entries_)
+{
+    io_uring_params params{};
+    params.flags      = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+    params.cq_entries = entries_ * 4;
+    _fd               = sys_io_uring_setup(entries_, &params);
+    if (_fd < 0 && errno == EINVAL)
+    {
+        // Kernels before 5.19 do not know cooperative task running, it is an optimization only
+        params            = {};
+        params.flags      = IORING_SETUP_CQSIZE;
+        params.cq_entries = entries_ * 4;
+        _fd               = sys_io_uring_setup(entries_, &params);
+    }
+    if (_fd < 0)
+        return false;
+
+    _sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        _sq_ring_size = _cq_ring_size = std::max(_sq_ring_size, _cq_ring_size);
+
+    _sq_ring = map_ring(_fd, _sq_ring_size, IORING_OFF_SQ_RING);
+    if (!_sq_ring)
+        return false;
+    _cq_ring = params.features & IORING_FEAT_SINGLE_MMAP ? _sq_ring : map_ring(_fd, _cq_ring_size, IORING_OFF_CQ_RING);
+    _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    _sqes      = static_cast<io_uring_sqe*>(map_ring(_fd, _sqes_size, IORING_OFF_SQES));
+    if (!_cq_ring || !_sqes)
+        return false;
+
+    auto sq     = static_cast<char*>(_sq_ring);
+    _sq_head    = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    _sq_tail    = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    _sq_mask    = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    _sq_entries = params.sq_entries;
+    _sqe_tail = _sqe_submitted = *_sq_tail;
+
+    // Submission queue entries are used in ring order, the indirection array is identity
+    auto sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    for (unsigned i = 0; i < _sq_entries; i++)
+    {
+        sq_array[i] = i;
+    }
+
+    auto cq  = static_cast<char*>(_cq_ring);
+    _cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    _cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    _cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    _cqes    = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    auto probe_size = sizeof(io_uring_probe) + IORING_OP_LAST * sizeof(io_uring_probe_op);
+    auto probe      = std::unique_ptr<io_uring_probe, decltype(&std::free)>(static_cast<io_uring_probe*>(std::calloc(1, probe_size)), &std::free);
+    if (probe && sys_io_uring_register(_fd, IORING_REGISTER_PROBE, probe.get(), IORING_OP_LAST) == 0)
+    {
+        for (unsigned i = 0; i < probe->ops_len && i < IORING_OP_LAST; i++)
+        {
+            _supported[probe->ops[i].op] = probe->ops[i].flags & IO_URING_OP_SUPPORTED;
+        }
+    }
+    return true;
+}
+
+io_uring_sqe* io_uring_ring::get_sqe()
+{
+    if (_sqe_tail - load_acquire(_sq_head) >= _sq_entries)
+        return nullptr;
+
+    auto sqe = &_sqes[_sqe_tail & *_sq_mask];
+    _sqe_tail++;
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int io_uring_ring::submit_and_wait(unsigned wait_nr_)
+{
+    store_release(_sq_tail, _sqe_tail);
+    auto to_submit = _sqe_tail - _sqe_submitted;
+
+    int ret = sys_io_uring_enter(_fd, to_submit, wait_nr_, wait_nr_ ? IORING_ENTER_GETEVENTS : 0);
+    if (ret < 0)
+        return -errno;
+    _sqe_submitted += static_cast<unsigned>(ret);
+    return ret;
+}
+
+int io_uring_ring::register_buffer_ring(void* ring_, unsigned entries_, uint16_t group_)
+{
+    io_uring_buf_reg reg{};
+    reg.ring_addr    = reinterpret_cast<uint64_t>(ring_);
+    reg.ring_entries = entries_;
+    reg.bgid         = group_;
+    return sys_io_uring_register(_fd, IORING_REGISTER_PBUF_RING, &reg, 1) == 0 ? 0 : -errno;
+}
+
+void io_uring_ring::unregister_buffer_ring(uint16_t group_)
+{
+    io_uring_buf_reg reg{};
+    reg.bgid = group_;
+    sys_io_uring_register(_fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+}
+
+unsigned io_uring_ring::load_acquire(const unsigned* value_)
+{
+    return std::atomic_ref<const unsigned>(*value_).load(std::memory_order_acquire);
+}
+
+void io_uring_ring::store_release(unsigned* value_, unsigned new_value_)
+{
+    std::atomic_ref<unsigned>(*value_).store(new_value_, std::memory_order_release);
+}
+
+provided_buffer_ring::~provided_buffer_ring()
+{
+    if (_buffers)
+        ::munmap(_buffers, _buffers_size);
+    if (_ring)
+        ::munmap(_ring, _ring_size);
+}
+
+bool provided_buffer_ring::open(io_uring_ring& ring_, uint16_t group_, unsigned count_, size_t buffer_len_)
+{
+    _uring        = &ring_;
+    _count        = std::bit_ceil(std::max(count_, 1u));
+    _buffer_len   = buffer_len_;
+    _group        = group_;
+    _ring_size    = _count * sizeof(io_uring_buf);
+    _buffers_size = _count * _buffer_len;
+
+    auto ring = ::mmap(nullptr, _ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED)
+        return false;
+    _ring = static_cast<io_uring_buf_ring*>(ring);
+
+    auto buffers = ::mmap(nullptr, _buffers_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffers == MAP_FAILED)
+        return false;
+    _buffers = static_cast<common::byte_t*>(buffers);
+
+    if (ring_.register_buffer_ring(_ring, _count, _group) == 0)
+    {
+        _mapped = true;
+        for (unsigned i = 0; i < _count; i++)
+        {
+            recycle(static_cast<uint16_t>(i));
+        }
+        if (selects_buffers())
+            return true;
+
+        ring_.unregister_buffer_ring(_group);
+        _mapped = false;
+        std::cerr << me() << "Buffer ring not used by the kernel, providing buffers by operations" << std::endl;
+    }
+
+    // Completion reports failure of providing the buffers, e.g. kernel without IORING_OP_PROVIDE_BUFFERS
+    if (!provide(0, _count, 0) || ring_.submit_and_wait(1) < 0)
+        return false;
+    int res{-EINVAL};
+    ring_.for_each_completion([&res](const io_uring_cqe& cqe_) { res = cqe_.res; });
+    if (res < 0)
+    {
+        std::cerr << me() << "Cannot provide buffers: " << std::strerror(-res) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void provided_buffer_ring::recycle(uint16_t id_)
+{
+    if (!_mapped)
+    {
+        // Completion is posted only if providing fails
+        provide(id_, 1, IOSQE_CQE_SKIP_SUCCESS);
+        return;
+    }
+
+    auto& buf = _ring->bufs[_tail & (_count - 1)];
+    buf.addr  = reinterpret_cast<uint64_t>(_buffers + static_cast<size_t>(id_) * _buffer_len);
+    buf.len   = static_cast<uint32_t>(_buffer_len);
+    buf.bid   = id_;
+    std::atomic_ref<uint16_t>(_ring->tail).store(++_tail, std::memory_order_release);
+}
+
+bool provided_buffer_ring::selects_buffers()
+{
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+        return false;
+
+    io_uring_cqe result{};
+    result.res  = -EINVAL;
+    auto sqe    = _uring->get_sqe();
+    if (sqe && ::write(fds[1], "x", 1) == 1)
+    {
+        sqe->opcode    = IORING_OP_RECV;
+        sqe->fd        = fds[0];
+        sqe->flags     = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = _group;
+        if (_uring->submit_and_wait(1) >= 0)
+            _uring->for_each_completion([&result](const io_uring_cqe& cqe_) { result = cqe_; });
+    }
+    ::close(fds[0]);
+    ::close(fds[1]);
+
+    if (result.res != 1 || !(result.flags & IORING_CQE_F_BUFFER))
+        return false;
+    recycle(static_cast<uint16_t>(result.flags >> IORING_CQE_BUFFER_SHIFT));
+    return true;
+}
+
+bool provided_buffer_ring::provide(uint16_t id_, unsigned count_, uint8_t sqe_flags_)
+{
+    auto sqe = _uring->get_sqe();
+    if (!sqe)
+    {
+        _uring->submit_and_wait(0);
+        sqe = _uring->get_sqe();
+    }
+    if (!sqe)
+        return false;
+
+    sqe->opcode    = IORING_OP_PROVIDE_BUFFERS;
+    sqe->flags     = sqe_flags_;
+    sqe->fd        = static_cast<int>(count_);
+    sqe->addr      = reinterpret_cast<uint64_t>(_buffers + static_cast<size_t>(id_) * _buffer_len);
+    sqe->len       = static_cast<uint32_t>(_buffer_len);
+    sqe->off       = id_;
+    sqe->buf_group = _group;
+    return true;
+}
+
+bool io_uring_backend_supported()
+{
+    // Multishot receive, the newest feature used, is available since Linux 6.0
+    utsname name{};
+    unsigned major{0}, minor{0};
+    if (::uname(&name) != 0 || std::sscanf(name.release, "%u.%u", &major, &minor) != 2 || major < 6)
+        return false;
+
+    io_uring_ring ring;
+    if (!ring.open(8) || !ring.supports(IORING_OP_ACCEPT) || !ring.supports(IORING_OP_RECV) || !ring.supports(IORING_OP_READ))
+        return false;
+
+    provided_buffer_ring buffers;
+    return buffers.open(ring, 0, 1, 64);
+}
+}
+
+#endif
@@ -0,0 +1,338 @@
+#include <storage/column_kernels.h>
+
+#include <algorithm>
+#include <bit>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HW_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace hw::storage::kernels
+{
+namespace
+{
+// Merge partial aggregate computed by vector loop
+void merge_partial(column_aggregate& aggregate_, size_t values_, size_t errors_, uint64_t sum_, uint16_t min_, uint16_t max_)
+{
+    aggregate_.errors += errors_;
+    if (values_ == errors_)
+        return;
+
+    aggregate_.count += values_ - errors_;
+    aggregate_.sum += sum_;
+    aggregate_.min = std::min(aggregate_.min, min_);
+    aggregate_.max = std::max(aggregate_.max, max_);
+}
+
+template <class ValueType>
+size_t count_above_scalar(std::span<const ValueType> column_, ValueType threshold_, ValueType error_value_)
+{
+    size_t count{0};
+    for (auto value : column_)
+    {
+        count += value > threshold_ && value != error_value_;
+    }
+    return count;
+}
+
+#ifdef HW_X86_KERNELS
+
+// Error lanes are excluded from sums and maximum by zeroing them and from minimum by setting them to all ones
+
+__attribute__((target("sse4.1"))) void aggregate_sse4(std::span<const uint16_t> column_, uint16_t error_value_, column_aggregate& aggregate_)
+{
+    const auto zero      = _mm_setzero_si128();
+    const auto error     = _mm_set1_epi16(static_cast<int16_t>(error_value_));
+    const auto low_bytes = _mm_set1_epi16(0x00ff);
+    auto min             = _mm_set1_epi16(-1);
+    auto max             = zero;
+    auto sum_low         = zero;
+    auto sum_high        = zero;
+    size_t errors{0};
+
+    size_t i = 0;
+    for (; i + 8 <= column_.size(); i += 8)
+    {
+        auto value    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(column_.data() + i));
+        auto is_error = _mm_cmpeq_epi16(value, error);
+        auto valid    = _mm_andnot_si128(is_error, value);
+        errors += static_cast<size_t>(std::popcount(static_cast<uint32_t>(_mm_movemask_epi8(is_error)))) / 2;
+        min      = _mm_min_epu16(min, _mm_or_si128(value, is_error));
+        max      = _mm_max_epu16(max, valid);
+        sum_low  = _mm_add_epi64(sum_low, _mm_sad_epu8(_mm_and_si128(valid, low_bytes), zero));
+        sum_high = _mm_add_epi64(sum_high, _mm_sad_epu8(_mm_srli_epi16(valid, 8), zero));
+    }
+
+    alignas(16) uint64_t sums[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(sums), sum_low);
+    _mm_store_si128(reinterpret_cast<__m128i*>(sums + 2), sum_high);
+    auto min_value = static_cast<uint16_t>(_mm_cvtsi128_si32(_mm_minpos_epu16(min)));
+    auto max_value = static_cast<uint16_t>(~_mm_cvtsi128_si32(_mm_minpos_epu16(_mm_xor_si128(max, _mm_set1_epi16(-1)))));
+    merge_partial(aggregate_, i, errors, sums[0] + sums[1] + ((sums[2] + sums[3]) << 8), min_value, max_value);
+
+    aggregate_column(column_.subspan(i), error_value_, aggregate_);
+}
+
+__attribute__((target("sse4.1"))) void aggregate_sse4(std::span<const uint8_t> column_, uint8_t error_value_, column_aggregate& aggregate_)
+{
+    const auto zero  = _mm_setzero_si128();
+    const auto error = _mm_set1_epi8(static_cast<int8_t>(error_value_));
+    auto min         = _mm_set1_epi8(-1);
+    auto max         = zero;
+    auto sum         = zero;
+    size_t errors{0};
+
+    size_t i = 0;
+    for (; i + 16 <= column_.size(); i += 16)
+    {
+        auto value    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(column_.data() + i));
+        auto is_error = _mm_cmpeq_epi8(value, error);
+        auto valid    = _mm_andnot_si128(is_error, value);
+        errors += static_cast<size_t>(std::popcount(static_cast<uint32_t>(_mm_movemask_epi8(is_error))));
+        min = _mm_min_epu8(min, _mm_or_si128(value, is_error));
+        max = _mm_max_epu8(max, valid);
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(valid, zero));
+    }
+
+    alignas(16) uint64_t sums[2];
+    alignas(16) uint8_t mins[16];
+    alignas(16) uint8_t maxs[16];
+    _mm_store_si128(reinterpret_cast<__m128i*>(sums), sum);
+    _mm_store_si128(reinterpret_cast<__m128i*>(mins), min);
+    _mm_store_si128(reinterpret_cast<__m128i*>(maxs), max);
+    merge_partial(aggregate_, i, errors, sums[0] + sums[1], *std::min_element(mins, mins + 16), *std::max_element(maxs, maxs + 16));
+
+    aggregate_column(column_.subspan(i), error_value_, aggregate_);
+}
+
+__attribute__((target("sse4.1"))) size_t count_above_sse4(std::span<const uint16_t> column_, uint16_t threshold_, uint16_t error_value_)
+{
+    if (threshold_ == UINT16_MAX)
+        return 0;
+
+    // value > threshold  <=>  max(value, threshold + 1) == value
+    const auto bound = _mm_set1_epi16(static_cast<int16_t>(threshold_ + 1));
+    const auto error = _mm_set1_epi16(static_cast<int16_t>(error_value_));
+    size_t count{0};
+
+    size_t i = 0;
+    for (; i + 8 <= column_.size(); i += 8)
+    {
+        auto value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(column_.data() + i));
+        auto above = _mm_andnot_si128(_mm_cmpeq_epi16(value, error), _mm_cmpeq_epi16(_mm_max_epu16(value, bound), value));
+        count += static_cast<size_t>(std::popcount(static_cast<uint32_t>(_mm_movemask_epi8(above)))) / 2;
+    }
+    return count + count_above_scalar(column_.subspan(i), threshold_, error_value_);
+}
+
+__attribute__((target("sse4.1"))) size_t count_above_sse4(std::span<const uint8_t> column_, uint8_t threshold_, uint8_t error_value_)
+{
+    if (threshold_ == UINT8_MAX)
+        return 0;
+
+    const auto bound = _mm_set1_epi8(static_cast<int8_t>(threshold_ + 1));
+    const auto error = _mm_set1_epi8(static_cast<int8_t>(error_value_));
+    size_t count{0};
+
+    size_t i = 0;
+    for (; i + 16 <= column_.size(); i += 16)
+    {
+        auto value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(column_.data() + i));
+        auto above = _mm_andnot_si128(_mm_cmpeq_epi8(value, error), _mm_cmpeq_epi8(_mm_max_epu8(value, bound), value));
+        count += static_cast<size_t>(std::popcount(static_cast<uint32_t>(_mm_movemask_epi8(above))));
+    }
+    return count + count_above_scalar(column_.subspan(i), threshold_, error_value_);
+}
+
+__attribute__((target("avx2"))) void aggregate_avx2(std::span<const uint16_t> column_, uint16_t error_value_, column_aggregate& aggregate_)
+{
+    const auto zero      = _mm256_setzero_si256();
+    const auto error     = _mm256_set1_epi16(static_cast<int16_t>(error_value_));
+    const auto low_bytes = _mm256_set1_epi16(0x00ff);
+    auto min             = _mm256_set1_epi16(-1);
+    auto max             = zero;
+    auto sum_low         = zero;
+    auto sum_high        = zero;
+    size_t errors{0};
+
+    size_t i = 0;
+    for (; i + 16 <= column_.size(); i += 16)
+    {
+        auto value    = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(column_.data() + i));
+        auto is_error = _mm256_cmpeq_epi16(value, error);
+        auto valid    = _mm256_andnot_si256(is_error, value);
+        errors += static_cast<size_t>(std::popcount(static_cast<uint32_t>(_mm256_movemask_epi8(is_error)))) / 2;
+        min      = _mm256_min_epu16(min, _mm256_or_si256(value, is_error));
+        max      = _mm256_max_epu16(max, valid);
+        sum_low  = _mm256_add_epi64(sum_low, _mm256_sad_epu8(_mm256_and_si256(valid, low_bytes), zero));
+        sum_high = _mm256_add_epi64(sum_high, _mm256_sad_epu8(_mm256_srli_epi16(valid, 8), zero));
+    }
+
+    alignas(32) uint64_t sums_low[4];
+    alignas(32) uint64_t sums_high[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(sums_low), sum_low);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(sums_high), sum_high);
+    auto min128    = _mm_min_epu16(_mm256_castsi256_si128(min), _mm256_extracti128_si256(min, 1));
+    auto max128    = _mm_max_epu16(_mm256_castsi256_si128(max), _mm256_extracti128_si256(max, 1));
+    auto min_value = static_cast<uint16_t>(_mm_cvtsi128_si32(_mm_minpos_epu16(min128)));
+    auto max_value = static_cast<uint16_t>(~_mm_cvtsi128_si32(_mm_minpos_epu16(_mm_xor_si128(max128, _mm_set1_epi16(-1)))));
+    uint64_t sum{0};
+    for (size_t lane = 0; lane < 4; lane++)
+    {
+        sum += sums_low[lane] + (sums_high[lane] << 8);
+    }
+    merge_partial(aggregate_, i, errors, sum, min_value, max_value);
+
+    aggregate_column(column_.subspan(i), error_value_, aggregate_);
+}
+
+__attribute__((target("avx2"))) void aggregate_avx2(std::span<const uint8_t> column_, uint8_t error_value_, column_aggregate& aggregate_)
+{
+    const auto zero  = _mm256_setzero_si256();
+    const auto error = _mm256_set1_epi8(static_cast<int8_t>(error_value_));
+    auto min         = _mm256_set1_epi8(-1);
+    auto max         = zero;
+    auto sum         = zero;
+    size_t errors{0};
+
+    size_t i = 0;
+    for (; i + 32 <= column_.size(); i += 32)
+    {
+        auto value    = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(column_.data() + i));
+        auto is_error = _mm256_cmpeq_epi8(value, error);
+        auto valid    = _mm256_andnot_si256(is_error, value);
+        errors += static_cast<size_t>(std::popcount(static_cast<uint32_t>(_mm256_movemask_epi8(is_error))));
+        min = _mm256_min_epu8(min, _mm256_or_si256(value, is_error));
+        max = _mm256_max_epu8(max, valid);
+        sum = _mm256_add_epi64(sum, _mm256_sad_epu8(valid, zero));
+    }
+
+    alignas(32) uint64_t sums[4];
+    alignas(32) uint8_t mins[32];
+    alignas(32) uint8_t maxs[32];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(sums), sum);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(mins), min);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(maxs), max);
+    merge_partial(aggregate_, i, errors, sums[0] + sums[1] + sums[2] + sums[3], *std::min_element(mins, mins + 32), *std::max_element(maxs, maxs + 32));
+
+    aggregate_column(column_.subspan(i), error_value_, aggregate_);
+}
+
+__attribute__((target("avx2"))) size_t count_above_avx2(std::span<const uint16_t> column_, uint16_t threshold_, uint16_t error_value_)
+{
+    if (threshold_ == UINT16_MAX)
+        return 0;
+
+    const auto bound = _mm256_set1_epi16(static_cast<int16_t>(threshold_ + 1));
+    const auto error = _mm256_set1_epi16(static_cast<int16_t>(error_value_));
+    size_t count{0};
+
+    size_t i = 0;
+    for (; i + 16 <= column_.size(); i += 16)
+    {
+        auto value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(column_.data() + i));
+        auto above = _mm256_andnot_si256(_mm256_cmpeq_epi16(value, error), _mm256_cmpeq_epi16(_mm256_max_epu16(value, bound), value));
+        count += static_cast<size_t>(std::popcount(static_cast<uint32_t>(_mm256_movemask_epi8(above)))) / 2;
+    }
+    return count + count_above_scalar(column_.subspan(i), threshold_, error_value_);
+}
+
+__attribute__((target("avx2"))) size_t count_above_avx2(std::span<const uint8_t> column_, uint8_t threshold_, uint8_t error_value_)
+{
+    if (threshold_ == UINT8_MAX)
+        return 0;
+
+    const auto bound = _mm256_set1_epi8(static_cast<int8_t>(threshold_ + 1));
+    const auto error = _mm256_set1_epi8(static_cast<int8_t>(error_value_));
+    size_t count{0};
+
+    size_t i = 0;
+    for (; i + 32 <= column_.size(); i += 32)
+    {
+        auto value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(column_.data() + i));
+        auto above = _mm256_andnot_si256(_mm256_cmpeq_epi8(value, error), _mm256_cmpeq_epi8(_mm256_max_epu8(value, bound), value));
+        count += static_cast<size_t>(std::popcount(static_cast<uint32_t>(_mm256_movemask_epi8(above))));
+    }
+    return count + count_above_scalar(column_.subspan(i), threshold_, error_value_);
+}
+
+#endif
+}
+
+isa best_isa()
+{
+    static const isa detected = [] {
+#ifdef HW_X86_KERNELS
+        if (__builtin_cpu_supports("avx2"))
+            return isa::avx2;
+        if (__builtin_cpu_supports("sse4.1"))
+            return isa::sse4;
+#endif
+        return isa::scalar;
+    }();
+    return detected;
+}
+
+bool supported(isa isa_)
+{
+    return isa_ <= best_isa();
+}
+
+const char* isa_name(isa isa_)
+{
+    switch (isa_)
+    {
+        case isa::sse4:
+            return "sse4";
+        case isa::avx2:
+            return "avx2";
+        default:
+            return "scalar";
+    }
+}
+
+void aggregate(std::span<const uint16_t> column_, uint16_t error_value_, column_aggregate& aggregate_, isa isa_)
+{
+#ifdef HW_X86_KERNELS
+    if (isa_ == isa::avx2 && supported(isa::avx2))
+        return aggregate_avx2(column_, error_value_, aggregate_);
+    if (isa_ == isa::sse4 && supported(isa::sse4))
+        return aggregate_sse4(column_, error_value_, aggregate_);
+#endif
+    aggregate_column(column_, error_value_, aggregate_);
+}
+
+void aggregate(std::span<const uint8_t> column_, uint8_t error_value_, column_aggregate& aggregate_, isa isa_)
+{
+#ifdef HW_X86_KERNELS
+    if (isa_ == isa::avx2 && supported(isa::avx2))
+        return aggregate_avx2(column_, error_value_, aggregate_);
+    if (isa_ == isa::sse4 && supported(isa::sse4))
+        return aggregate_sse4(column_, error_value_, aggregate_);
+#endif
+    aggregate_column(column_, error_value_, aggregate_);
+}
+
+size_t count_above(std::span<const uint16_t> column_, uint16_t threshold_, uint16_t error_value_, isa isa_)
+{
+#ifdef HW_X86_KERNELS
+    if (isa_ == isa::avx2 && supported(isa::avx2))
+        return count_above_avx2(column_, threshold_, error_value_);
+    if (isa_ == isa::sse4 && supported(isa::sse4))
+        return count_above_sse4(column_, threshold_, error_value_);
+#endif
+    return count_above_scalar(column_, threshold_, error_value_);
+}
+
+size_t count_above(std::span<const uint8_t> column_, uint8_t threshold_, uint8_t error_value_, isa isa_)
+{
+#ifdef HW_X86_KERNELS
+    if (isa_ == isa::avx2 && supported(isa::avx2))
+        return count_above_avx2(column_, threshold_, error_value_);
+    if (isa_ == isa::sse4 && supported(isa::sse4))
+        return count_above_sse4(column_, threshold_, error_value_);
+#endif
+    return count_above_scalar(column_, threshold_, error_value_);
+}
+}
@@ -0,0 +1,431 @@
+#include <storage/compressed_block.h>
+
+#include <bit>
+#include <span>
+
+#include <storage/column_kernels.h>
+
+namespace hw::storage
+{
+namespace
+{
+uint64_t zigzag(int64_t value_)
+{
+    return (static_cast<uint64_t>(value_) << 1) ^ static_cast<uint64_t>(value_ >> 63);
+}
+
+int64_t unzigzag(uint64_t value_)
+{
+    return static_cast<int64_t>(value_ >> 1) ^ -static_cast<int64_t>(value_ & 1);
+}
+
+// Widths of non-zero delta-of-delta timestamps, selected by prefix of 1 to 4 bits
+constexpr unsigned timestamp_widths[] = {12, 20, 32, 64};
+
+void encode_timestamps(bit_writer& writer_, std::span<const timestamp_t> timestamps_)
+{
+    if (timestamps_.empty())
+        return;
+
+    writer_.write(static_cast<uint64_t>(timestamps_[0]), 64);
+    int64_t delta{0};
+    for (size_t i = 1; i < timestamps_.size(); i++)
+    {
+        auto new_delta = timestamps_[i] - timestamps_[i - 1];
+        auto dod       = zigzag(new_delta - delta);
+        delta          = new_delta;
+
+        if (dod == 0)
+        {
+            writer_.write_bit(false);
+            continue;
+        }
+
+        size_t bucket{0};
+        while (bucket + 1 < std::size(timestamp_widths) && std::bit_width(dod) > timestamp_widths[bucket])
+        {
+            bucket++;
+        }
+        // Prefix is `bucket + 1` ones followed by zero, the zero is omitted for the last bucket
+        writer_.write((uint64_t{1} << (bucket + 1)) - 1, static_cast<unsigned>(bucket + 1));
+        if (bucket + 1 < std::size(timestamp_widths))
+            writer_.write_bit(false);
+        writer_.write(dod, timestamp_widths[bucket]);
+    }
+}
+
+// Decode timestamp encoded by encode_timestamps(...) from previous timestamp and delta, which are updated
+void decode_timestamp(bit_reader& reader_, bool first_, timestamp_t& timestamp_, int64_t& delta_)
+{
+    if (first_)
+    {
+        timestamp_ = static_cast<timestamp_t>(reader_.read(64));
+        return;
+    }
+
+    if (reader_.read_bit())
+    {
+        size_t bucket{0};
+        while (bucket + 1 < std::size(timestamp_widths) && reader_.read_bit())
+        {
+            bucket++;
+        }
+        delta_ += unzigzag(reader_.read(timestamp_widths[bucket]));
+    }
+    timestamp_ += delta_;
+}
+
+// Sequential decoder of timestamps encoded by encode_timestamps(...)
+class timestamp_decoder
+{
+public:
+    explicit timestamp_decoder(bit_reader& reader_)
+        : _reader(reader_)
+    {}
+
+    timestamp_t next()
+    {
+        decode_timestamp(_reader, _first, _timestamp, _delta);
+        _first = false;
+        return _timestamp;
+    }
+
+private:
+    bit_reader& _reader;
+    bool _first{true};
+    timestamp_t _timestamp{0};
+    int64_t _delta{0};
+};
+
+template <class ValueType>
+void encode_column(bit_writer& writer_, std::span<const ValueType> values_)
+{
+    if (values_.empty())
+        return;
+
+    unsigned width{0};
+    for (size_t i = 1; i < values_.size(); i++)
+    {
+        width = std::max<unsigned>(width, std::bit_width(zigzag(int64_t{values_[i]} - values_[i - 1])));
+    }
+
+    writer_.write(values_[0], sizeof(ValueType) * 8);
+    writer_.write(width, 5);
+    if (width == 0)
+        return;
+
+    for (size_t i = 1; i < values_.size(); i++)
+    {
+        auto delta = zigzag(int64_t{values_[i]} - values_[i - 1]);
+        writer_.write_bit(delta != 0);
+        if (delta != 0)
+            writer_.write(delta, width);
+    }
+}
+
+// Skip column encoded by encode_column(...)
+void skip_column(bit_reader& reader_, unsigned value_bits_, size_t count_)
+{
+    if (count_ == 0)
+        return;
+
+    reader_.read(value_bits_);
+    auto width = static_cast<unsigned>(reader_.read(5));
+    if (width == 0)
+        return;
+
+    for (size_t i = 1; i < count_; i++)
+    {
+        if (reader_.read_bit())
+            reader_.read(width);
+    }
+}
+}
+
+compressed_block::compressed_block(const measurement_block& block_, std::vector<uint64_t>& buffer_, std::pmr::memory_resource* resource_)
+    : _count(block_.size())
+    , _temperatures_count(block_.temperatures_count())
+    , _fans_count(block_.fans_count())
+    , _first_timestamp(block_.empty() ? 0 : block_.timestamps().front())
+    , _last_timestamp(block_.empty() ? 0 : block_.timestamps().back())
+    , _words(resource_)
+    , _columns(_count >= indexed_size ? _temperatures_count + _fans_count : 0, resource_)
+{
+    bit_writer writer(buffer_);
+    encode_timestamps(writer, block_.timestamps());
+    for (size_t i = 0; i < _temperatures_count; i++)
+    {
+        if (!_columns.empty())
+        {
+            _columns[i].offset = writer.bits();
+            kernels::aggregate(block_.temperatures(i), device_control_messages::measurement::error_temperature, _columns[i].aggregate);
+        }
+        encode_column(writer, block_.temperatures(i));
+    }
+    for (size_t i = 0; i < _fans_count; i++)
+    {
+        if (!_columns.empty())
+        {
+            auto& col  = _columns[_temperatures_count + i];
+            col.offset = writer.bits();
+            kernels::aggregate(block_.fans(i), device_control_messages::measurement::error_fan_speed, col.aggregate);
+        }
+        encode_column(writer, block_.fans(i));
+    }
+    _words.assign(buffer_.begin(), buffer_.end());
+}
+
+void compressed_block::decode(measurement_block& block_) const
+{
+    block_.reset(_temperatures_count, _fans_count);
+
+    bit_reader reader(_words);
+    timestamp_decoder timestamps(reader);
+    auto timestamps_data = block_.timestamps_data();
+    for (size_t i = 0; i < _count; i++)
+    {
+        timestamps_data[i] = timestamps.next();
+    }
+    // Columns follow one another, each of them is read where the previous one ended
+    for (size_t i = 0; i < _temperatures_count; i++)
+    {
+        auto cursor = start_column(reader, 16, _count);
+        read_column(cursor, block_.temperatures_data(i), _count);
+        reader = cursor.reader;
+    }
+    for (size_t i = 0; i < _fans_count; i++)
+    {
+        auto cursor = start_column(reader, 8, _count);
+        read_column(cursor, block_.fans_data(i), _count);
+        reader = cursor.reader;
+    }
+
+    block_.set_size(_count);
+    block_.drop_front(_first);
+}
+
+void compressed_block::save(std::vector<common::byte_t>& buffer_) const
+{
+    put<uint64_t>(buffer_, _count);
+    put<uint64_t>(buffer_, _first);
+    put<uint64_t>(buffer_, _temperatures_count);
+    put<uint64_t>(buffer_, _fans_count);
+    put<int64_t>(buffer_, _first_timestamp);
+    put<int64_t>(buffer_, _last_timestamp);
+    put<uint64_t>(buffer_, _columns.size());
+    for (const auto& col : _columns)
+    {
+        put<uint64_t>(buffer_, col.aggregate.count);
+        put<uint64_t>(buffer_, col.aggregate.errors);
+        put<uint64_t>(buffer_, col.aggregate.sum);
+        put<uint16_t>(buffer_, col.aggregate.min);
+        put<uint16_t>(buffer_, col.aggregate.max);
+        put<uint64_t>(buffer_, col.offset);
+    }
+    put<uint64_t>(buffer_, _words.size());
+    for (auto word : _words)
+    {
+        put<uint64_t>(buffer_, word);
+    }
+}
+
+std::optional<compressed_block> compressed_block::load(byte_reader& reader_, std::pmr::memory_resource* resource_)
+{
+    compressed_block block(resource_);
+    uint64_t columns_count{0};
+    if (!reader_.read(block._count) || !reader_.read(block._first) || !reader_.read(block._temperatures_count) || !reader_.read(block._fans_count)
+        || !reader_.read(block._first_timestamp) || !reader_.read(block._last_timestamp) || !reader_.read(columns_count))
+        return std::nullopt;
+    // Not indexed block has no columns, indexed block has all of them
+    if (block._first > block._count || (columns_count != 0 && columns_count != block._temperatures_count + block._fans_count))
+        return std::nullopt;
+
+    block._columns.resize(columns_count);
+    for (auto& col : block._columns)
+    {
+        if (!reader_.read(col.aggregate.count) || !reader_.read(col.aggregate.errors) || !reader_.read(col.aggregate.sum)
+            || !reader_.read(col.aggregate.min) || !reader_.read(col.aggregate.max) || !reader_.read(col.offset))
+            return std::nullopt;
+    }
+
+    uint64_t words_count{0};
+    if (!reader_.read(words_count) || reader_.remaining() / sizeof(uint64_t) < words_count)
+        return std::nullopt;
+    block._words.resize(words_count);
+    for (auto& word : block._words)
+    {
+        reader_.read(word);
+    }
+    for (const auto& col : block._columns)
+    {
+        if (col.offset > words_count * 64)
+            return std::nullopt;
+    }
+    return block;
+}
+
+size_t compressed_block::drop_front_before(timestamp_t timestamp_)
+{
+    if (empty() || _first_timestamp >= timestamp_)
+        return 0;
+
+    bit_reader reader(_words);
+    timestamp_decoder timestamps(reader);
+    auto first = _first;
+    for (size_t i = 0; i < _count; i++)
+    {
+        auto t = timestamps.next();
+        if (i < first)
+            continue;
+        if (t >= timestamp_)
+        {
+            _first_timestamp = t;
+            break;
+        }
+        _first = i + 1;
+    }
+    return _first - first;
+}
+
+size_t compressed_block::count_between(timestamp_t from_, timestamp_t to_) const
+{
+    if (empty() || from_ >= to_ || _first_timestamp >= to_ || _last_timestamp < from_)
+        return 0;
+
+    bit_reader reader(_words);
+    timestamp_decoder timestamps(reader);
+    size_t count{0};
+    for (size_t i = 0; i < _count; i++)
+    {
+        auto t = timestamps.next();
+        if (t >= to_)
+            break;
+        if (i >= _first && t >= from_)
+            count++;
+    }
+    return count;
+}
+
+compressed_block::column_cursor compressed_block::open_column(size_t column_, unsigned value_bits_) const
+{
+    bit_reader reader(_words);
+    if (_count != 0 && !_columns.empty())
+    {
+        reader.seek(_columns[column_].offset);
+    }
+    else if (_count != 0)
+    {
+        timestamp_decoder timestamps(reader);
+        for (size_t i = 0; i < _count; i++)
+        {
+            timestamps.next();
+        }
+        for (size_t i = 0; i < column_; i++)
+        {
+            skip_column(reader, i < _temperatures_count ? 16 : 8, _count);
+        }
+    }
+    return start_column(reader, value_bits_, _count);
+}
+
+compressed_block::column_cursor compressed_block::start_column(bit_reader reader_, unsigned value_bits_, size_t count_)
+{
+    column_cursor cursor{reader_, 0, 0, 0};
+    if (count_ == 0)
+        return cursor;
+
+    cursor.value = static_cast<int64_t>(cursor.reader.read(value_bits_));
+    cursor.width = static_cast<unsigned>(cursor.reader.read(5));
+    return cursor;
+}
+
+void compressed_block::advance_column(column_cursor& cursor_)
+{
+    // The first value is stored in full, the following ones as deltas
+    if (cursor_.index != 0 && cursor_.width != 0 && cursor_.reader.read_bit())
+        cursor_.value += unzigzag(cursor_.reader.read(cursor_.width));
+    cursor_.index++;
+}
+
+template <class ValueType>
+void compressed_block::read_column(column_cursor& cursor_, ValueType* values_, size_t count_)
+{
+    for (size_t i = 0; i < count_; i++)
+    {
+        advance_column(cursor_);
+        values_[i] = static_cast<ValueType>(cursor_.value);
+    }
+}
+
+template void compressed_block::read_column<uint16_t>(column_cursor&, uint16_t*, size_t);
+template void compressed_block::read_column<uint8_t>(column_cursor&, uint8_t*, size_t);
+
+compressed_block::row_cursor::row_cursor(const compressed_block& block_)
+    : _block(block_)
+    , _timestamps(block_._words)
+    , _resource(_buffer.data(), _buffer.size())
+    , _columns(&_resource)
+{
+    if (_block._count == 0)
+        return;
+
+    auto columns = _block._temperatures_count + _block._fans_count;
+    _columns.reserve(columns);
+    if (!_block._columns.empty())
+    {
+        for (size_t i = 0; i < columns; i++)
+        {
+            _columns.push_back(_block.open_column(i, i < _block._temperatures_count ? 16 : 8));
+        }
+        return;
+    }
+
+    // Columns of blocks which are not indexed follow timestamps one after another
+    bit_reader reader(_block._words);
+    timestamp_decoder timestamps(reader);
+    for (size_t i = 0; i < _block._count; i++)
+    {
+        timestamps.next();
+    }
+    for (size_t i = 0; i < columns; i++)
+    {
+        unsigned value_bits = i < _block._temperatures_count ? 16 : 8;
+        _columns.push_back(start_column(reader, value_bits, _block._count));
+        skip_column(reader, value_bits, _block._count);
+    }
+}
+
+bool compressed_block::row_cursor::next()
+{
+    // Dropped measurements are decoded and skipped
+    do
+    {
+        if (_index == _block._count)
+            return false;
+
+        decode_timestamp(_timestamps, _index == 0, _timestamp, _delta);
+        for (auto& column : _columns)
+        {
+            advance_column(column);
+        }
+        _index++;
+    } while (_index <= _block._first);
+    return true;
+}
+
+device_control_messages::measurement compressed_block::row_cursor::to_message(const std::string& device_name_) const
+{
+    device_control_messages::measurement measurement(device_name_);
+    measurement.temperature_sensors.reserve(temperatures_count());
+    for (size_t i = 0; i < temperatures_count(); i++)
+    {
+        measurement.temperature_sensors.push_back(temperature(i));
+    }
+    measurement.fans_speed.reserve(fans_count());
+    for (size_t i = 0; i < fans_count(); i++)
+    {
+        measurement.fans_speed.push_back(fan_speed(i));
+    }
+    return measurement;
+}
+}
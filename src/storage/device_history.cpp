@@ -0,0 +1,421 @@
+#include <storage/device_history.h>
+
+#include <storage/column_kernels.h>
+
+namespace hw::storage
+{
+namespace
+{
+// Count values of block above threshold from its aggregate when all of them are on the same side of the threshold
+bool count_above_whole(const column_aggregate& aggregate_, uint16_t threshold_, size_t& count_)
+{
+    if (aggregate_.count == 0 || aggregate_.max <= threshold_)
+        return true;
+    if (aggregate_.min <= threshold_)
+        return false;
+    count_ += aggregate_.count;
+    return true;
+}
+}
+
+void device_history::append(timestamp_t timestamp_, const device_control_messages::measurement& measurement_)
+{
+    timestamp_ = _last_timestamp = std::max(timestamp_, _last_timestamp);
+
+    block_for(measurement_).append(timestamp_, measurement_);
+    _measurements_count++;
+
+    if (_retention.limited())
+        enforce_retention(timestamp_);
+}
+
+measurement_block& device_history::block_for(const device_control_messages::measurement& measurement_)
+{
+    if (_blocks.empty() || !_blocks.back().accepts(measurement_))
+    {
+        if (_compress && !_blocks.empty())
+        {
+            // Current block is sealed and its segment is reused for new measurements
+            if (!_blocks.back().empty())
+            {
+                _sealed.emplace_back(_blocks.back(), _encode_buffer, _resource);
+                _blocks_memory += _sealed.back().memory_size();
+            }
+            _blocks_memory -= _blocks.back().memory_size();
+            _blocks.back().reset(measurement_.temperature_sensors.size(), measurement_.fans_speed.size());
+        }
+        else if (!_blocks.empty() && _blocks.back().empty())
+        {
+            // Current block was emptied by eviction before it got full, reuse it for measurements of the new shape
+            _blocks_memory -= _blocks.back().memory_size();
+            _blocks.back().reset(measurement_.temperature_sensors.size(), measurement_.fans_speed.size());
+        }
+        else if (_spare_block)
+        {
+            _blocks.push_back(std::move(*_spare_block));
+            _spare_block.reset();
+            _blocks.back().reset(measurement_.temperature_sensors.size(), measurement_.fans_speed.size());
+        }
+        else
+        {
+            _blocks.emplace_back(measurement_.temperature_sensors.size(), measurement_.fans_speed.size(), _block_capacity, _resource);
+        }
+        _blocks_memory += _blocks.back().memory_size();
+    }
+    return _blocks.back();
+}
+
+void device_history::append(timestamp_t timestamp_, const device_control_messages::error& error_)
+{
+    timestamp_ = _last_timestamp = std::max(timestamp_, _last_timestamp);
+    _errors.push_back(stored_error{timestamp_, error_.err_type, _measurements_count});
+
+    if (_retention.limited())
+        enforce_retention(timestamp_);
+}
+
+void device_history::enforce_retention(timestamp_t now_)
+{
+    if (_retention.max_messages)
+    {
+        while (size() > _retention.max_messages)
+        {
+            evict_oldest();
+        }
+    }
+
+    if (_retention.max_age.count())
+    {
+        auto limit = now_ - std::chrono::duration_cast<std::chrono::nanoseconds>(_retention.max_age).count();
+        while (size() != 0)
+        {
+            if (!oldest_is_error() && !_sealed.empty())
+            {
+                // Timestamps never decrease, so all measurements of the sealed block older than the limit are evicted at once
+                auto dropped = _sealed.front().drop_front_before(limit);
+                if (dropped == 0)
+                    break;
+                _measurements_evicted += dropped;
+                release_front_sealed();
+                continue;
+            }
+
+            auto oldest = oldest_is_error() ? _errors.front().timestamp : _blocks.front().timestamps().front();
+            if (oldest >= limit)
+                break;
+            evict_oldest();
+        }
+    }
+
+    if (_retention.max_memory_bytes)
+    {
+        while (memory_size() > _retention.max_memory_bytes && (blocks_count() > 1 || !_errors.empty()))
+        {
+            if (oldest_is_error() || blocks_count() == 1)
+                _errors.pop_front();
+            else
+                evict_oldest_block();
+        }
+    }
+}
+
+void device_history::save(std::vector<common::byte_t>& buffer_) const
+{
+    put<uint64_t>(buffer_, _measurements_count);
+    put<uint64_t>(buffer_, _measurements_evicted);
+    put<int64_t>(buffer_, _last_timestamp);
+
+    put<uint64_t>(buffer_, _sealed.size());
+    for (const auto& sealed : _sealed)
+    {
+        sealed.save(buffer_);
+    }
+
+    // Blocks being filled are saved row by row, so they can be restored with different block capacity
+    put<uint64_t>(buffer_, _blocks.size());
+    for (const auto& block : _blocks)
+    {
+        put<uint64_t>(buffer_, block.temperatures_count());
+        put<uint64_t>(buffer_, block.fans_count());
+        put<uint64_t>(buffer_, block.size());
+        for (size_t row = 0; row < block.size(); row++)
+        {
+            put<int64_t>(buffer_, block.timestamps()[row]);
+            for (size_t i = 0; i < block.temperatures_count(); i++)
+            {
+                put<uint16_t>(buffer_, block.temperatures(i)[row]);
+            }
+            for (size_t i = 0; i < block.fans_count(); i++)
+            {
+                put<uint8_t>(buffer_, block.fans(i)[row]);
+            }
+        }
+    }
+
+    put<uint64_t>(buffer_, _errors.size());
+    for (const auto& err : _errors)
+    {
+        put<int64_t>(buffer_, err.timestamp);
+        put<uint64_t>(buffer_, static_cast<uint64_t>(err.err_type));
+        put<uint64_t>(buffer_, err.measurement_position);
+    }
+}
+
+bool device_history::load(std::span<const common::byte_t> data_)
+{
+    _sealed.clear();
+    _blocks.clear();
+    _errors.clear();
+    _blocks_memory = 0;
+
+    byte_reader reader(data_);
+    uint64_t measurements_count{0};
+    uint64_t count{0};
+    if (!reader.read(measurements_count) || !reader.read(_measurements_evicted) || !reader.read(_last_timestamp) || !reader.read(count))
+        return false;
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        auto sealed = compressed_block::load(reader, _resource);
+        if (!sealed)
+            return false;
+        _blocks_memory += sealed->memory_size();
+        _sealed.push_back(std::move(*sealed));
+    }
+
+    if (!reader.read(count))
+        return false;
+    device_control_messages::measurement row("");
+    for (uint64_t i = 0; i < count; i++)
+    {
+        uint64_t temperatures_count{0};
+        uint64_t fans_count{0};
+        uint64_t rows_count{0};
+        if (!reader.read(temperatures_count) || !reader.read(fans_count) || !reader.read(rows_count) || temperatures_count > reader.remaining()
+            || fans_count > reader.remaining() || reader.remaining() / (8 + 2 * temperatures_count + fans_count) < rows_count)
+            return false;
+
+        row.temperature_sensors.resize(temperatures_count);
+        row.fans_speed.resize(fans_count);
+        for (uint64_t r = 0; r < rows_count; r++)
+        {
+            timestamp_t timestamp{0};
+            bool ok = reader.read(timestamp);
+            for (auto& value : row.temperature_sensors)
+            {
+                ok = ok && reader.read(value);
+            }
+            for (auto& value : row.fans_speed)
+            {
+                ok = ok && reader.read(value);
+            }
+            if (!ok)
+                return false;
+            block_for(row).append(timestamp, row);
+        }
+    }
+
+    if (!reader.read(count))
+        return false;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        stored_error err{};
+        uint64_t err_type{0};
+        if (!reader.read(err.timestamp) || !reader.read(err_type) || !reader.read(err.measurement_position)
+            || err_type >= device_control_messages::error::error_types_count)
+            return false;
+        err.err_type = static_cast<device_control_messages::error::error_type>(err_type);
+        _errors.push_back(err);
+    }
+
+    _measurements_count = measurements_count;
+    return reader.remaining() == 0;
+}
+
+bool device_history::oldest_is_error() const
+{
+    return !_errors.empty() && (measurements_count() == 0 || _errors.front().measurement_position <= _measurements_evicted);
+}
+
+void device_history::evict_oldest()
+{
+    if (oldest_is_error())
+    {
+        _errors.pop_front();
+        return;
+    }
+
+    _measurements_evicted++;
+    if (!_sealed.empty())
+    {
+        _sealed.front().drop_front(1);
+        release_front_sealed();
+        return;
+    }
+
+    _blocks.front().drop_front(1);
+    recycle_front_block();
+}
+
+void device_history::evict_oldest_block()
+{
+    if (!_sealed.empty())
+    {
+        _measurements_evicted += _sealed.front().size();
+        _sealed.front().drop_front(_sealed.front().size());
+        release_front_sealed();
+        return;
+    }
+
+    _measurements_evicted += _blocks.front().size();
+    _blocks.front().drop_front(_blocks.front().size());
+    recycle_front_block();
+}
+
+void device_history::recycle_front_block()
+{
+    // Block which is still being filled stays in place even when emptied
+    if (!_blocks.front().empty() || _blocks.size() == 1)
+        return;
+
+    _blocks_memory -= _blocks.front().memory_size();
+    _spare_block.emplace(std::move(_blocks.front()));
+    _blocks.pop_front();
+}
+
+void device_history::release_front_sealed()
+{
+    if (!_sealed.front().empty())
+        return;
+
+    _blocks_memory -= _sealed.front().memory_size();
+    _sealed.pop_front();
+}
+
+size_t device_history::count_between(timestamp_t from_, timestamp_t to_) const
+{
+    if (from_ >= to_)
+        return 0;
+
+    size_t count = static_cast<size_t>(first_error_at(to_) - first_error_at(from_));
+    for (auto sealed = first_sealed_at(from_); sealed != _sealed.end() && sealed->first_timestamp() < to_; sealed++)
+    {
+        // Only blocks on the boundaries of the range are decoded
+        if (from_ <= sealed->first_timestamp() && sealed->last_timestamp() < to_)
+            count += sealed->size();
+        else
+            count += sealed->count_between(from_, to_);
+    }
+    for (auto block = first_block_at(from_); block != _blocks.end() && !block->empty() && block->timestamps().front() < to_; block++)
+    {
+        count += first_row_at(*block, to_) - first_row_at(*block, from_);
+    }
+    return count;
+}
+
+std::vector<device_control_messages::device_message_type> device_history::messages(const std::string& device_name_) const
+{
+    std::vector<device_control_messages::device_message_type> result;
+    result.reserve(size());
+    for_each_message(device_name_, [&result](const auto& view_) { result.emplace_back(view_.to_message()); });
+    return result;
+}
+
+void device_history::messages(const std::string& device_name_, std::vector<device_control_messages::measurement>& messages_) const
+{
+    messages_.reserve(messages_.size() + measurements_count());
+    for_each_measurement(device_name_, [&messages_](const measurement_view& view_) { messages_.push_back(view_.to_message()); });
+}
+
+void device_history::messages(const std::string& device_name_, std::vector<device_control_messages::error>& messages_) const
+{
+    messages_.reserve(messages_.size() + _errors.size());
+    for_each_error(device_name_, [&messages_](const error_view& view_) { messages_.push_back(view_.to_message()); });
+}
+
+template <class Whole, class Values>
+void device_history::scan_temperatures(size_t sensor_, Whole&& whole_, Values&& values_) const
+{
+    for (const auto& sealed : _sealed)
+    {
+        if (sensor_ >= sealed.temperatures_count())
+            continue;
+        auto aggregate = sealed.temperature_aggregate(sensor_);
+        if (!aggregate || !whole_(*aggregate))
+            sealed.visit_temperatures(sensor_, values_);
+    }
+    for (const auto& block : _blocks)
+    {
+        if (sensor_ < block.temperatures_count())
+            values_(block.temperatures(sensor_));
+    }
+}
+
+template <class Whole, class Values>
+void device_history::scan_fans(size_t fan_, Whole&& whole_, Values&& values_) const
+{
+    for (const auto& sealed : _sealed)
+    {
+        if (fan_ >= sealed.fans_count())
+            continue;
+        auto aggregate = sealed.fan_aggregate(fan_);
+        if (!aggregate || !whole_(*aggregate))
+            sealed.visit_fans(fan_, values_);
+    }
+    for (const auto& block : _blocks)
+    {
+        if (fan_ < block.fans_count())
+            values_(block.fans(fan_));
+    }
+}
+
+column_aggregate device_history::aggregate_temperature(size_t sensor_) const
+{
+    column_aggregate aggregate;
+    scan_temperatures(
+        sensor_,
+        [&aggregate](const column_aggregate& block_) {
+            aggregate.merge(block_);
+            return true;
+        },
+        [&aggregate](std::span<const uint16_t> values_) { kernels::aggregate(values_, device_control_messages::measurement::error_temperature, aggregate); });
+    return aggregate;
+}
+
+column_aggregate device_history::aggregate_fan_speed(size_t fan_) const
+{
+    column_aggregate aggregate;
+    scan_fans(
+        fan_,
+        [&aggregate](const column_aggregate& block_) {
+            aggregate.merge(block_);
+            return true;
+        },
+        [&aggregate](std::span<const uint8_t> values_) { kernels::aggregate(values_, device_control_messages::measurement::error_fan_speed, aggregate); });
+    return aggregate;
+}
+
+size_t device_history::count_temperature_above(size_t sensor_, uint16_t threshold_) const
+{
+    size_t count{0};
+    scan_temperatures(
+        sensor_,
+        [&count, threshold_](const column_aggregate& block_) { return count_above_whole(block_, threshold_, count); },
+        [&count, threshold_](std::span<const uint16_t> values_) {
+            count += kernels::count_above(values_, threshold_, device_control_messages::measurement::error_temperature);
+        });
+    return count;
+}
+
+size_t device_history::count_fan_speed_above(size_t fan_, uint8_t threshold_) const
+{
+    size_t count{0};
+    scan_fans(
+        fan_,
+        [&count, threshold_](const column_aggregate& block_) { return count_above_whole(block_, threshold_, count); },
+        [&count, threshold_](std::span<const uint8_t> values_) {
+            count += kernels::count_above(values_, threshold_, device_control_messages::measurement::error_fan_speed);
+        });
+    return count;
+}
+}
@@ -0,0 +1,540 @@
+#include <storage/message_log.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <device_control_messages/message_binary_converter.h>
+#include <storage/byte_stream.h>
+
+/**
+ * Record format (integers are little endian):
+ *
+ * | length (4B) | checksum (4B) | timestamp (8B) | message in binary format |
+ *
+ * Length covers timestamp and message, checksum is FNV-1a of timestamp and message. Record with invalid length or checksum marks the end
+ * of valid data, it is a remainder of write interrupted by crash.
+ *
+ * Checkpoint format:
+ *
+ * | magic (4B) | segment (8B) | offset (8B) | devices count (8B) | devices... | checksum (4B) |
+ *
+ * where every device is
+ *
+ * | name length (4B) | name | measurements (8B) | errors (8B) | errors by type (8B each) | history length (8B) | history |
+ *
+ * and history is stored history of the device written by device_history::save(...).
+ */
+
+namespace hw::storage
+{
+namespace
+{
+constexpr size_t record_header_len   = 16;         // length, checksum and timestamp
+constexpr uint32_t checkpoint_magic  = 0x33434c48; // "HLC3"
+constexpr char checkpoint_file[]     = "checkpoint";
+constexpr char checkpoint_tmp_file[] = "checkpoint.tmp";
+
+uint32_t checksum(std::span<const common::byte_t> data_)
+{
+    uint32_t hash = 2166136261u;
+    for (auto byte : data_)
+    {
+        hash = (hash ^ byte) * 16777619u;
+    }
+    return hash;
+}
+
+std::filesystem::path segment_path(const std::filesystem::path& directory_, uint64_t segment_)
+{
+    char name[40];
+    std::snprintf(name, sizeof(name), "segment-%020llu.log", static_cast<unsigned long long>(segment_));
+    return directory_ / name;
+}
+
+std::optional<uint64_t> segment_index(const std::filesystem::path& path_)
+{
+    auto name = path_.filename().string();
+    if (name.size() != 32 || !name.starts_with("segment-") || !name.ends_with(".log"))
+        return std::nullopt;
+
+    uint64_t index{0};
+    for (auto c : name.substr(8, 20))
+    {
+        if (c < '0' || c > '9')
+            return std::nullopt;
+        index = index * 10 + static_cast<uint64_t>(c - '0');
+    }
+    return index;
+}
+
+// Sorted indexes of segment files in directory
+std::optional<std::vector<uint64_t>> list_segments(const std::filesystem::path& directory_)
+{
+    std::error_code ec;
+    std::vector<uint64_t> segments;
+    for (const auto& entry : std::filesystem::directory_iterator(directory_, ec))
+    {
+        if (auto index = segment_index(entry.path()))
+            segments.push_back(*index);
+    }
+    if (ec)
+        return std::nullopt;
+
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+// Read-only memory mapping of whole file
+class mapped_file
+{
+public:
+    explicit mapped_file(const std::filesystem::path& path_)
+    {
+        int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return;
+
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            auto addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED)
+            {
+                _data = static_cast<const common::byte_t*>(addr);
+                _size = static_cast<size_t>(st.st_size);
+                ::madvise(addr, _size, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+    }
+
+    ~mapped_file()
+    {
+        if (_data)
+            ::munmap(const_cast<common::byte_t*>(_data), _size);
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    std::span<const common::byte_t> data() const { return {_data, _size}; }
+
+private:
+    const common::byte_t* _data{nullptr};
+    size_t _size{0};
+};
+
+bool write_all(int fd_, const common::byte_t* data_, size_t len_)
+{
+    while (len_)
+    {
+        auto written = ::write(fd_, data_, len_);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data_ += written;
+        len_ -= static_cast<size_t>(written);
+    }
+    return true;
+}
+}
+
+message_log::message_log(const message_log_config& config_, log_position start_, checkpoint_provider provider_)
+    : _config(config_)
+    , _start(start_)
+    , _provider(std::move(provider_))
+    , _next_position(start_)
+    , _durable_position(start_)
+{}
+
+message_log::~message_log()
+{
+    close();
+}
+
+void message_log::close()
+{
+    if (_writer.joinable())
+    {
+        {
+            std::lock_guard lock(_mtx);
+            _stop = true;
+        }
+        _cv.notify_one();
+        _writer.join();
+    }
+    close_segment();
+}
+
+bool message_log::open()
+{
+    std::error_code ec;
+    std::filesystem::create_directories(_config.directory, ec);
+    if (ec)
+    {
+        std::cerr << me() << "Cannot create log directory " << _config.directory << ": " << ec.message() << std::endl;
+        return false;
+    }
+
+    // Segments behind the start position contain only data which failed recovery
+    auto segments = list_segments(_config.directory);
+    if (!segments)
+    {
+        std::cerr << me() << "Cannot read log directory " << _config.directory << std::endl;
+        return false;
+    }
+    for (auto segment : *segments)
+    {
+        if (segment > _start.segment)
+            std::filesystem::remove(segment_path(_config.directory, segment), ec);
+    }
+
+    if (!open_segment(_start.segment))
+        return false;
+
+    if (::ftruncate(_fd, static_cast<off_t>(_start.offset)) != 0 || ::lseek(_fd, 0, SEEK_END) < 0)
+    {
+        std::cerr << me() << "Cannot truncate segment " << _start.segment << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    _writer_stopped = false;
+    _writer         = std::thread([this] { writer_loop(); });
+    return true;
+}
+
+void message_log::append(timestamp_t timestamp_, const device_control_messages::device_message_type& message_)
+{
+    std::lock_guard lock(_mtx);
+
+    if (_pending.empty() || _pending.back().segment != _next_position.segment)
+        _pending.push_back(chunk{_next_position.segment, {}});
+
+    auto& buffer = _pending.back().data;
+    auto start   = buffer.size();
+    buffer.resize(start + record_header_len);
+    device_control_messages::binary_serializer::serialize(message_, buffer);
+
+    auto record_len = buffer.size() - start;
+    auto body_len   = record_len - 8;
+    for (size_t i = 0; i < 8; i++)
+    {
+        buffer[start + 8 + i] = static_cast<common::byte_t>(static_cast<uint64_t>(timestamp_) >> (8 * i));
+    }
+    auto sum = checksum(std::span<const common::byte_t>(buffer).subspan(start + 8, body_len));
+    for (size_t i = 0; i < 4; i++)
+    {
+        buffer[start + i]     = static_cast<common::byte_t>(body_len >> (8 * i));
+        buffer[start + 4 + i] = static_cast<common::byte_t>(sum >> (8 * i));
+    }
+
+    _next_position.offset += record_len;
+    if (_next_position.offset >= _config.segment_size)
+        _next_position = log_position{_next_position.segment + 1, 0};
+}
+
+log_position message_log::position()
+{
+    std::lock_guard lock(_mtx);
+    return _next_position;
+}
+
+bool message_log::flush()
+{
+    std::unique_lock lock(_mtx);
+    auto target      = _next_position;
+    _flush_requested = true;
+    _write_failed    = false;
+    _cv.notify_one();
+    _durable_cv.wait(lock, [&] { return _durable_position >= target || _write_failed || _writer_stopped; });
+    return _durable_position >= target;
+}
+
+void message_log::writer_loop()
+{
+    auto next_checkpoint = std::chrono::steady_clock::now() + _config.checkpoint_interval;
+
+    while (true)
+    {
+        bool stop;
+        {
+            std::unique_lock lock(_mtx);
+            // Group commit: records appended during the interval are written and synced together
+            _cv.wait_for(lock, _config.commit_interval, [this] { return _stop || _flush_requested; });
+            _flush_requested = false;
+            stop             = _stop;
+        }
+
+        bool written = write_pending();
+
+        if (written && (stop || std::chrono::steady_clock::now() >= next_checkpoint))
+        {
+            auto checkpoint = _provider();
+            // Records covered by the checkpoint may have been appended after the previous write, checkpoint must not cover unwritten records
+            if (write_pending())
+            {
+                if (write_checkpoint(checkpoint))
+                    remove_segments_before(checkpoint.position.segment);
+                next_checkpoint = std::chrono::steady_clock::now() + _config.checkpoint_interval;
+            }
+        }
+
+        if (stop)
+        {
+            std::lock_guard lock(_mtx);
+            if (!_pending.empty())
+                std::cerr << me() << "Stopped with unwritten records, last durable position " << _durable_position.segment << ":"
+                          << _durable_position.offset << std::endl;
+            _writer_stopped = true;
+            _durable_cv.notify_all();
+            return;
+        }
+    }
+}
+
+bool message_log::write_pending()
+{
+    std::deque<chunk> chunks;
+    log_position position;
+    {
+        std::lock_guard lock(_mtx);
+        chunks.swap(_pending);
+        position = _next_position;
+    }
+
+    std::optional<log_position> written_end;
+    size_t written{0};
+    for (; written < chunks.size(); written++)
+    {
+        log_position end;
+        if (!write_chunk(chunks[written], end))
+            break;
+        written_end = end;
+    }
+
+    bool ok = written == chunks.size();
+    {
+        std::lock_guard lock(_mtx);
+        if (ok)
+        {
+            _durable_position = position;
+        }
+        else
+        {
+            if (written_end)
+                _durable_position = *written_end;
+            // Failed chunks are written again before records appended in the meantime
+            _pending.insert(_pending.begin(), std::make_move_iterator(chunks.begin() + static_cast<ptrdiff_t>(written)), std::make_move_iterator(chunks.end()));
+        }
+        _write_failed = !ok;
+    }
+    _durable_cv.notify_all();
+    return ok;
+}
+
+bool message_log::write_chunk(const chunk& chunk_, log_position& end_)
+{
+    if (chunk_.segment != _fd_segment || _fd < 0)
+    {
+        close_segment();
+        if (!open_segment(chunk_.segment))
+            return false;
+    }
+
+    auto start = ::lseek(_fd, 0, SEEK_END);
+    if (start < 0 || !write_all(_fd, chunk_.data.data(), chunk_.data.size()) || ::fdatasync(_fd) != 0)
+    {
+        std::cerr << me() << "Write to segment " << chunk_.segment << " failed: " << std::strerror(errno) << std::endl;
+        // Partially written records are removed, the whole chunk is written again. Segment is reopened, as state of the file after
+        // failed sync is unknown.
+        if (start >= 0 && ::ftruncate(_fd, start) != 0)
+            std::cerr << me() << "Cannot truncate segment " << chunk_.segment << ": " << std::strerror(errno) << std::endl;
+        ::close(_fd);
+        _fd = -1;
+        return false;
+    }
+
+    end_ = log_position{chunk_.segment, static_cast<uint64_t>(start) + chunk_.data.size()};
+    return true;
+}
+
+bool message_log::open_segment(uint64_t segment_)
+{
+    auto path = segment_path(_config.directory, segment_);
+    _fd       = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (_fd < 0)
+    {
+        std::cerr << me() << "Cannot open segment " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    ::lseek(_fd, 0, SEEK_END);
+    _fd_segment = segment_;
+    return true;
+}
+
+void message_log::close_segment()
+{
+    if (_fd < 0)
+        return;
+
+    ::fdatasync(_fd);
+    ::close(_fd);
+    _fd = -1;
+}
+
+void message_log::remove_segments_before(uint64_t segment_)
+{
+    auto segments = list_segments(_config.directory);
+    if (!segments)
+        return;
+
+    std::error_code ec;
+    for (auto segment : *segments)
+    {
+        if (segment >= segment_)
+            break;
+        std::filesystem::remove(segment_path(_config.directory, segment), ec);
+    }
+}
+
+bool message_log::write_checkpoint(const log_checkpoint& checkpoint_)
+{
+    std::vector<common::byte_t> buffer;
+    put<uint32_t>(buffer, checkpoint_magic);
+    put<uint64_t>(buffer, checkpoint_.position.segment);
+    put<uint64_t>(buffer, checkpoint_.position.offset);
+    put<uint64_t>(buffer, checkpoint_.devices.size());
+    for (const auto& device : checkpoint_.devices)
+    {
+        put<uint32_t>(buffer, static_cast<uint32_t>(device.name.size()));
+        buffer.insert(buffer.end(), device.name.begin(), device.name.end());
+        put<uint64_t>(buffer, device.statistics.measurements);
+        put<uint64_t>(buffer, device.statistics.errors);
+        for (auto count : device.statistics.errors_by_type)
+        {
+            put<uint64_t>(buffer, count);
+        }
+        put<uint64_t>(buffer, device.history.size());
+        buffer.insert(buffer.end(), device.history.begin(), device.history.end());
+    }
+    put<uint32_t>(buffer, checksum(buffer));
+
+    // Checkpoint is written to temporary file and renamed, so a valid checkpoint exists at any time
+    auto tmp_path = _config.directory / checkpoint_tmp_file;
+    int fd        = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        std::cerr << me() << "Cannot open checkpoint " << tmp_path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    bool ok = write_all(fd, buffer.data(), buffer.size()) && ::fsync(fd) == 0;
+    ::close(fd);
+
+    std::error_code ec;
+    if (ok)
+        std::filesystem::rename(tmp_path, _config.directory / checkpoint_file, ec);
+    if (!ok || ec)
+    {
+        std::cerr << me() << "Writing checkpoint failed" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::optional<log_checkpoint> read_checkpoint(const std::filesystem::path& directory_)
+{
+    mapped_file file(directory_ / checkpoint_file);
+    auto data = file.data();
+
+    if (data.size() < 8 || get<uint32_t>(data.data()) != checkpoint_magic)
+        return std::nullopt;
+    if (get<uint32_t>(data.data() + data.size() - 4) != checksum(data.first(data.size() - 4)))
+        return std::nullopt;
+
+    log_checkpoint checkpoint;
+    byte_reader reader(data.subspan(4, data.size() - 8));
+    uint64_t devices_count{0};
+    if (!reader.read(checkpoint.position.segment) || !reader.read(checkpoint.position.offset) || !reader.read(devices_count))
+        return std::nullopt;
+
+    for (uint64_t i = 0; i < devices_count; i++)
+    {
+        auto& device = checkpoint.devices.emplace_back();
+        uint32_t name_len{0};
+        uint64_t history_len{0};
+        std::span<const common::byte_t> bytes;
+        if (!reader.read(name_len) || !reader.read(name_len, bytes))
+            return std::nullopt;
+        device.name.assign(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+
+        bool ok = reader.read(device.statistics.measurements) && reader.read(device.statistics.errors);
+        for (auto& count : device.statistics.errors_by_type)
+        {
+            ok = ok && reader.read(count);
+        }
+        if (!ok || !reader.read(history_len) || !reader.read(history_len, bytes))
+            return std::nullopt;
+        device.history.assign(bytes.begin(), bytes.end());
+    }
+    return checkpoint;
+}
+
+std::optional<log_position> replay_log(const std::filesystem::path& directory_,
+                                       log_position from_,
+                                       const std::function<void(log_position, timestamp_t, device_control_messages::device_message_type)>& handler_)
+{
+    if (!std::filesystem::exists(directory_))
+        return from_;
+
+    auto segments = list_segments(directory_);
+    if (!segments)
+        return std::nullopt;
+
+    // Segments not needed by the last checkpoint are deleted, the log then starts at the oldest kept segment
+    log_position end = from_;
+    if (!segments->empty() && segments->front() > from_.segment)
+        end = log_position{segments->front(), 0};
+    for (auto segment : *segments)
+    {
+        if (segment < from_.segment)
+            continue;
+        // Missing segment means the rest of log is unreachable
+        if (segment != end.segment && segment != end.segment + 1)
+            break;
+        if (segment != end.segment)
+            end = log_position{segment, 0};
+
+        mapped_file file(segment_path(directory_, segment));
+        auto data = file.data();
+        if (end.offset > data.size())
+            return log_position{segment, data.size()};
+
+        while (data.size() - end.offset >= record_header_len)
+        {
+            auto record   = data.subspan(end.offset);
+            auto body_len = get<uint32_t>(record.data());
+            if (body_len < 8 || record.size() - 8 < body_len || get<uint32_t>(record.data() + 4) != checksum(record.subspan(8, body_len)))
+                return end;
+
+            auto [message, consumed] = device_control_messages::binary_serializer::deserialize(record.subspan(16, body_len - 8));
+            if (message)
+                handler_(end, get<int64_t>(record.data() + 8), std::move(*message));
+
+            end.offset += 8 + body_len;
+        }
+        if (end.offset != data.size())
+            return end;
+    }
+    return end;
+}
+}
@@ -0,0 +1,193 @@
+#include <storage/rollup_tiers.h>
+
+#include <algorithm>
+#include <limits>
+#include <ranges>
+
+namespace hw::storage
+{
+namespace
+{
+timestamp_t to_timestamp(std::chrono::seconds duration_)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration_).count();
+}
+
+// Start of bucket of given resolution time belongs to
+timestamp_t bucket_start(timestamp_t timestamp_, timestamp_t resolution_)
+{
+    return timestamp_ - (timestamp_ % resolution_ + resolution_) % resolution_;
+}
+
+template <class ValueType>
+void record_value(column_aggregate& aggregate_, ValueType value_, ValueType error_value_)
+{
+    aggregate_column(std::span<const ValueType>(&value_, 1), error_value_, aggregate_);
+}
+}
+
+rollup_tiers::rollup_tiers(const rollup_config& config_)
+    : _latest(std::numeric_limits<timestamp_t>::min())
+{
+    for (const auto& tier_config : config_.tiers)
+    {
+        if (tier_config.resolution.count() > 0)
+            _tiers.push_back(tier{to_timestamp(tier_config.resolution), to_timestamp(tier_config.retention)});
+    }
+    std::sort(_tiers.begin(), _tiers.end(), [](const tier& a_, const tier& b_) { return a_.resolution < b_.resolution; });
+}
+
+void rollup_tiers::record(timestamp_t timestamp_, const device_control_messages::measurement& measurement_)
+{
+    _latest = std::max(_latest, timestamp_);
+
+    for (auto& t : _tiers)
+    {
+        auto temperatures = bucket_for(t, timestamp_, measurement_.temperature_sensors.size(), measurement_.fans_speed.size());
+        auto fans         = temperatures + t.temperatures_count;
+
+        for (size_t i = 0; i < measurement_.temperature_sensors.size(); i++)
+        {
+            record_value(temperatures[i], measurement_.temperature_sensors[i], device_control_messages::measurement::error_temperature);
+        }
+        for (size_t i = 0; i < measurement_.fans_speed.size(); i++)
+        {
+            record_value(fans[i], measurement_.fans_speed[i], device_control_messages::measurement::error_fan_speed);
+        }
+    }
+}
+
+void rollup_tiers::enforce_retention(timestamp_t now_)
+{
+    for (auto& t : _tiers)
+    {
+        drop_expired(t, now_);
+    }
+}
+
+size_t rollup_tiers::memory_size() const
+{
+    size_t size{0};
+    for (const auto& t : _tiers)
+    {
+        size += t.starts.capacity() * sizeof(timestamp_t) + t.aggregates.capacity() * sizeof(column_aggregate);
+    }
+    return size;
+}
+
+column_aggregate* rollup_tiers::bucket_for(tier& tier_, timestamp_t timestamp_, size_t temperatures_count_, size_t fans_count_)
+{
+    if (temperatures_count_ > tier_.temperatures_count || fans_count_ > tier_.fans_count)
+        reshape(tier_, tier_.starts.size(), std::max(temperatures_count_, tier_.temperatures_count), std::max(fans_count_, tier_.fans_count));
+
+    auto start = bucket_start(timestamp_, tier_.resolution);
+
+    // Measurements received out of order are added to the current bucket
+    if (tier_.count > 0 && tier_.starts[tier_.ring_index(tier_.count - 1)] >= start)
+        return tier_.aggregates.data() + tier_.ring_index(tier_.count - 1) * tier_.stride();
+
+    // Expired buckets are dropped first, so their space is reused for the new one
+    drop_expired(tier_, _latest);
+    if (tier_.count == tier_.starts.size())
+    {
+        // Tier never keeps more buckets than its retention covers
+        auto capacity = std::min<size_t>(std::max<size_t>(2 * tier_.starts.size(), 8), tier_.retention / tier_.resolution + 2);
+        reshape(tier_, std::max(capacity, tier_.count + 1), tier_.temperatures_count, tier_.fans_count);
+    }
+
+    auto index          = tier_.ring_index(tier_.count++);
+    tier_.starts[index] = start;
+    auto aggregates     = tier_.aggregates.data() + index * tier_.stride();
+    std::fill_n(aggregates, tier_.stride(), column_aggregate{});
+    return aggregates;
+}
+
+void rollup_tiers::reshape(tier& tier_, size_t capacity_, size_t temperatures_count_, size_t fans_count_)
+{
+    auto stride = temperatures_count_ + fans_count_;
+    std::vector<timestamp_t> starts(capacity_);
+    std::vector<column_aggregate> aggregates(capacity_ * stride);
+    for (size_t n = 0; n < tier_.count; n++)
+    {
+        auto from = tier_.aggregates.begin() + static_cast<ptrdiff_t>(tier_.ring_index(n) * tier_.stride());
+        auto to   = aggregates.begin() + static_cast<ptrdiff_t>(n * stride);
+        starts[n] = tier_.starts[tier_.ring_index(n)];
+        std::copy_n(from, tier_.temperatures_count, to);
+        std::copy_n(from + static_cast<ptrdiff_t>(tier_.temperatures_count), tier_.fans_count, to + static_cast<ptrdiff_t>(temperatures_count_));
+    }
+
+    tier_.starts             = std::move(starts);
+    tier_.aggregates         = std::move(aggregates);
+    tier_.temperatures_count = temperatures_count_;
+    tier_.fans_count         = fans_count_;
+    tier_.first              = 0;
+}
+
+void rollup_tiers::drop_expired(tier& tier_, timestamp_t now_)
+{
+    while (tier_.count > 0 && tier_.starts[tier_.first] + tier_.resolution <= now_ - tier_.retention)
+    {
+        tier_.first = (tier_.first + 1) % tier_.starts.size();
+        tier_.count--;
+    }
+}
+
+const rollup_tiers::tier& rollup_tiers::select_tier(timestamp_t from_, timestamp_t resolution_) const
+{
+    // Coarsest tier not coarser than requested resolution
+    size_t index{0};
+    while (index + 1 < _tiers.size() && _tiers[index + 1].resolution <= resolution_)
+    {
+        index++;
+    }
+    // Coarser tier if the selected one does not reach back to the start of the range
+    while (index + 1 < _tiers.size() && from_ < _latest - _tiers[index].retention)
+    {
+        index++;
+    }
+    return _tiers[index];
+}
+
+rollup_series rollup_tiers::query(bool fans_, size_t index_, timestamp_t from_, timestamp_t to_, std::chrono::seconds resolution_) const
+{
+    rollup_series series;
+    if (_tiers.empty() || from_ >= to_ || _latest == std::numeric_limits<timestamp_t>::min())
+        return series;
+
+    const auto& t = select_tier(from_, to_timestamp(resolution_));
+    // Returned buckets are whole multiples of tier buckets
+    auto resolution = std::max<timestamp_t>(t.resolution, to_timestamp(resolution_) / t.resolution * t.resolution);
+
+    series.tier_resolution = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::nanoseconds(t.resolution));
+    series.resolution      = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::nanoseconds(resolution));
+
+    if (index_ >= (fans_ ? t.fans_count : t.temperatures_count))
+        return series;
+
+    auto offset  = (fans_ ? t.temperatures_count : 0) + index_;
+    auto buckets = std::views::iota(size_t{0}, t.count);
+    auto first   = std::ranges::partition_point(buckets, [&t, from_](size_t n_) { return t.starts[t.ring_index(n_)] + t.resolution <= from_; });
+    for (auto n = first; n != buckets.end() && t.starts[t.ring_index(*n)] < to_; n++)
+    {
+        const auto& aggregate = t.aggregates[t.ring_index(*n) * t.stride() + offset];
+        if (aggregate.count == 0 && aggregate.errors == 0)
+            continue;
+
+        auto start = bucket_start(t.starts[t.ring_index(*n)], resolution);
+        if (series.points.empty() || series.points.back().start != start)
+            series.points.push_back(rollup_point{start, {}});
+        series.points.back().aggregate.merge(aggregate);
+    }
+    return series;
+}
+
+rollup_series rollup_tiers::temperature(size_t sensor_, timestamp_t from_, timestamp_t to_, std::chrono::seconds resolution_) const
+{
+    return query(false, sensor_, from_, to_, resolution_);
+}
+
+rollup_series rollup_tiers::fan_speed(size_t fan_, timestamp_t from_, timestamp_t to_, std::chrono::seconds resolution_) const
+{
+    return query(true, fan_, from_, to_, resolution_);
+}
+}
@@ -0,0 +1,77 @@
+#include <storage/streaming_aggregates.h>
+
+#include <algorithm>
+
+namespace hw::storage
+{
+void streaming_aggregates::record(timestamp_t timestamp_, const device_control_messages::measurement& measurement_)
+{
+    if (_windows_count == 0)
+        return;
+
+    auto& w = window_for(timestamp_);
+    if (w.temperatures.size() < measurement_.temperature_sensors.size() || w.fans.size() < measurement_.fans_speed.size())
+    {
+        _memory_size -= w.temperatures.capacity() * sizeof(temperature_summary) + w.fans.capacity() * sizeof(fan_speed_summary);
+        w.temperatures.resize(std::max(w.temperatures.size(), measurement_.temperature_sensors.size()));
+        w.fans.resize(std::max(w.fans.size(), measurement_.fans_speed.size()));
+        _memory_size += w.temperatures.capacity() * sizeof(temperature_summary) + w.fans.capacity() * sizeof(fan_speed_summary);
+    }
+
+    for (size_t i = 0; i < measurement_.temperature_sensors.size(); i++)
+    {
+        w.temperatures[i].record(measurement_.temperature_sensors[i], device_control_messages::measurement::error_temperature);
+    }
+    for (size_t i = 0; i < measurement_.fans_speed.size(); i++)
+    {
+        w.fans[i].record(measurement_.fans_speed[i], device_control_messages::measurement::error_fan_speed);
+    }
+}
+
+temperature_summary streaming_aggregates::temperature(size_t sensor_, timestamp_t since_) const
+{
+    temperature_summary summary;
+    for (const auto& w : _windows)
+    {
+        if (w.start + _window_len > since_ && sensor_ < w.temperatures.size())
+            summary.merge(w.temperatures[sensor_]);
+    }
+    return summary;
+}
+
+fan_speed_summary streaming_aggregates::fan_speed(size_t fan_, timestamp_t since_) const
+{
+    fan_speed_summary summary;
+    for (const auto& w : _windows)
+    {
+        if (w.start + _window_len > since_ && fan_ < w.fans.size())
+            summary.merge(w.fans[fan_]);
+    }
+    return summary;
+}
+
+streaming_aggregates::window& streaming_aggregates::window_for(timestamp_t timestamp_)
+{
+    auto start = timestamp_ - (timestamp_ % _window_len + _window_len) % _window_len;
+
+    // Measurements received out of order (e.g. after clock adjustment) are added to the current window
+    if (!_windows.empty() && _windows.back().start >= start)
+        return _windows.back();
+
+    if (_windows.size() < _windows_count)
+    {
+        _windows.push_back(window{start, {}, {}});
+        _memory_size += sizeof(window);
+        return _windows.back();
+    }
+
+    // The oldest window is reused, its summaries are cleared in place
+    _windows.push_back(std::move(_windows.front()));
+    _windows.pop_front();
+    auto& w = _windows.back();
+    w.start = start;
+    std::fill(w.temperatures.begin(), w.temperatures.end(), temperature_summary{});
+    std::fill(w.fans.begin(), w.fans.end(), fan_speed_summary{});
+    return w;
+}
+}
@@ -0,0 +1,97 @@
+#include <catch2/catch.hpp>
+
+#include <random>
+#include <vector>
+
+#include <device_messages_storage.h>
+#include <storage/column_kernels.h>
+
+namespace
+{
+template <class ValueType>
+std::vector<ValueType> make_column(size_t size_, ValueType error_value_)
+{
+    std::mt19937 generator(static_cast<uint32_t>(size_));
+    std::uniform_int_distribution<uint32_t> distribution(0, std::numeric_limits<ValueType>::max());
+    std::vector<ValueType> column(size_);
+    for (auto& value : column)
+    {
+        value = static_cast<ValueType>(distribution(generator));
+        if (value % 17 == 0)
+            value = error_value_;
+    }
+    return column;
+}
+
+template <class ValueType>
+void check_kernels(ValueType error_value_)
+{
+    using hw::storage::kernels::isa;
+
+    for (size_t size : {0, 1, 7, 15, 16, 31, 33, 64, 1000, 4099})
+    {
+        auto column = make_column<ValueType>(size, error_value_);
+        std::span<const ValueType> span(column);
+
+        hw::storage::column_aggregate expected;
+        hw::storage::aggregate_column(span, error_value_, expected);
+
+        for (auto kernel_isa : {isa::scalar, isa::sse4, isa::avx2})
+        {
+            CAPTURE(size, hw::storage::kernels::isa_name(kernel_isa));
+
+            hw::storage::column_aggregate aggregate;
+            hw::storage::kernels::aggregate(span, error_value_, aggregate, kernel_isa);
+            REQUIRE(aggregate.count == expected.count);
+            REQUIRE(aggregate.errors == expected.errors);
+            REQUIRE(aggregate.sum == expected.sum);
+            REQUIRE(aggregate.min == expected.min);
+            REQUIRE(aggregate.max == expected.max);
+
+            for (ValueType threshold : {ValueType{0}, ValueType{100}, static_cast<ValueType>(std::numeric_limits<ValueType>::max() - 1),
+                                        std::numeric_limits<ValueType>::max()})
+            {
+                size_t expected_count = std::count_if(column.begin(), column.end(), [&](auto v_) { return v_ > threshold && v_ != error_value_; });
+                REQUIRE(hw::storage::kernels::count_above(span, threshold, error_value_, kernel_isa) == expected_count);
+            }
+        }
+    }
+}
+}
+
+TEST_CASE("Column kernels match scalar implementation")
+{
+    SECTION("temperatures")
+    {
+        check_kernels<uint16_t>(hw::device_control_messages::measurement::error_temperature);
+        check_kernels<uint16_t>(0);
+    }
+    SECTION("fan speeds")
+    {
+        check_kernels<uint8_t>(hw::device_control_messages::measurement::error_fan_speed);
+        check_kernels<uint8_t>(0);
+    }
+}
+
+TEST_CASE("Device messages storage counts values above threshold")
+{
+    hw::storage_config config;
+    config.block_capacity = 16;
+    hw::device_messages_storage storage(config);
+
+    hw::device_control_messages::measurement meas_msg("device");
+    for (uint16_t i = 0; i < 100; i++)
+    {
+        meas_msg.temperature_sensors = std::vector<uint16_t>{i};
+        meas_msg.fans_speed          = std::vector<uint8_t>{static_cast<uint8_t>(i)};
+        storage.new_message(meas_msg);
+    }
+    meas_msg.temperature_sensors = std::vector<uint16_t>{hw::device_control_messages::measurement::error_temperature};
+    storage.new_message(meas_msg);
+
+    REQUIRE(storage.count_temperature_above("device", 0, 49) == 50);
+    REQUIRE(storage.count_fan_speed_above("device", 0, 89) == 11);
+    REQUIRE(storage.get_temperature_aggregate("device", 0).errors == 1);
+    REQUIRE(storage.get_temperature_aggregate("device", 0).max == 99);
+    REQUIRE(storage.count_temperature_above("unknown", 0, 0) == 0);
+}
@@ -0,0 +1,292 @@
+#include <catch2/catch.hpp>
+
+#include <random>
+
+#include <storage/compressed_block.h>
+#include <storage/device_history.h>
+
+namespace
+{
+constexpr hw::storage::timestamp_t second = 1'000'000'000;
+
+// Block of periodic measurements with slowly changing values and small reception jitter
+hw::storage::measurement_block make_block(size_t size_, uint32_t seed_)
+{
+    std::mt19937 generator(seed_);
+    std::uniform_int_distribution<int> jitter(-50'000, 50'000);
+    std::uniform_int_distribution<int> change(0, 19);
+
+    hw::storage::measurement_block block(3, 2, size_);
+    hw::device_control_messages::measurement meas("device");
+    meas.temperature_sensors = std::vector<uint16_t>{40000, 45000, 50000};
+    meas.fans_speed          = std::vector<uint8_t>{100, 0};
+    for (size_t i = 0; i < size_; i++)
+    {
+        if (change(generator) == 0)
+            meas.temperature_sensors[0] += 125;
+        if (change(generator) == 0)
+            meas.fans_speed[0]--;
+        meas.temperature_sensors[2] = i % 100 == 0 ? hw::device_control_messages::measurement::error_temperature : 50000;
+        block.append(static_cast<hw::storage::timestamp_t>(i) * second + jitter(generator), meas);
+    }
+    return block;
+}
+
+bool same_columns(const hw::storage::measurement_block& a_, const hw::storage::measurement_block& b_)
+{
+    if (a_.size() != b_.size() || a_.temperatures_count() != b_.temperatures_count() || a_.fans_count() != b_.fans_count())
+        return false;
+    if (!std::equal(a_.timestamps().begin(), a_.timestamps().end(), b_.timestamps().begin()))
+        return false;
+    for (size_t i = 0; i < a_.temperatures_count(); i++)
+    {
+        if (!std::equal(a_.temperatures(i).begin(), a_.temperatures(i).end(), b_.temperatures(i).begin()))
+            return false;
+    }
+    for (size_t i = 0; i < a_.fans_count(); i++)
+    {
+        if (!std::equal(a_.fans(i).begin(), a_.fans(i).end(), b_.fans(i).begin()))
+            return false;
+    }
+    return true;
+}
+
+// Compare measurements decoded by row cursor with block
+bool same_rows(const hw::storage::compressed_block& compressed_, const hw::storage::measurement_block& block_)
+{
+    hw::storage::compressed_block::row_cursor cursor(compressed_);
+    size_t row{0};
+    for (; cursor.next(); row++)
+    {
+        if (row >= block_.size() || cursor.timestamp() != block_.timestamps()[row])
+            return false;
+        auto decoded  = cursor.to_message("device");
+        auto expected = block_.row(row, "device");
+        if (decoded.temperature_sensors != expected.temperature_sensors || decoded.fans_speed != expected.fans_speed)
+            return false;
+    }
+    return row == block_.size();
+}
+}
+
+TEST_CASE("Compressed block")
+{
+    std::vector<uint64_t> buffer;
+    hw::storage::measurement_block decoded(0, 0, 1024);
+
+    SECTION("periodic measurements")
+    {
+        auto block = make_block(1024, 1);
+        hw::storage::compressed_block compressed(block, buffer, std::pmr::get_default_resource());
+        REQUIRE(compressed.size() == 1024);
+        REQUIRE(compressed.last_timestamp() == block.timestamps().back());
+
+        compressed.decode(decoded);
+        REQUIRE(same_columns(block, decoded));
+        REQUIRE(block.memory_size() >= 3 * compressed.memory_size());
+    }
+
+    SECTION("exactly periodic measurements")
+    {
+        hw::storage::measurement_block block(3, 1, 1024);
+        hw::device_control_messages::measurement meas("device");
+        meas.temperature_sensors = std::vector<uint16_t>{40000, 45000, 50000};
+        meas.fans_speed          = std::vector<uint8_t>{100};
+        for (size_t i = 0; i < 1024; i++)
+        {
+            meas.temperature_sensors[0] = static_cast<uint16_t>(40000 + i / 64);
+            block.append(static_cast<hw::storage::timestamp_t>(i) * second, meas);
+        }
+        hw::storage::compressed_block compressed(block, buffer, std::pmr::get_default_resource());
+        compressed.decode(decoded);
+        REQUIRE(same_columns(block, decoded));
+        REQUIRE(block.memory_size() >= 8 * compressed.memory_size());
+    }
+
+    SECTION("arbitrary values")
+    {
+        std::mt19937 generator(2);
+        hw::storage::measurement_block block(2, 1, 500);
+        hw::device_control_messages::measurement meas("device");
+        hw::storage::timestamp_t timestamp{0};
+        for (size_t i = 0; i < 500; i++)
+        {
+            timestamp += generator() % 3 == 0 ? 0 : static_cast<hw::storage::timestamp_t>(generator()) * (1 + generator() % 4096);
+            meas.temperature_sensors = std::vector<uint16_t>{static_cast<uint16_t>(generator()), static_cast<uint16_t>(i % 2 ? 0 : 65535)};
+            meas.fans_speed          = std::vector<uint8_t>{static_cast<uint8_t>(generator())};
+            block.append(timestamp, meas);
+        }
+        hw::storage::compressed_block compressed(block, buffer, std::pmr::get_default_resource());
+        compressed.decode(decoded);
+        REQUIRE(same_columns(block, decoded));
+    }
+
+    SECTION("column scans")
+    {
+        // Indexed and not indexed block
+        auto size  = GENERATE(hw::storage::compressed_block::indexed_size - 1, size_t{1000});
+        auto block = make_block(size, 4);
+        hw::storage::compressed_block compressed(block, buffer, std::pmr::get_default_resource());
+
+        auto check = [&] {
+            std::vector<uint16_t> temperatures;
+            compressed.visit_temperatures(2, [&](std::span<const uint16_t> values_) {
+                REQUIRE(values_.size() <= hw::storage::compressed_block::decode_chunk);
+                temperatures.insert(temperatures.end(), values_.begin(), values_.end());
+            });
+            std::vector<uint8_t> fans;
+            compressed.visit_fans(0, [&](std::span<const uint8_t> values_) { fans.insert(fans.end(), values_.begin(), values_.end()); });
+            REQUIRE(std::equal(temperatures.begin(), temperatures.end(), block.temperatures(2).begin(), block.temperatures(2).end()));
+            REQUIRE(std::equal(fans.begin(), fans.end(), block.fans(0).begin(), block.fans(0).end()));
+            REQUIRE(same_rows(compressed, block));
+        };
+        check();
+
+        auto aggregate = compressed.temperature_aggregate(2);
+        REQUIRE(aggregate.has_value() == (size >= hw::storage::compressed_block::indexed_size));
+        if (aggregate)
+        {
+            hw::storage::column_aggregate expected;
+            hw::storage::aggregate_column(block.temperatures(2), hw::device_control_messages::measurement::error_temperature, expected);
+            REQUIRE(aggregate->count == expected.count);
+            REQUIRE(aggregate->errors == expected.errors);
+            REQUIRE(aggregate->sum == expected.sum);
+            REQUIRE(compressed.fan_aggregate(0)->max == block.fans(0).front());
+        }
+
+        // Aggregates do not cover trimmed block, scans skip dropped values
+        compressed.drop_front(size / 2 + 1);
+        block.drop_front(size / 2 + 1);
+        REQUIRE_FALSE(compressed.temperature_aggregate(2));
+        check();
+
+        REQUIRE(compressed.count_between(0, 10 * second) == 0);
+        REQUIRE(compressed.count_between(block.timestamps().front(), block.timestamps().back()) == block.size() - 1);
+    }
+
+    SECTION("row cursor of wide measurements")
+    {
+        // More columns than the cursor keeps inline
+        hw::storage::measurement_block block(40, 10, 100);
+        hw::device_control_messages::measurement meas("device");
+        for (size_t i = 0; i < 100; i++)
+        {
+            meas.temperature_sensors = std::vector<uint16_t>(40, static_cast<uint16_t>(40000 + i));
+            meas.fans_speed          = std::vector<uint8_t>(10, static_cast<uint8_t>(i));
+            block.append(static_cast<hw::storage::timestamp_t>(i) * second, meas);
+        }
+        hw::storage::compressed_block compressed(block, buffer, std::pmr::get_default_resource());
+        REQUIRE(same_rows(compressed, block));
+    }
+
+    SECTION("dropping measurements")
+    {
+        auto block = make_block(100, 3);
+        hw::storage::compressed_block compressed(block, buffer, std::pmr::get_default_resource());
+
+        compressed.drop_front(10);
+        REQUIRE(compressed.size() == 90);
+        REQUIRE(compressed.drop_front_before(0) == 0);
+        REQUIRE(compressed.drop_front_before(20 * second) == 10);
+        REQUIRE(compressed.first_timestamp() == block.timestamps()[20]);
+
+        compressed.decode(decoded);
+        block.drop_front(20);
+        REQUIRE(same_columns(block, decoded));
+
+        REQUIRE(compressed.drop_front_before(1000 * second) == 80);
+        REQUIRE(compressed.empty());
+    }
+}
+
+TEST_CASE("Device history with compressed blocks")
+{
+    using hw::device_control_messages::error;
+    using hw::device_control_messages::measurement;
+
+    hw::storage::retention_policy retention;
+    SECTION("unlimited") {}
+    SECTION("by message count")
+    {
+        retention.max_messages = 50;
+    }
+    SECTION("by age")
+    {
+        retention.max_age = std::chrono::seconds(30);
+    }
+
+    hw::storage::device_history raw(8, retention);
+    hw::storage::device_history compressed(8, retention, std::pmr::get_default_resource(), true);
+
+    auto source = make_block(100, 4);
+    for (size_t i = 0; i < source.size(); i++)
+    {
+        raw.append(source.timestamps()[i], source.row(i, "device"));
+        compressed.append(source.timestamps()[i], source.row(i, "device"));
+        if (i % 7 == 0)
+        {
+            raw.append(source.timestamps()[i], error("device", error::error_type::exploded));
+            compressed.append(source.timestamps()[i], error("device", error::error_type::exploded));
+        }
+    }
+
+    REQUIRE(compressed.sealed_blocks_count() > 0);
+    REQUIRE(compressed.size() == raw.size());
+    REQUIRE(compressed.memory_size() < raw.memory_size());
+
+    auto raw_messages        = raw.messages("device");
+    auto compressed_messages = compressed.messages("device");
+    REQUIRE(raw_messages.size() == compressed_messages.size());
+    bool same = true;
+    for (size_t i = 0; i < raw_messages.size(); i++)
+    {
+        same = same && raw_messages[i].index() == compressed_messages[i].index();
+        if (auto meas = std::get_if<measurement>(&raw_messages[i]); same && meas)
+        {
+            const auto& other = std::get<measurement>(compressed_messages[i]);
+            same              = meas->temperature_sensors == other.temperature_sensors && meas->fans_speed == other.fans_speed;
+        }
+    }
+    REQUIRE(same);
+
+    for (auto [from, to] : {std::pair<int, int>{0, 100}, {75, 82}, {90, 95}, {99, 200}})
+    {
+        REQUIRE(compressed.count_between(from * second, to * second) == raw.count_between(from * second, to * second));
+    }
+    REQUIRE(compressed.aggregate_temperature(0).max == raw.aggregate_temperature(0).max);
+    REQUIRE(compressed.aggregate_temperature(2).errors == raw.aggregate_temperature(2).errors);
+    REQUIRE(compressed.aggregate_fan_speed(0).sum == raw.aggregate_fan_speed(0).sum);
+    REQUIRE(compressed.count_temperature_above(0, 40200) == raw.count_temperature_above(0, 40200));
+
+    // Whole-block aggregates of indexed blocks give the same results
+    hw::storage::device_history long_raw(hw::storage::compressed_block::indexed_size, retention);
+    hw::storage::device_history indexed(hw::storage::compressed_block::indexed_size, retention, std::pmr::get_default_resource(), true);
+    auto long_source = make_block(1000, 5);
+    for (size_t i = 0; i < long_source.size(); i++)
+    {
+        long_raw.append(long_source.timestamps()[i], long_source.row(i, "device"));
+        indexed.append(long_source.timestamps()[i], long_source.row(i, "device"));
+    }
+    REQUIRE((indexed.sealed_blocks_count() > 0 || retention.limited()));
+    for (int from : {0, 120, 500, 960})
+    {
+        REQUIRE(indexed.count_between(from * second, (from + 300) * second) == long_raw.count_between(from * second, (from + 300) * second));
+    }
+    for (size_t sensor = 0; sensor < 3; sensor++)
+    {
+        auto expected = long_raw.aggregate_temperature(sensor);
+        auto actual   = indexed.aggregate_temperature(sensor);
+        REQUIRE(actual.count == expected.count);
+        REQUIRE(actual.errors == expected.errors);
+        REQUIRE(actual.sum == expected.sum);
+        REQUIRE(actual.min == expected.min);
+        REQUIRE(actual.max == expected.max);
+    }
+    REQUIRE(indexed.aggregate_fan_speed(0).sum == long_raw.aggregate_fan_speed(0).sum);
+    for (uint16_t threshold : {0, 40000, 40200, 50000, 65535})
+    {
+        REQUIRE(indexed.count_temperature_above(0, threshold) == long_raw.count_temperature_above(0, threshold));
+        REQUIRE(indexed.count_temperature_above(2, threshold) == long_raw.count_temperature_above(2, threshold));
+    }
+    REQUIRE(indexed.count_fan_speed_above(0, 95) == long_raw.count_fan_speed_above(0, 95));
+}
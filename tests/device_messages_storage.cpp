@@ -0,0 +1,414 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <memory_resource>
+
+#include <device_messages_storage.h>
+
+#include "test_helpers.h"
+
+namespace
+{
+// Memory resource counting allocations passed to the default resource
+class counting_resource : public std::pmr::memory_resource
+{
+public:
+    size_t allocations{0};
+    size_t outstanding_bytes{0};
+
+private:
+    void* do_allocate(size_t bytes_, size_t alignment_) override
+    {
+        allocations++;
+        outstanding_bytes += bytes_;
+        return std::pmr::new_delete_resource()->allocate(bytes_, alignment_);
+    }
+
+    void do_deallocate(void* p_, size_t bytes_, size_t alignment_) override
+    {
+        outstanding_bytes -= bytes_;
+        std::pmr::new_delete_resource()->deallocate(p_, bytes_, alignment_);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other_) const noexcept override { return this == &other_; }
+};
+}
+
+TEST_CASE("Device messages storage")
+{
+    using hw::device_control_messages::error;
+    using hw::device_control_messages::measurement;
+
+    measurement meas_msg("device1");
+    meas_msg.temperature_sensors = std::vector<uint16_t>{1, 2, 3};
+    meas_msg.fans_speed          = std::vector<uint8_t>{1};
+
+    hw::storage_config config;
+    SECTION("full mode") {}
+    SECTION("counts only mode")
+    {
+        config.mode = hw::storage_mode::counts_only;
+    }
+    SECTION("single shard")
+    {
+        config.shards_count = 1;
+    }
+
+    hw::device_messages_storage storage(config);
+    storage.new_message(meas_msg);
+    storage.new_message(error("device1", error::error_type::exploded));
+    storage.new_message(meas_msg);
+    storage.new_message(error("device2", error::error_type::unknown));
+    storage.new_message(error("device2", error::error_type::unknown));
+
+    auto devices = storage.get_devices();
+    std::sort(devices.begin(), devices.end());
+    REQUIRE(devices == std::vector<std::string>{"device1", "device2"});
+
+    REQUIRE(storage.get_device_messages_count<measurement>("device1") == 2);
+    REQUIRE(storage.get_device_messages_count<error>("device1") == 1);
+    REQUIRE(storage.get_device_messages_count<measurement>("device2") == 0);
+    REQUIRE(storage.get_device_messages_count<error>("device2") == 2);
+    REQUIRE(storage.get_device_messages_count<error>("device3") == 0);
+
+    auto stats = storage.get_device_statistics("device2");
+    REQUIRE(stats.total() == 2);
+    REQUIRE(stats.count(error::error_type::unknown) == 2);
+    REQUIRE(stats.count(error::error_type::exploded) == 0);
+    REQUIRE(storage.get_device_statistics("device1").count(error::error_type::exploded) == 1);
+
+    if (config.mode == hw::storage_mode::full)
+    {
+        auto messages = storage.get_device_messages("device1");
+        REQUIRE(messages.size() == 3);
+        REQUIRE(std::holds_alternative<measurement>(messages[0]));
+        REQUIRE(std::get<error>(messages[1]).err_type == error::error_type::exploded);
+        REQUIRE(std::get<measurement>(messages[2]).fans_speed == meas_msg.fans_speed);
+        auto measurements = storage.get_device_messages_of_type<measurement>("device1");
+        REQUIRE(measurements.size() == 2);
+        REQUIRE(measurements[0].temperature_sensors == meas_msg.temperature_sensors);
+        REQUIRE(storage.get_device_messages_of_type<error>("device2").size() == 2);
+    }
+    else
+    {
+        REQUIRE(storage.get_device_messages("device1").empty());
+        REQUIRE(storage.get_device_messages_of_type<measurement>("device1").empty());
+    }
+}
+
+TEST_CASE("Device messages storage aggregates")
+{
+    using hw::device_control_messages::measurement;
+
+    hw::storage_config config;
+    config.block_capacity = 2;
+    hw::device_messages_storage storage(config);
+
+    for (uint16_t temp : std::vector<uint16_t>{10, 30, measurement::error_temperature, 20, 40})
+    {
+        measurement meas_msg("device");
+        meas_msg.temperature_sensors = std::vector<uint16_t>{temp};
+        meas_msg.fans_speed          = std::vector<uint8_t>{static_cast<uint8_t>(temp)};
+        storage.new_message(meas_msg);
+    }
+    // Measurement of different shape
+    measurement meas_msg("device");
+    meas_msg.temperature_sensors = std::vector<uint16_t>{50, 60};
+    storage.new_message(meas_msg);
+
+    auto temp = storage.get_temperature_aggregate("device", 0);
+    REQUIRE(temp.count == 5);
+    REQUIRE(temp.errors == 1);
+    REQUIRE(temp.min == 10);
+    REQUIRE(temp.max == 50);
+    REQUIRE(temp.mean() == Approx(30.0));
+
+    auto second_temp = storage.get_temperature_aggregate("device", 1);
+    REQUIRE(second_temp.count == 1);
+    REQUIRE(second_temp.max == 60);
+
+    auto fan = storage.get_fan_speed_aggregate("device", 0);
+    REQUIRE(fan.count == 4);
+    REQUIRE(fan.errors == 1);
+    REQUIRE(fan.max == 40);
+
+    auto measurements = storage.get_device_messages_of_type<measurement>("device");
+    REQUIRE(measurements.size() == 6);
+    REQUIRE(measurements.back().temperature_sensors == std::vector<uint16_t>{50, 60});
+    REQUIRE(measurements.back().fans_speed.empty());
+}
+
+TEST_CASE("Device history retention")
+{
+    using hw::device_control_messages::error;
+    using hw::device_control_messages::measurement;
+
+    auto make_measurement = [](uint16_t temp_) { return hw::tests::make_measurement("device", {temp_}); };
+    auto first_temperature = [](const hw::storage::device_history& history_) {
+        return std::get<measurement>(history_.messages("device").front()).temperature_sensors.front();
+    };
+
+    hw::storage::retention_policy retention;
+
+    SECTION("by message count")
+    {
+        retention.max_messages = 5;
+        hw::storage::device_history history(4, retention);
+        for (uint16_t i = 0; i < 20; i++)
+        {
+            history.append(i, make_measurement(i));
+            if (i == 17)
+                history.append(i, error("device", error::error_type::exploded));
+        }
+
+        auto messages = history.messages("device");
+        REQUIRE(messages.size() == 5);
+        REQUIRE(std::get<measurement>(messages[0]).temperature_sensors.front() == 16);
+        REQUIRE(std::get<measurement>(messages[1]).temperature_sensors.front() == 17);
+        REQUIRE(std::holds_alternative<error>(messages[2]));
+        REQUIRE(std::get<measurement>(messages[4]).temperature_sensors.front() == 19);
+        REQUIRE(history.blocks_count() <= 3);
+    }
+
+    SECTION("by age")
+    {
+        retention.max_age = std::chrono::seconds(10);
+        hw::storage::device_history history(4, retention);
+        for (uint16_t i = 0; i < 20; i++)
+        {
+            history.append(static_cast<hw::storage::timestamp_t>(i) * 1'000'000'000, make_measurement(i));
+        }
+        REQUIRE(history.size() == 11);
+        REQUIRE(first_temperature(history) == 9);
+
+        history.enforce_retention(25'000'000'000);
+        REQUIRE(history.size() == 5);
+        REQUIRE(first_temperature(history) == 15);
+    }
+
+    SECTION("by memory")
+    {
+        hw::storage::measurement_block block(1, 0, 4);
+        retention.max_memory_bytes = 2 * block.memory_size();
+        hw::storage::device_history history(4, retention);
+        for (uint16_t i = 0; i < 20; i++)
+        {
+            history.append(i, make_measurement(i));
+            REQUIRE(history.memory_size() <= retention.max_memory_bytes);
+        }
+        REQUIRE(history.size() == 8);
+        REQUIRE(first_temperature(history) == 12);
+    }
+}
+
+TEST_CASE("Device history allocates from memory resource")
+{
+    counting_resource resource;
+    hw::storage::retention_policy retention;
+    retention.max_messages = 8;
+
+    hw::device_control_messages::measurement meas_msg("device");
+    meas_msg.temperature_sensors = std::vector<uint16_t>{1, 2};
+    meas_msg.fans_speed          = std::vector<uint8_t>{3};
+    {
+        // The same setup as in the storage, history allocates from a pool backed by the counted resource
+        std::pmr::unsynchronized_pool_resource pool(&resource);
+        hw::storage::device_history history(4, retention, &pool);
+        for (uint16_t i = 0; i < 12; i++)
+        {
+            history.append(i, meas_msg);
+        }
+        auto warm_allocations = resource.allocations;
+        REQUIRE(resource.outstanding_bytes >= history.memory_size());
+
+        // Segments released by retention are reused, no further allocations from upstream in the steady state
+        for (uint16_t i = 12; i < 1000; i++)
+        {
+            history.append(i, meas_msg);
+        }
+        REQUIRE(resource.allocations == warm_allocations);
+        REQUIRE(history.size() == 8);
+        REQUIRE(history.messages("device").size() == 8);
+
+
+        // Columns of a block share one segment, moving the block moves the segment
+        hw::storage::measurement_block block(2, 1, 4, &resource);
+        block.append(0, meas_msg);
+        auto moved = std::move(block);
+        REQUIRE(moved.size() == 1);
+        REQUIRE(moved.temperatures(1)[0] == 2);
+        REQUIRE(moved.fans(0)[0] == 3);
+        REQUIRE(moved.memory_size() == 4 * (sizeof(hw::storage::timestamp_t) + 2 * sizeof(uint16_t) + sizeof(uint8_t)));
+        REQUIRE(block.memory_size() == 0);
+    }
+    REQUIRE(resource.outstanding_bytes == 0);
+}
+
+TEST_CASE("Device messages storage counters survive retention")
+{
+    hw::storage_config config;
+    config.retention.max_messages = 2;
+    hw::device_messages_storage storage(config);
+
+    hw::device_control_messages::measurement meas_msg("device");
+    for (size_t i = 0; i < 10; i++)
+    {
+        storage.new_message(meas_msg);
+    }
+
+    REQUIRE(storage.get_device_messages("device").size() == 2);
+    REQUIRE(storage.get_device_messages_count<hw::device_control_messages::measurement>("device") == 10);
+}
+
+TEST_CASE("Device messages storage visits messages in place")
+{
+    using hw::device_control_messages::error;
+    using hw::device_control_messages::measurement;
+
+    hw::storage_config config;
+    config.block_capacity = 2;
+    hw::device_messages_storage storage(config);
+
+    measurement meas_msg("device");
+    meas_msg.fans_speed = std::vector<uint8_t>{7};
+    for (uint16_t i = 0; i < 5; i++)
+    {
+        meas_msg.temperature_sensors = std::vector<uint16_t>{i};
+        storage.new_message(meas_msg);
+        if (i == 2)
+            storage.new_message(error("device", error::error_type::exploded));
+    }
+
+    std::vector<uint16_t> temperatures;
+    storage.for_each_message_of_type<measurement>("device", [&](const hw::storage::measurement_view& view_) {
+        REQUIRE(view_.device_name() == "device");
+        REQUIRE(view_.fans_count() == 1);
+        REQUIRE(view_.fan_speed(0) == 7);
+        temperatures.push_back(view_.temperature(0));
+    });
+    REQUIRE(temperatures == std::vector<uint16_t>{0, 1, 2, 3, 4});
+
+    size_t errors{0};
+    storage.for_each_message_of_type<error>("device", [&](const hw::storage::error_view& view_) {
+        REQUIRE(view_.err_type() == error::error_type::exploded);
+        errors++;
+    });
+    REQUIRE(errors == 1);
+
+    // Visiting all messages preserves order of reception, the same as the copying API
+    std::vector<hw::device_control_messages::device_message_type> visited;
+    storage.for_each_message("device", [&](const auto& view_) { visited.emplace_back(view_.to_message()); });
+    REQUIRE(visited.size() == 6);
+    REQUIRE(std::holds_alternative<error>(visited[3]));
+    auto copied = storage.get_device_messages("device");
+    REQUIRE(copied.size() == visited.size());
+    REQUIRE(std::holds_alternative<error>(copied[3]));
+    REQUIRE(std::get<measurement>(visited[4]).temperature_sensors == std::get<measurement>(copied[4]).temperature_sensors);
+
+    size_t unknown_visits{0};
+    storage.for_each_message("unknown", [&](const auto&) { unknown_visits++; });
+    REQUIRE(unknown_visits == 0);
+}
+
+TEST_CASE("Device history time range queries")
+{
+    using hw::device_control_messages::error;
+    using hw::device_control_messages::measurement;
+
+    hw::storage::device_history history(4);
+    measurement meas_msg("device");
+    meas_msg.temperature_sensors = std::vector<uint16_t>{0};
+
+    // Measurements at times 10, 20, ..., 200, errors at 55 and 155
+    for (uint16_t i = 1; i <= 20; i++)
+    {
+        meas_msg.temperature_sensors[0] = i * 10;
+        history.append(i * 10, meas_msg);
+        if (i == 5 || i == 15)
+            history.append(i * 10 + 5, error("device", error::error_type::unknown));
+    }
+
+    auto visit = [&](hw::storage::timestamp_t from_, hw::storage::timestamp_t to_) {
+        std::vector<hw::storage::timestamp_t> timestamps;
+        history.for_each_message_between("device", from_, to_, [&](const auto& view_) { timestamps.push_back(view_.timestamp()); });
+        return timestamps;
+    };
+
+    REQUIRE(visit(45, 75) == std::vector<hw::storage::timestamp_t>{50, 55, 60, 70});
+    REQUIRE(history.count_between(45, 75) == 4);
+    REQUIRE(visit(155, 161) == std::vector<hw::storage::timestamp_t>{155, 160});
+    REQUIRE(history.count_between(0, 1000) == 22);
+    REQUIRE(history.count_between(201, 1000) == 0);
+    REQUIRE(history.count_between(100, 100) == 0);
+    REQUIRE(visit(0, 1000).size() == 22);
+
+    // Time going backwards does not break ordering
+    history.append(5, meas_msg);
+    REQUIRE(history.count_between(200, 201) == 2);
+}
+
+TEST_CASE("Device messages storage time range queries")
+{
+    hw::device_messages_storage storage;
+    hw::device_control_messages::measurement meas_msg("device");
+
+    auto before = hw::storage::now();
+    storage.new_message(meas_msg);
+    storage.new_message(meas_msg);
+    auto after = hw::storage::now() + 1;
+
+    REQUIRE(storage.count_device_messages_between("device", before, after) == 2);
+    REQUIRE(storage.get_device_messages_between("device", before, after).size() == 2);
+    REQUIRE(storage.count_device_messages_between("device", after, after + 1000) == 0);
+    REQUIRE(storage.count_device_messages_between("unknown", before, after) == 0);
+}
+
+TEST_CASE("Device messages storage statistics snapshots")
+{
+    using hw::device_control_messages::error;
+    using hw::device_control_messages::measurement;
+
+    SECTION("published on request")
+    {
+        hw::device_messages_storage storage;
+        auto empty = storage.get_statistics_snapshot();
+        REQUIRE(empty->timestamp == 0);
+        REQUIRE(empty->devices.empty());
+
+        storage.new_message(measurement("device2"));
+        storage.new_message(error("device1", error::error_type::exploded));
+        storage.new_message(measurement("device1"));
+        REQUIRE(storage.get_statistics_snapshot()->devices.empty());
+
+        storage.publish_statistics_snapshot();
+        auto snapshot = storage.get_statistics_snapshot();
+        REQUIRE(snapshot->timestamp > 0);
+        REQUIRE(snapshot->devices.size() == 2);
+        REQUIRE(snapshot->devices[0].first == "device1");
+        REQUIRE(snapshot->find("device1")->total() == 2);
+        REQUIRE(snapshot->find("device1")->count(error::error_type::exploded) == 1);
+        REQUIRE(snapshot->find("device2")->measurements == 1);
+        REQUIRE(snapshot->find("device3") == nullptr);
+
+        // Published snapshots never change
+        storage.new_message(measurement("device2"));
+        storage.publish_statistics_snapshot();
+        REQUIRE(snapshot->find("device2")->measurements == 1);
+        REQUIRE(storage.get_statistics_snapshot()->find("device2")->measurements == 2);
+    }
+
+    SECTION("published periodically")
+    {
+        hw::storage_config config;
+        config.snapshot_interval = std::chrono::milliseconds(5);
+        hw::device_messages_storage storage(config);
+        storage.new_message(measurement("device"));
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!storage.get_statistics_snapshot()->find("device") && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        REQUIRE(storage.get_statistics_snapshot()->find("device"));
+    }
+}
@@ -0,0 +1,95 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <common/handler_holder.h>
+
+TEMPLATE_TEST_CASE("Handler holder", "", hw::common::handler_holder<void(int)>, hw::common::locking_handler_holder<void(int)>)
+{
+    TestType holder;
+
+    SECTION("invoking without handler")
+    {
+        REQUIRE_NOTHROW(holder(1));
+        holder = nullptr;
+        REQUIRE_NOTHROW(holder(1));
+    }
+
+    SECTION("invoking and replacing handler")
+    {
+        int sum{0};
+        holder = [&](int value_) { sum += value_; };
+        holder(1);
+        holder(2);
+        REQUIRE(sum == 3);
+
+        holder = [&](int value_) { sum -= value_; };
+        holder(3);
+        REQUIRE(sum == 0);
+    }
+
+    SECTION("replacing handler while invoked concurrently")
+    {
+        const size_t threads_count = 4;
+        const int calls            = 20000;
+
+        std::atomic<long> first{0};
+        std::atomic<long> second{0};
+        holder = [&](int value_) { first += value_; };
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < threads_count; t++)
+        {
+            threads.emplace_back([&] {
+                for (int i = 0; i < calls; i++)
+                {
+                    holder(1);
+                }
+            });
+        }
+        // Handler captures shared state, it must stay alive while any invocation uses it
+        for (int i = 0; i < 100; i++)
+        {
+            holder = [&, odd = i % 2 == 1, state = std::make_shared<int>(1)](int value_) { (odd ? second : first) += value_ * *state; };
+        }
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+
+        REQUIRE(first + second == static_cast<long>(threads_count) * calls);
+    }
+}
+
+TEST_CASE("Handler holder callback copy")
+{
+    hw::common::handler_holder<void(int)> holder;
+    REQUIRE_FALSE(holder.get());
+
+    int sum{0};
+    holder    = [&](int value_) { sum += value_; };
+    auto copy = holder.get();
+    holder    = [&](int value_) { sum -= value_; };
+
+    // Copy keeps calling the callback current at the time it was taken
+    copy(2);
+    holder(1);
+    REQUIRE(sum == 1);
+}
+
+TEST_CASE("Handler holder releases replaced callback")
+{
+    hw::common::handler_holder<void(int)> holder;
+    auto state = std::make_shared<int>(0);
+    holder     = [state](int value_) { *state += value_; };
+    holder(1);
+    REQUIRE(state.use_count() == 2);
+
+    // Captured state of replaced callback is destroyed once no invocation holds it
+    holder = nullptr;
+    REQUIRE(state.use_count() == 1);
+    REQUIRE(*state == 1);
+}
@@ -0,0 +1,191 @@
+#include <catch2/catch.hpp>
+
+#include <thread>
+#include <vector>
+
+#include <common/mpsc_queue.h>
+#include <ingest_queue.h>
+
+#include "test_helpers.h"
+
+using hw::tests::make_measurement;
+
+TEST_CASE("MPSC queue")
+{
+    hw::common::mpsc_queue<int> queue(3);
+    REQUIRE(queue.capacity() == 4);
+
+    for (int i = 0; i < 4; i++)
+    {
+        REQUIRE(queue.try_push(i));
+    }
+    int overflow = 4;
+    REQUIRE_FALSE(queue.try_push(overflow));
+    REQUIRE(queue.size() == 4);
+
+    for (int i = 0; i < 4; i++)
+    {
+        REQUIRE(queue.try_pop() == i);
+    }
+    REQUIRE_FALSE(queue.try_pop());
+    REQUIRE(queue.size() == 0);
+
+    SECTION("concurrent producers")
+    {
+        constexpr int producers    = 4;
+        constexpr int per_producer = 10000;
+
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; p++)
+        {
+            threads.emplace_back([&queue, p] {
+                for (int i = 0; i < per_producer; i++)
+                {
+                    int value = p * per_producer + i;
+                    while (!queue.try_push(value))
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+
+        // Values of each producer are popped in order they were pushed
+        std::vector<int> next(producers, 0);
+        bool ordered = true;
+        for (int popped = 0; popped < producers * per_producer;)
+        {
+            if (auto value = queue.try_pop())
+            {
+                auto producer = *value / per_producer;
+                ordered       = ordered && *value % per_producer == next[producer];
+                next[producer]++;
+                popped++;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+        REQUIRE(ordered);
+        REQUIRE_FALSE(queue.try_pop());
+    }
+}
+
+TEST_CASE("Device messages storage batch")
+{
+    hw::storage_config config;
+    config.shards_count = 3;
+    hw::device_messages_storage storage(config);
+
+    std::vector<hw::received_message> batch;
+    for (uint16_t i = 0; i < 30; i++)
+    {
+        batch.push_back({i, make_measurement("device" + std::to_string(i % 5), {i})});
+    }
+    storage.new_messages(batch);
+
+    REQUIRE(storage.get_devices().size() == 5);
+    for (size_t d = 0; d < 5; d++)
+    {
+        auto messages = storage.get_device_messages_of_type<hw::device_control_messages::measurement>("device" + std::to_string(d));
+        REQUIRE(messages.size() == 6);
+        for (size_t i = 0; i < messages.size(); i++)
+        {
+            REQUIRE(messages[i].temperature_sensors == std::vector<uint16_t>{static_cast<uint16_t>(i * 5 + d)});
+        }
+    }
+    REQUIRE(storage.count_device_messages_between("device0", 0, 10) == 2);
+}
+
+TEST_CASE("Ingest queue")
+{
+    hw::device_messages_storage storage;
+    hw::ingest_config config;
+    config.capacity  = 64;
+    config.max_batch = 16;
+
+    constexpr size_t producers    = 4;
+    constexpr size_t per_producer = 2000;
+
+    SECTION("blocking overflow")
+    {
+        {
+            hw::ingest_queue queue(storage, config);
+            std::atomic<size_t> rejected{0};
+            std::vector<std::thread> threads;
+            for (size_t p = 0; p < producers; p++)
+            {
+                threads.emplace_back([&queue, &rejected, p] {
+                    for (size_t i = 0; i < per_producer; i++)
+                    {
+                        if (!queue.push(make_measurement("device" + std::to_string(p), {static_cast<uint16_t>(i)})))
+                            rejected++;
+                    }
+                });
+            }
+            for (auto& t : threads)
+            {
+                t.join();
+            }
+            queue.flush();
+            REQUIRE(rejected == 0);
+
+            auto stats = queue.statistics();
+            REQUIRE(stats.enqueued == producers * per_producer);
+            REQUIRE(stats.applied == producers * per_producer);
+            REQUIRE(stats.dropped == 0);
+            REQUIRE(stats.depth == 0);
+            REQUIRE(stats.batches > 0);
+        }
+
+        for (size_t p = 0; p < producers; p++)
+        {
+            auto messages = storage.get_device_messages_of_type<hw::device_control_messages::measurement>("device" + std::to_string(p));
+            REQUIRE(messages.size() == per_producer);
+            bool ordered = true;
+            for (size_t i = 0; i < messages.size(); i++)
+            {
+                ordered = ordered && messages[i].temperature_sensors[0] == i;
+            }
+            REQUIRE(ordered);
+        }
+    }
+
+    SECTION("dropping overflow")
+    {
+        config.overflow = hw::ingest_overflow::drop;
+        size_t accepted{0};
+        {
+            hw::ingest_queue queue(storage, config);
+            for (size_t i = 0; i < per_producer; i++)
+            {
+                accepted += queue.push(make_measurement("device", {static_cast<uint16_t>(i)}));
+            }
+            queue.flush();
+
+            auto stats = queue.statistics();
+            REQUIRE(stats.enqueued == accepted);
+            REQUIRE(stats.enqueued + stats.dropped == per_producer);
+            REQUIRE(stats.applied == accepted);
+            REQUIRE(stats.producer_waits == 0);
+        }
+        REQUIRE(storage.get_device_messages_count<hw::device_control_messages::measurement>("device") == accepted);
+    }
+
+    SECTION("destruction stores queued messages")
+    {
+        {
+            hw::ingest_queue queue(storage, config);
+            for (size_t i = 0; i < 100; i++)
+            {
+                queue.push(make_measurement("device", {static_cast<uint16_t>(i)}));
+            }
+        }
+        REQUIRE(storage.get_device_messages_count<hw::device_control_messages::measurement>("device") == 100);
+    }
+}
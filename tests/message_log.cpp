@@ -0,0 +1,252 @@
+#include <catch2/catch.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include <unistd.h>
+
+#include <device_messages_storage.h>
+#include <metrics/metrics.h>
+#include <storage/message_log.h>
+
+namespace
+{
+std::filesystem::path make_log_directory()
+{
+    auto directory = std::filesystem::temp_directory_path() / ("hw-message-log-test-" + std::to_string(::getpid()));
+    std::filesystem::remove_all(directory);
+    return directory;
+}
+}
+
+TEST_CASE("Message log recovery")
+{
+    using hw::device_control_messages::error;
+    using hw::device_control_messages::measurement;
+
+    measurement meas_msg("device1");
+    meas_msg.temperature_sensors = std::vector<uint16_t>{20, 21};
+    meas_msg.fans_speed          = std::vector<uint8_t>{50};
+
+    hw::storage::message_log_config log_config;
+    log_config.directory           = make_log_directory();
+    log_config.commit_interval     = std::chrono::milliseconds(1);
+    log_config.checkpoint_interval = std::chrono::hours(1);
+    log_config.segment_size        = 256;
+
+    // Copy of the log taken before shutdown, as left by a crash
+    auto crashed_directory = log_config.directory;
+    crashed_directory += "-crashed";
+    std::filesystem::remove_all(crashed_directory);
+
+    {
+        hw::device_messages_storage storage;
+        REQUIRE(storage.enable_persistence(log_config));
+        for (int i = 0; i < 20; i++)
+        {
+            storage.new_message(meas_msg);
+        }
+        storage.new_message(error("device1", error::error_type::exploded));
+        storage.new_message(error("device2", error::error_type::unknown));
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::filesystem::copy(log_config.directory, crashed_directory);
+    }
+    // Small segment size makes the log span several segments, no checkpoint was written yet
+    REQUIRE(std::distance(std::filesystem::directory_iterator(crashed_directory), std::filesystem::directory_iterator{}) > 2);
+    REQUIRE_FALSE(std::filesystem::exists(crashed_directory / "checkpoint"));
+
+    SECTION("from checkpoint")
+    {
+        auto checkpoint = hw::storage::read_checkpoint(log_config.directory);
+        REQUIRE(checkpoint);
+        REQUIRE(checkpoint->devices.size() == 2);
+        // Checkpoint taken at shutdown covers the whole log, segments before it are deleted
+        REQUIRE(std::distance(std::filesystem::directory_iterator(log_config.directory), std::filesystem::directory_iterator{}) == 2);
+    }
+    SECTION("from log only")
+    {
+        log_config.directory = crashed_directory;
+    }
+    SECTION("with torn record at the end")
+    {
+        log_config.directory = crashed_directory;
+        std::vector<std::filesystem::path> segments;
+        for (const auto& entry : std::filesystem::directory_iterator(log_config.directory))
+        {
+            segments.push_back(entry.path());
+        }
+        std::ofstream(*std::max_element(segments.begin(), segments.end()), std::ios::binary | std::ios::app) << std::string("\x20\x00\x00\x00garbage", 11);
+    }
+
+    {
+        hw::device_messages_storage storage;
+        REQUIRE(storage.enable_persistence(log_config));
+        REQUIRE(storage.get_device_messages_count<measurement>("device1") == 20);
+        REQUIRE(storage.get_device_messages_count<error>("device1") == 1);
+        REQUIRE(storage.get_device_statistics("device2").count(error::error_type::unknown) == 1);
+        // Stored history is restored regardless of checkpoint
+        REQUIRE(storage.get_device_messages("device1").size() == 21);
+
+        // Log continues behind recovered data
+        storage.new_message(meas_msg);
+    }
+
+    {
+        hw::device_messages_storage storage;
+        REQUIRE(storage.enable_persistence(log_config));
+        REQUIRE(storage.get_device_messages_count<measurement>("device1") == 21);
+        REQUIRE(storage.get_device_messages("device1").size() == 22);
+    }
+
+    std::filesystem::remove_all(log_config.directory);
+    std::filesystem::remove_all(crashed_directory);
+}
+
+TEST_CASE("Message log replays stored history")
+{
+    using hw::device_control_messages::measurement;
+
+    measurement meas_msg("device1");
+    meas_msg.temperature_sensors = std::vector<uint16_t>{20, 21};
+    meas_msg.fans_speed          = std::vector<uint8_t>{50};
+
+    hw::storage::message_log_config log_config;
+    log_config.directory = make_log_directory();
+
+    {
+        hw::device_messages_storage storage;
+        REQUIRE(storage.enable_persistence(log_config));
+        storage.new_message(meas_msg);
+    }
+    std::filesystem::remove(log_config.directory / "checkpoint");
+
+    {
+        auto& stored       = hw::metrics::default_registry().add_counter("hw_storage_messages_total", "Messages stored");
+        auto stored_before = stored.value();
+
+        hw::device_messages_storage storage;
+        REQUIRE(storage.enable_persistence(log_config));
+        // Replayed messages are not counted as ingested again
+        REQUIRE(stored.value() == stored_before);
+
+        auto messages = storage.get_device_messages_of_type<measurement>("device1");
+        REQUIRE(messages.size() == 1);
+        REQUIRE(messages[0].temperature_sensors == meas_msg.temperature_sensors);
+        REQUIRE(messages[0].fans_speed == meas_msg.fans_speed);
+    }
+
+    std::filesystem::remove_all(log_config.directory);
+}
+
+TEST_CASE("Message log restores history within retention from checkpoint")
+{
+    using hw::device_control_messages::measurement;
+
+    hw::storage::message_log_config log_config;
+    log_config.directory           = make_log_directory();
+    log_config.commit_interval     = std::chrono::milliseconds(1);
+    log_config.checkpoint_interval = std::chrono::seconds(0);
+    log_config.segment_size        = 256;
+
+    hw::storage_config storage_config;
+    storage_config.retention.max_messages = 5;
+
+    auto store = [&](uint16_t from_, uint16_t to_) {
+        hw::device_messages_storage storage(storage_config);
+        REQUIRE(storage.enable_persistence(log_config));
+        for (uint16_t i = from_; i < to_; i++)
+        {
+            measurement meas_msg("device1");
+            meas_msg.temperature_sensors = std::vector<uint16_t>{i};
+            storage.new_message(meas_msg);
+            // Let the writer take checkpoints while messages are stored
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    };
+    auto check = [&](uint16_t to_) {
+        hw::device_messages_storage storage(storage_config);
+        REQUIRE(storage.enable_persistence(log_config));
+        REQUIRE(hw::storage::read_checkpoint(log_config.directory));
+        REQUIRE(storage.get_device_messages_count<measurement>("device1") == to_);
+
+        auto messages = storage.get_device_messages_of_type<measurement>("device1");
+        REQUIRE(messages.size() == 5);
+        for (uint16_t i = 0; i < 5; i++)
+        {
+            REQUIRE(messages[i].temperature_sensors == std::vector<uint16_t>{static_cast<uint16_t>(to_ - 5 + i)});
+        }
+    };
+
+    store(0, 40);
+    check(40);
+
+    // Segments holding only evicted messages are deleted
+    REQUIRE_FALSE(std::filesystem::exists(log_config.directory / "segment-00000000000000000000.log"));
+
+    // Restored history keeps being bounded and persisted after restart
+    store(40, 50);
+    check(50);
+
+    std::filesystem::remove_all(log_config.directory);
+}
+
+TEST_CASE("Message log restores unlimited history from checkpoint")
+{
+    using hw::device_control_messages::error;
+    using hw::device_control_messages::measurement;
+
+    hw::storage::message_log_config log_config;
+    log_config.directory           = make_log_directory();
+    log_config.commit_interval     = std::chrono::milliseconds(1);
+    log_config.checkpoint_interval = std::chrono::seconds(0);
+    log_config.segment_size        = 256;
+
+    // Small blocks make most of the history sealed into compressed blocks
+    hw::storage_config storage_config;
+    storage_config.block_capacity = 8;
+
+    auto make_measurement = [](uint16_t i_) {
+        measurement meas_msg("device1");
+        meas_msg.temperature_sensors = std::vector<uint16_t>(1 + i_ % 3, i_);
+        meas_msg.fans_speed          = std::vector<uint8_t>{static_cast<uint8_t>(i_)};
+        return meas_msg;
+    };
+    auto store = [&](uint16_t from_, uint16_t to_) {
+        hw::device_messages_storage storage(storage_config);
+        REQUIRE(storage.enable_persistence(log_config));
+        for (uint16_t i = from_; i < to_; i++)
+        {
+            storage.new_message(make_measurement(i));
+            if (i % 10 == 0)
+                storage.new_message(error("device1", error::error_type::disc_corrupted));
+        }
+    };
+    auto check = [&](uint16_t to_) {
+        hw::device_messages_storage storage(storage_config);
+        REQUIRE(storage.enable_persistence(log_config));
+        REQUIRE(storage.get_device_messages_count<measurement>("device1") == to_);
+        REQUIRE(storage.get_device_messages_of_type<error>("device1").size() == static_cast<size_t>((to_ + 9) / 10));
+
+        auto messages = storage.get_device_messages_of_type<measurement>("device1");
+        REQUIRE(messages.size() == to_);
+        for (uint16_t i = 0; i < to_; i++)
+        {
+            REQUIRE(messages[i].temperature_sensors == make_measurement(i).temperature_sensors);
+            REQUIRE(messages[i].fans_speed == make_measurement(i).fans_speed);
+        }
+    };
+
+    store(0, 100);
+    check(100);
+
+    // History is carried by the checkpoint, the log does not grow with it
+    REQUIRE_FALSE(std::filesystem::exists(log_config.directory / "segment-00000000000000000000.log"));
+    REQUIRE(std::distance(std::filesystem::directory_iterator(log_config.directory), std::filesystem::directory_iterator{}) == 2);
+
+    store(100, 150);
+    check(150);
+
+    std::filesystem::remove_all(log_config.directory);
+}
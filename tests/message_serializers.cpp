@@ -0,0 +1,156 @@
+#include <catch2/catch.hpp>
+
+#include <device_control_messages/message_binary_converter.h>
+#include <device_control_messages/message_json_coverter.h>
+#include <device_control_messages/messages.h>
+
+#include "test_helpers.h"
+
+namespace
+{
+hw::device_control_messages::measurement make_measurement()
+{
+    using hw::device_control_messages::measurement;
+    return hw::tests::make_measurement("device", {1, 300, measurement::error_temperature}, {1, measurement::error_fan_speed});
+}
+}
+
+TEMPLATE_TEST_CASE("Message serialization round trip", "", hw::device_control_messages::json_serializer, hw::device_control_messages::binary_serializer)
+{
+    auto meas_msg = make_measurement();
+    hw::device_control_messages::error error_msg("device", hw::device_control_messages::error::error_type::exploded);
+    TestType serializer;
+
+    SECTION("measurement")
+    {
+        auto data              = TestType::serialize(meas_msg);
+        auto [message, length] = serializer.deserialize(data);
+        REQUIRE(message);
+        REQUIRE(length == data.size());
+
+        hw::device_control_messages::measurement m;
+        REQUIRE_NOTHROW(m = std::get<hw::device_control_messages::measurement>(*message));
+        REQUIRE(m.device_name == meas_msg.device_name);
+        REQUIRE(m.msg_type == meas_msg.msg_type);
+        REQUIRE(m.temperature_sensors == meas_msg.temperature_sensors);
+        REQUIRE(m.fans_speed == meas_msg.fans_speed);
+        REQUIRE_FALSE(m.device_timestamp);
+    }
+
+    SECTION("device timestamp")
+    {
+        meas_msg.device_timestamp  = 1'700'000'000'123'456'789;
+        error_msg.device_timestamp = 42;
+
+        auto [measurement, measurement_len] = serializer.deserialize(TestType::serialize(meas_msg));
+        REQUIRE(measurement);
+        REQUIRE(std::get<hw::device_control_messages::measurement>(*measurement).device_timestamp == meas_msg.device_timestamp);
+
+        auto [error, error_len] = serializer.deserialize(TestType::serialize(error_msg));
+        REQUIRE(error);
+        REQUIRE(std::get<hw::device_control_messages::error>(*error).device_timestamp == 42);
+    }
+
+    SECTION("error")
+    {
+        auto data              = TestType::serialize(error_msg);
+        auto [message, length] = serializer.deserialize(data);
+        REQUIRE(message);
+        REQUIRE(length == data.size());
+
+        hw::device_control_messages::error m;
+        REQUIRE_NOTHROW(m = std::get<hw::device_control_messages::error>(*message));
+        REQUIRE(m.device_name == error_msg.device_name);
+        REQUIRE(m.msg_type == error_msg.msg_type);
+        REQUIRE(m.err_type == error_msg.err_type);
+    }
+
+    SECTION("incomplete message")
+    {
+        auto data = TestType::serialize(meas_msg);
+        for (size_t len = 0; len < data.size(); len++)
+        {
+            std::vector<hw::common::byte_t> partial(data.begin(), data.begin() + len);
+            auto [message, length] = serializer.deserialize(partial);
+            REQUIRE_FALSE(message);
+            REQUIRE(length == 0);
+        }
+    }
+
+    SECTION("concatenated messages")
+    {
+        auto data       = TestType::serialize(error_msg);
+        auto first_size = data.size();
+        auto second     = TestType::serialize(meas_msg);
+        data.insert(data.end(), second.begin(), second.end());
+
+        auto [message, length] = serializer.deserialize(data);
+        REQUIRE(message);
+        REQUIRE(length == first_size);
+        REQUIRE_NOTHROW(std::get<hw::device_control_messages::error>(*message));
+    }
+}
+
+TEMPLATE_TEST_CASE("Malformed data is skipped", "", hw::device_control_messages::json_serializer, hw::device_control_messages::binary_serializer)
+{
+    hw::device_control_messages::error error_msg("device", hw::device_control_messages::error::error_type::unknown);
+    TestType serializer;
+
+    std::vector<hw::common::byte_t> data{'x', 'y', 'z'};
+    auto valid = TestType::serialize(error_msg);
+    data.insert(data.end(), valid.begin(), valid.end());
+
+    auto [message, length] = serializer.deserialize(data);
+    while (!message && length != 0)
+    {
+        data.erase(data.begin(), data.begin() + length);
+        std::tie(message, length) = serializer.deserialize(data);
+    }
+
+    REQUIRE(message);
+    REQUIRE(length == valid.size());
+    REQUIRE_NOTHROW(std::get<hw::device_control_messages::error>(*message));
+}
+
+TEST_CASE("JSON framing")
+{
+    hw::device_control_messages::json_framer framer;
+    auto as_bytes = [](const std::string& str_) { return std::vector<hw::common::byte_t>(str_.begin(), str_.end()); };
+
+    SECTION("braces and escaped quotes in strings")
+    {
+        auto data           = as_bytes(R"( {"a":"}{\"}","b":[{}]}{"c":1})");
+        auto [status, size] = framer.next(data);
+        REQUIRE(status == hw::device_control_messages::json_framer::status::complete);
+        REQUIRE(size == data.size() - std::string(R"({"c":1})").size());
+    }
+
+    SECTION("object split across calls")
+    {
+        auto data = as_bytes(R"({"a":"}"})");
+        for (size_t len = 0; len < data.size(); len++)
+        {
+            auto [status, size] = framer.next(std::span(data.data(), len));
+            REQUIRE(status == hw::device_control_messages::json_framer::status::incomplete);
+            REQUIRE(size == 0);
+        }
+        auto [status, size] = framer.next(data);
+        REQUIRE(status == hw::device_control_messages::json_framer::status::complete);
+        REQUIRE(size == data.size());
+    }
+
+    SECTION("invalid prefix")
+    {
+        auto data           = as_bytes(R"(  x{})");
+        auto [status, size] = framer.next(data);
+        REQUIRE(status == hw::device_control_messages::json_framer::status::invalid);
+        REQUIRE(size == 3);
+    }
+}
+
+TEST_CASE("Binary format is more compact than JSON")
+{
+    auto meas_msg = make_measurement();
+    REQUIRE(hw::device_control_messages::binary_serializer::serialize(meas_msg).size() * 4
+            < hw::device_control_messages::json_serializer::serialize(meas_msg).size());
+}
@@ -1,16 +1,27 @@
 #include <catch2/catch.hpp>
 
+#include <atomic>
+#include <filesystem>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <thread>
 
 #include <boost/asio.hpp>
 
+#include <device_control_messages/message_binary_converter.h>
 #include <device_control_messages/message_json_coverter.h>
 #include <device_control_messages/messages.h>
 #include <net/device_tcp_client.h>
 #include <net/device_tcp_server.h>
+#include <net/device_udp_client.h>
+#include <net/device_udp_server.h>
+#include <net/device_uring_server.h>
+#include <net/io_context_pool.h>
+#include <net/io_uring.h>
 
-TEST_CASE("Reporting messages using TCP")
+TEMPLATE_TEST_CASE("Reporting messages using TCP", "", hw::device_control_messages::json_serializer, hw::device_control_messages::binary_serializer)
 {
     hw::device_control_messages::measurement meas_msg("device");
     meas_msg.temperature_sensors = std::vector<uint16_t>{1, 2, 3};
@@ -34,8 +45,8 @@ TEST_CASE("Reporting messages using TCP")
 
     boost::asio::io_context ioc;
 
-    auto client = std::make_shared<hw::net::device_tcp_client<hw::device_control_messages::json_serializer>>(ioc);
-    auto server = std::make_shared<hw::net::device_tcp_server<hw::device_control_messages::json_serializer>>(ioc);
+    auto client = std::make_shared<hw::net::device_tcp_client<TestType>>(ioc);
+    auto server = std::make_shared<hw::net::device_tcp_server<TestType>>(ioc);
 
     client->on_error = [&] { client_error = true; };
     client->on_close = [&] { client_close = true; };
@@ -99,6 +110,77 @@ TEST_CASE("Reporting messages using TCP")
         };
     }
 
+    SECTION("message longer than initial receive buffer")
+    {
+        expect_server_msg_received = true;
+        expect_client_connected    = true;
+
+        meas_msg.temperature_sensors = std::vector<uint16_t>(4096, 12345);
+
+        client->on_connect = [&] {
+            client_connected = true;
+            client->send(meas_msg);
+        };
+        server->on_message = [&](auto msg_) {
+            server_msg_received = true;
+            hw::device_control_messages::measurement m;
+            REQUIRE_NOTHROW(m = std::get<hw::device_control_messages::measurement>(msg_));
+            REQUIRE(m.temperature_sensors == meas_msg.temperature_sensors);
+        };
+    }
+
+    size_t burst_received{0};
+    SECTION("burst of messages")
+    {
+        expect_server_msg_received = true;
+        expect_client_connected    = true;
+
+        const uint16_t burst_len = 200;
+
+        client->on_connect = [&] {
+            client_connected = true;
+            for (uint16_t i = 0; i < burst_len; i++)
+            {
+                meas_msg.temperature_sensors = std::vector<uint16_t>{i};
+                client->send(meas_msg);
+            }
+        };
+        server->on_message = [&](auto msg_) {
+            hw::device_control_messages::measurement m;
+            REQUIRE_NOTHROW(m = std::get<hw::device_control_messages::measurement>(msg_));
+            REQUIRE(m.temperature_sensors == std::vector<uint16_t>{static_cast<uint16_t>(burst_received)});
+            if (++burst_received == burst_len)
+                server_msg_received = true;
+        };
+    }
+
+    size_t unbatched_received{0};
+    SECTION("zero batch limits")
+    {
+        expect_server_msg_received = true;
+        expect_client_connected    = true;
+
+        // Every write still carries one message
+        hw::net::connection_config config;
+        config.max_batch_messages = 0;
+        config.max_batch_bytes    = 0;
+        client                    = std::make_shared<hw::net::device_tcp_client<TestType>>(ioc, config);
+        client->on_error          = [&] { client_error = true; };
+        client->on_close          = [&] { client_close = true; };
+
+        client->on_connect = [&] {
+            client_connected = true;
+            for (int i = 0; i < 10; i++)
+            {
+                client->send(meas_msg);
+            }
+        };
+        server->on_message = [&](auto) {
+            if (++unbatched_received == 10)
+                server_msg_received = true;
+        };
+    }
+
     std::vector<hw::device_control_messages::device_message_type> received_messages;
     SECTION("multiple messages")
     {
@@ -155,4 +237,286 @@ TEST_CASE("Reporting messages using TCP")
     REQUIRE(client_error == expect_client_error);
     REQUIRE(client_close == expect_client_close);
     REQUIRE(server_error == expect_server_error);
-}
\ No newline at end of file
+}
+TEMPLATE_TEST_CASE("Reporting messages using TCP with io_context pool", "", hw::device_control_messages::json_serializer,
+                   hw::device_control_messages::binary_serializer)
+{
+    const hw::net::ip_address_t ip = "127.0.0.1";
+    const hw::net::port_t port     = 12346;
+    const size_t clients_count     = 4;
+    const uint16_t burst_len       = 100;
+
+    boost::asio::io_context ioc;
+    hw::net::io_context_pool pool(2);
+
+    std::atomic<size_t> received{0};
+    std::mutex threads_mtx;
+    std::set<std::thread::id> delivering_threads;
+
+    auto server        = std::make_shared<hw::net::device_tcp_server<TestType>>(ioc, pool);
+    server->on_message = [&](auto msg_) {
+        if (std::holds_alternative<hw::device_control_messages::measurement>(msg_))
+            received++;
+        std::scoped_lock lock(threads_mtx);
+        delivering_threads.insert(std::this_thread::get_id());
+    };
+    server->listen(ip, port);
+
+    std::vector<std::shared_ptr<hw::net::device_tcp_client<TestType>>> clients;
+    for (size_t c = 0; c < clients_count; c++)
+    {
+        auto client        = std::make_shared<hw::net::device_tcp_client<TestType>>(ioc);
+        client->on_connect = [client = client.get(), c] {
+            hw::device_control_messages::measurement meas_msg("device" + std::to_string(c));
+            for (uint16_t i = 0; i < burst_len; i++)
+            {
+                meas_msg.temperature_sensors = std::vector<uint16_t>{i};
+                client->send(meas_msg);
+            }
+        };
+        client->connect(ip, port);
+        clients.push_back(std::move(client));
+    }
+
+    pool.run();
+    auto t         = std::thread([&ioc] { ioc.run(); });
+    auto server_id = t.get_id();
+    for (size_t i = 0; i < 100 && received < clients_count * burst_len; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    clients.clear();
+    server.reset();
+    t.join();
+    pool.stop();
+    pool.join();
+
+    REQUIRE(received == clients_count * burst_len);
+    // Connections are spread round-robin, so both io_contexts of the pool delivered messages
+    REQUIRE(delivering_threads.size() == 2);
+    REQUIRE(delivering_threads.count(server_id) == 0);
+}
+
+TEMPLATE_TEST_CASE("Reporting messages using UDP", "", hw::device_control_messages::json_serializer, hw::device_control_messages::binary_serializer)
+{
+    const hw::net::ip_address_t ip = "127.0.0.1";
+    const hw::net::port_t port     = 12347;
+    const uint16_t burst_len       = 100;
+
+    hw::device_control_messages::error error_msg("device", hw::device_control_messages::error::error_type::exploded);
+
+    boost::asio::io_context ioc;
+
+    hw::net::datagram_config config;
+    config.recv_batch       = 8;
+    config.max_datagram_len = 512;
+    // Burst is drained over several wakeups when batches per wakeup are limited
+    config.batches_per_wakeup = GENERATE(size_t{1}, size_t{16});
+
+    auto client = std::make_shared<hw::net::device_udp_client<TestType>>(ioc);
+    auto server = std::make_shared<hw::net::device_udp_server<TestType>>(ioc, config);
+
+    bool client_connected{false};
+    bool server_error{false};
+    std::vector<hw::device_control_messages::device_message_type> received_messages;
+    server->on_error   = [&] { server_error = true; };
+    server->on_message = [&](auto msg_) { received_messages.push_back(std::move(msg_)); };
+
+    hw::net::datagram_statistics expected_statistics;
+    SECTION("burst of messages")
+    {
+        client->on_connect = [&] {
+            client_connected = true;
+            hw::device_control_messages::measurement meas_msg("device");
+            for (uint16_t i = 0; i < burst_len; i++)
+            {
+                meas_msg.temperature_sensors = std::vector<uint16_t>{i};
+                client->send(meas_msg);
+            }
+            client->send(error_msg);
+        };
+        expected_statistics.received = burst_len + 1;
+    }
+
+    SECTION("malformed and truncated datagrams")
+    {
+        client->on_connect = [&] {
+            client_connected = true;
+            boost::asio::ip::udp::socket raw(ioc, boost::asio::ip::udp::v4());
+            raw.send_to(boost::asio::buffer(std::string("garbage")), boost::asio::ip::udp::endpoint(boost::asio::ip::make_address(ip), port));
+            hw::device_control_messages::measurement long_msg("device");
+            long_msg.temperature_sensors = std::vector<uint16_t>(1024, 12345);
+            client->send(long_msg);
+            client->send(error_msg);
+        };
+        expected_statistics.received  = 1;
+        expected_statistics.malformed = 2;
+    }
+
+    server->listen(ip, port);
+    // Let the server bind before datagrams are sent
+    auto t = std::thread([&ioc] { ioc.run(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    client->connect(ip, port);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    auto statistics = server->statistics();
+    client.reset();
+    server.reset();
+    t.join();
+
+    REQUIRE(client_connected);
+    REQUIRE_FALSE(server_error);
+    REQUIRE(statistics.received == expected_statistics.received);
+    REQUIRE(statistics.malformed == expected_statistics.malformed);
+    REQUIRE(statistics.dropped == 0);
+    REQUIRE(received_messages.size() == expected_statistics.received);
+
+    bool in_order = std::holds_alternative<hw::device_control_messages::error>(received_messages.back());
+    for (size_t i = 0; i + 1 < received_messages.size(); i++)
+    {
+        auto meas = std::get_if<hw::device_control_messages::measurement>(&received_messages[i]);
+        in_order  = in_order && meas && meas->temperature_sensors == std::vector<uint16_t>{static_cast<uint16_t>(i)};
+    }
+    REQUIRE(in_order);
+}
+
+TEMPLATE_TEST_CASE("Reporting messages using Unix domain socket", "", hw::device_control_messages::json_serializer,
+                   hw::device_control_messages::binary_serializer)
+{
+    const std::string socket_path = (std::filesystem::temp_directory_path() / "hw_device_monitor_test.sock").string();
+    const uint16_t burst_len      = 100;
+
+    boost::asio::io_context ioc;
+
+    // Socket file left behind by previous server is replaced
+    {
+        auto stale = std::make_shared<hw::net::device_unix_server<TestType>>(ioc);
+        stale->listen(socket_path);
+        ioc.run_for(std::chrono::milliseconds(50));
+        stale.reset();
+        ioc.restart();
+        ioc.run();
+        ioc.restart();
+    }
+    REQUIRE(std::filesystem::is_socket(socket_path));
+
+    auto client = std::make_shared<hw::net::device_unix_client<TestType>>(ioc);
+    auto server = std::make_shared<hw::net::device_unix_server<TestType>>(ioc);
+
+    bool client_connected{false};
+    bool client_error{false};
+    bool server_error{false};
+    size_t received{0};
+    bool in_order{true};
+
+    client->on_error   = [&] { client_error = true; };
+    server->on_error   = [&] { server_error = true; };
+    client->on_connect = [&] {
+        client_connected = true;
+        hw::device_control_messages::measurement meas_msg("device");
+        for (uint16_t i = 0; i < burst_len; i++)
+        {
+            meas_msg.temperature_sensors = std::vector<uint16_t>{i};
+            client->send(meas_msg);
+        }
+    };
+    server->on_message = [&](auto msg_) {
+        auto meas = std::get_if<hw::device_control_messages::measurement>(&msg_);
+        in_order  = in_order && meas && meas->temperature_sensors == std::vector<uint16_t>{static_cast<uint16_t>(received)};
+        received++;
+    };
+
+    server->listen(socket_path);
+    client->connect(socket_path);
+
+    // Socket of running server is not taken over
+    bool intruder_error{false};
+    auto intruder      = std::make_shared<hw::net::device_unix_server<TestType>>(ioc);
+    intruder->on_error = [&] { intruder_error = true; };
+    intruder->listen(socket_path);
+
+    auto t = std::thread([&ioc] { ioc.run(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    client.reset();
+    server.reset();
+    intruder.reset();
+    t.join();
+    std::filesystem::remove(socket_path);
+
+    REQUIRE(client_connected);
+    REQUIRE_FALSE(client_error);
+    REQUIRE_FALSE(server_error);
+    REQUIRE(intruder_error);
+    REQUIRE(received == burst_len);
+    REQUIRE(in_order);
+}
+
+#if defined(HW_WITH_IO_URING)
+TEMPLATE_TEST_CASE("Reporting messages using io_uring", "", hw::device_control_messages::json_serializer, hw::device_control_messages::binary_serializer)
+{
+    if (!hw::net::io_uring_backend_supported())
+    {
+        WARN("io_uring backend not supported by the kernel");
+        return;
+    }
+
+    const hw::net::ip_address_t ip = "127.0.0.1";
+    const hw::net::port_t port     = 12348;
+    const size_t clients_count     = 4;
+    const uint16_t burst_len       = 100;
+
+    // Few small buffers, so messages are split over buffers and receives run out of buffers.
+    // Short submission queue fills up while completions are processed.
+    hw::net::io_uring_config uring_config;
+    uring_config.queue_entries = 4;
+    uring_config.buffers_count = 4;
+    uring_config.buffer_len    = 64;
+
+    boost::asio::io_context ioc;
+
+    std::atomic<size_t> received{0};
+    std::map<std::string, uint16_t> next_value;
+    bool in_order{true};
+    bool server_error{false};
+
+    auto server        = std::make_shared<hw::net::device_uring_server<TestType>>(hw::net::connection_config{}, uring_config);
+    server->on_error   = [&] { server_error = true; };
+    server->on_message = [&](auto msg_) {
+        auto meas = std::get_if<hw::device_control_messages::measurement>(&msg_);
+        in_order  = in_order && meas && meas->temperature_sensors == std::vector<uint16_t>{next_value[meas->device_name]++};
+        received++;
+    };
+    server->listen(ip, port);
+
+    std::vector<std::shared_ptr<hw::net::device_tcp_client<TestType>>> clients;
+    for (size_t c = 0; c < clients_count; c++)
+    {
+        auto client        = std::make_shared<hw::net::device_tcp_client<TestType>>(ioc);
+        client->on_connect = [client = client.get(), c] {
+            hw::device_control_messages::measurement meas_msg("device" + std::to_string(c));
+            for (uint16_t i = 0; i < burst_len; i++)
+            {
+                meas_msg.temperature_sensors = std::vector<uint16_t>{i};
+                client->send(meas_msg);
+            }
+        };
+        client->connect(ip, port);
+        clients.push_back(std::move(client));
+    }
+
+    auto t = std::thread([&ioc] { ioc.run(); });
+    for (size_t i = 0; i < 100 && received < clients_count * burst_len; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    clients.clear();
+    t.join();
+    server.reset();
+
+    REQUIRE_FALSE(server_error);
+    REQUIRE(received == clients_count * burst_len);
+    REQUIRE(next_value.size() == clients_count);
+    REQUIRE(in_order);
+}
+#endif
@@ -0,0 +1,210 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include <device_messages_storage.h>
+#include <metrics/metrics.h>
+#include <net/metrics_http_server.h>
+
+namespace
+{
+std::string render(const hw::metrics::registry& registry_)
+{
+    std::ostringstream os;
+    registry_.write(os);
+    return os.str();
+}
+
+// Send request to metrics server and read whole response
+std::string http_get(const std::string& target_, hw::net::port_t port_)
+{
+    boost::asio::io_context ioc;
+    boost::asio::ip::tcp::socket sock(ioc);
+    boost::system::error_code ec;
+    for (int attempt = 0; attempt < 50; attempt++)
+    {
+        sock.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), port_), ec);
+        if (!ec)
+            break;
+        sock = boost::asio::ip::tcp::socket(ioc);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    std::string request = "GET " + target_ + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    boost::asio::write(sock, boost::asio::buffer(request), ec);
+
+    std::string response;
+    boost::asio::read(sock, boost::asio::dynamic_buffer(response), ec);
+    return response;
+}
+}
+
+TEST_CASE("Metrics counter and gauge")
+{
+    hw::metrics::counter counter;
+    hw::metrics::gauge gauge;
+
+    constexpr int threads_count = 8;
+    constexpr int per_thread    = 10000;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threads_count; t++)
+    {
+        threads.emplace_back([&counter, &gauge, t] {
+            for (int i = 0; i < per_thread; i++)
+            {
+                counter.add();
+                gauge.add(t % 2 ? 1 : -1);
+            }
+            counter.add(5);
+        });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    REQUIRE(counter.value() == threads_count * (per_thread + 5));
+    REQUIRE(gauge.value() == 0);
+
+    gauge.add(-3);
+    REQUIRE(gauge.value() == -3);
+}
+
+TEST_CASE("Metrics histogram")
+{
+    hw::metrics::histogram hist({1, 10, 100});
+    for (double value : {0.5, 1.0, 5.0, 10.0, 50.0, 1000.0})
+    {
+        hist.observe(value);
+    }
+
+    auto counts = hist.read();
+    REQUIRE(counts.buckets == std::vector<uint64_t>{2, 4, 5, 6});
+    REQUIRE(counts.sum == Approx(1066.5));
+}
+
+TEST_CASE("Metrics registry")
+{
+    hw::metrics::registry registry;
+
+    auto& tcp = registry.add_counter("test_bytes_total", "Bytes", "transport=\"tcp\"");
+    auto& udp = registry.add_counter("test_bytes_total", "Bytes", "transport=\"udp\"");
+    REQUIRE(&tcp == &registry.add_counter("test_bytes_total", "Bytes", "transport=\"tcp\""));
+    REQUIRE(&tcp != &udp);
+
+    tcp.add(10);
+    udp.add(3);
+    registry.add_gauge("test_open", "Open").add(2);
+    registry.add_histogram("test_size", "Size", {10, 100}).observe(50);
+
+    auto text = render(registry);
+    REQUIRE(text.find("# HELP test_bytes_total Bytes\n# TYPE test_bytes_total counter\n") != std::string::npos);
+    REQUIRE(text.find("test_bytes_total{transport=\"tcp\"} 10\n") != std::string::npos);
+    REQUIRE(text.find("test_bytes_total{transport=\"udp\"} 3\n") != std::string::npos);
+    REQUIRE(text.find("# TYPE test_open gauge\ntest_open 2\n") != std::string::npos);
+    REQUIRE(text.find("test_size_bucket{le=\"10\"} 0\ntest_size_bucket{le=\"100\"} 1\ntest_size_bucket{le=\"+Inf\"} 1\n") != std::string::npos);
+    REQUIRE(text.find("test_size_sum 50\ntest_size_count 1\n") != std::string::npos);
+
+    SECTION("callbacks")
+    {
+        double value = 7;
+        registry.add_callback("test_depth", "Depth", hw::metrics::metric_type::gauge, [&value] { return value; });
+        REQUIRE(render(registry).find("test_depth 7\n") != std::string::npos);
+
+        value = 9;
+        REQUIRE(render(registry).find("test_depth 9\n") != std::string::npos);
+
+        registry.remove_callback("test_depth");
+        REQUIRE(render(registry).find("test_depth") == std::string::npos);
+    }
+    SECTION("kind conflicts")
+    {
+        REQUIRE_THROWS_AS(registry.add_gauge("test_bytes_total", "Bytes"), std::invalid_argument);
+        REQUIRE_THROWS_AS(registry.add_callback("test_bytes_total", "Bytes", hw::metrics::metric_type::counter, [] { return 0.0; }, "transport=\"tcp\""),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS(registry.add_callback("test_open", "Open", hw::metrics::metric_type::counter, [] { return 0.0; }), std::invalid_argument);
+
+        registry.add_callback("test_bytes_total", "Bytes", hw::metrics::metric_type::counter, [] { return 5.0; }, "transport=\"unix\"");
+        REQUIRE_THROWS_AS(registry.add_counter("test_bytes_total", "Bytes", "transport=\"unix\""), std::invalid_argument);
+
+        // Metrics handed out before stay registered and alive
+        tcp.add(1);
+        text = render(registry);
+        REQUIRE(text.find("test_bytes_total{transport=\"tcp\"} 11\n") != std::string::npos);
+        REQUIRE(text.find("test_bytes_total{transport=\"unix\"} 5\n") != std::string::npos);
+        REQUIRE(text.find("test_open 2\n") != std::string::npos);
+    }
+}
+
+TEST_CASE("Storage metrics")
+{
+    auto& stored       = hw::metrics::default_registry().add_counter("hw_storage_messages_total", "Messages stored");
+    auto& bytes        = hw::metrics::default_registry().add_gauge("hw_storage_stored_bytes", "Memory occupied by stored messages and aggregates in bytes");
+    auto stored_before = stored.value();
+    auto bytes_before  = bytes.value();
+
+    {
+        hw::device_messages_storage storage;
+        for (uint16_t i = 0; i < 100; i++)
+        {
+            hw::device_control_messages::measurement msg("dev");
+            msg.temperature_sensors = std::vector<uint16_t>{i};
+            storage.new_message(msg);
+        }
+
+        REQUIRE(stored.value() == stored_before + 100);
+        REQUIRE(bytes.value() > bytes_before);
+    }
+
+    // Memory of destroyed storage is no longer reported
+    REQUIRE(bytes.value() == bytes_before);
+}
+
+TEST_CASE("Metrics HTTP endpoint")
+{
+    constexpr hw::net::port_t port = 12349;
+
+    hw::metrics::registry registry;
+    registry.add_counter("test_requests_total", "Requests").add(42);
+
+    boost::asio::io_context ioc;
+    bool error       = false;
+    auto server      = std::make_shared<hw::net::metrics_http_server>(ioc, registry, std::chrono::milliseconds(100));
+    server->on_error = [&error] { error = true; };
+    server->listen("127.0.0.1", port);
+
+    std::thread ioc_thread([&ioc] {
+        auto work = boost::asio::make_work_guard(ioc);
+        ioc.run();
+    });
+
+    auto metrics   = http_get("/metrics", port);
+    auto not_found = http_get("/", port);
+
+    // Connection without request is closed after the request timeout
+    boost::asio::io_context client_ioc;
+    boost::asio::ip::tcp::socket idle(client_ioc);
+    idle.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), port));
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    idle.non_blocking(true);
+    std::array<char, 1> byte;
+    boost::system::error_code idle_ec;
+    idle.read_some(boost::asio::buffer(byte), idle_ec);
+
+    ioc.stop();
+    ioc_thread.join();
+
+    REQUIRE_FALSE(error);
+    REQUIRE(metrics.rfind("HTTP/1.1 200 OK\r\n", 0) == 0);
+    REQUIRE(metrics.find("Content-Type: text/plain; version=0.0.4") != std::string::npos);
+    REQUIRE(metrics.find("\r\n\r\n# HELP test_requests_total Requests\n# TYPE test_requests_total counter\ntest_requests_total 42\n") != std::string::npos);
+    REQUIRE(not_found.rfind("HTTP/1.1 404 Not Found\r\n", 0) == 0);
+    REQUIRE(idle_ec == boost::asio::error::eof);
+}
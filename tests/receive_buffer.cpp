@@ -0,0 +1,54 @@
+#include <catch2/catch.hpp>
+
+#include <cstring>
+
+#include <net/receive_buffer.h>
+
+TEST_CASE("Receive buffer")
+{
+    hw::net::receive_buffer buffer(4, 16);
+
+    auto write = [&buffer](const std::string& str_) {
+        auto region = buffer.prepare();
+        REQUIRE(region.size() >= str_.size());
+        std::memcpy(region.data(), str_.data(), str_.size());
+        buffer.commit(str_.size());
+    };
+    auto read = [&buffer] { return std::string(buffer.data().begin(), buffer.data().end()); };
+
+    SECTION("consume keeps rest of data in place")
+    {
+        write("abcd");
+        auto rest = buffer.data().data() + 2;
+        buffer.consume(2);
+        REQUIRE(buffer.data().data() == rest);
+        REQUIRE(read() == "cd");
+    }
+
+    SECTION("grows when receive fills prepared region")
+    {
+        write("abcd");
+        REQUIRE(buffer.prepare().size() == 8);
+        write("efghijkl");
+        REQUIRE(read() == "abcdefghijkl");
+    }
+
+    SECTION("unprocessed data survives compaction")
+    {
+        write("abcd");
+        write("efghijkl");
+        buffer.consume(10);
+        write("mnop");
+        REQUIRE(read() == "klmnop");
+    }
+
+    SECTION("full buffer")
+    {
+        write("abcd");
+        write("efghijkl");
+        write("mnop");
+        REQUIRE(buffer.prepare().empty());
+        buffer.consume(16);
+        REQUIRE(buffer.prepare().size() == 16);
+    }
+}
@@ -0,0 +1,160 @@
+#include <catch2/catch.hpp>
+
+#include <chrono>
+
+#include <device_messages_storage.h>
+#include <storage/rollup_tiers.h>
+
+#include "test_helpers.h"
+
+namespace
+{
+constexpr hw::storage::timestamp_t second = 1'000'000'000;
+
+hw::device_control_messages::measurement make_measurement(uint16_t temperature_)
+{
+    return hw::tests::make_measurement("device", {temperature_}, {10});
+}
+}
+
+TEST_CASE("Rollup tiers")
+{
+    using namespace std::chrono_literals;
+
+    hw::storage::rollup_config config;
+    config.tiers = {{1s, 1h}, {1min, 24h}, {1h, 24h * 365}};
+    hw::storage::rollup_tiers rollups(config);
+
+    // Two measurements per second for two hours, temperature is the number of the minute
+    constexpr hw::storage::timestamp_t end = 2 * 3600 * second;
+    for (hw::storage::timestamp_t t = 0; t < end; t += second / 2)
+    {
+        rollups.record(t, make_measurement(static_cast<uint16_t>(t / (60 * second))));
+    }
+
+    SECTION("retention of tiers")
+    {
+        REQUIRE(rollups.buckets_count(0) <= 3601);
+        REQUIRE(rollups.buckets_count(1) == 120);
+        REQUIRE(rollups.buckets_count(2) == 2);
+    }
+
+    SECTION("fine tier for recent data")
+    {
+        auto series = rollups.temperature(0, end - 10 * second, end, 1s);
+        REQUIRE(series.tier_resolution == 1s);
+        REQUIRE(series.points.size() == 10);
+        REQUIRE(series.points[0].aggregate.count == 2);
+        REQUIRE(series.points[0].aggregate.min == 119);
+    }
+
+    SECTION("coarser tier when fine tier does not reach back")
+    {
+        auto series = rollups.temperature(0, 0, end, 1s);
+        REQUIRE(series.tier_resolution == 1min);
+        REQUIRE(series.points.size() == 120);
+        REQUIRE(series.points[5].aggregate.count == 120);
+        REQUIRE(series.points[5].aggregate.min == 5);
+        REQUIRE(series.points[5].aggregate.max == 5);
+    }
+
+    SECTION("coarsest tier satisfying resolution")
+    {
+        auto series = rollups.temperature(0, 0, end, 10min);
+        REQUIRE(series.tier_resolution == 1min);
+        REQUIRE(series.resolution == 10min);
+        REQUIRE(series.points.size() == 12);
+        REQUIRE(series.points[1].aggregate.count == 1200);
+        REQUIRE(series.points[1].aggregate.min == 10);
+        REQUIRE(series.points[1].aggregate.max == 19);
+        REQUIRE(series.points[1].aggregate.mean() == Approx(14.5));
+
+        auto hourly = rollups.fan_speed(0, 0, end, 1h);
+        REQUIRE(hourly.tier_resolution == 1h);
+        REQUIRE(hourly.points.size() == 2);
+        REQUIRE(hourly.points[0].aggregate.count == 7200);
+    }
+
+    SECTION("error values")
+    {
+        rollups.record(end, make_measurement(hw::device_control_messages::measurement::error_temperature));
+        auto series = rollups.temperature(0, end, end + second, 1s);
+        REQUIRE(series.points.size() == 1);
+        REQUIRE(series.points[0].aggregate.count == 0);
+        REQUIRE(series.points[0].aggregate.errors == 1);
+    }
+
+    SECTION("memory bounded by retention")
+    {
+        hw::storage::rollup_config short_config;
+        short_config.tiers = {{1s, 10s}};
+        hw::storage::rollup_tiers short_rollups(short_config);
+
+        // Buckets of one temperature sensor and one fan, at most 12 of them are ever kept
+        constexpr size_t bucket_size = sizeof(hw::storage::timestamp_t) + 2 * sizeof(hw::storage::column_aggregate);
+        for (hw::storage::timestamp_t t = 0; t < 100 * second; t += second / 2)
+        {
+            short_rollups.record(t, make_measurement(1));
+        }
+        auto memory_size = short_rollups.memory_size();
+        REQUIRE(short_rollups.buckets_count(0) <= 12);
+        REQUIRE(memory_size <= 12 * bucket_size);
+
+        for (hw::storage::timestamp_t t = 100 * second; t < 200 * second; t += second / 2)
+        {
+            short_rollups.record(t, make_measurement(1));
+        }
+        REQUIRE(short_rollups.memory_size() == memory_size);
+    }
+
+    SECTION("measurements of different shape")
+    {
+        rollups.record(end, hw::tests::make_measurement("device", {7, 8}, {20, 30}));
+        rollups.record(end + second, make_measurement(9));
+
+        auto second_sensor = rollups.temperature(1, end - 10 * second, end + 2 * second, 1s);
+        REQUIRE(second_sensor.points.size() == 1);
+        REQUIRE(second_sensor.points[0].aggregate.max == 8);
+        REQUIRE(rollups.fan_speed(1, end, end + 2 * second, 1s).points.size() == 1);
+
+        // Older buckets keep their values after the tier is widened
+        auto first_sensor = rollups.temperature(0, end - 10 * second, end + 2 * second, 1s);
+        REQUIRE(first_sensor.points.size() == 12);
+        REQUIRE(first_sensor.points[0].aggregate.min == 119);
+        REQUIRE(first_sensor.points[11].aggregate.min == 9);
+        REQUIRE(rollups.fan_speed(0, end - 10 * second, end + 2 * second, 1s).points[11].aggregate.max == 10);
+    }
+
+    SECTION("retention without new measurements")
+    {
+        rollups.enforce_retention(end + 25 * 3600 * second);
+        REQUIRE(rollups.buckets_count(0) == 0);
+        REQUIRE(rollups.buckets_count(1) == 0);
+        REQUIRE(rollups.buckets_count(2) == 2);
+    }
+}
+
+TEST_CASE("Device messages storage rollups")
+{
+    hw::storage_config config;
+    config.rollups.tiers = {{std::chrono::seconds(1), std::chrono::hours(1)}, {std::chrono::hours(1), std::chrono::hours(24)}};
+    hw::device_messages_storage storage(config);
+    auto before = hw::storage::now();
+    storage.new_message(make_measurement(20));
+    storage.new_message(make_measurement(30));
+    auto after = hw::storage::now() + 1;
+
+    auto series = storage.get_temperature_rollup("device", 0, before, after, std::chrono::hours(1));
+    REQUIRE(series.tier_resolution == std::chrono::hours(1));
+    REQUIRE(series.points.size() == 1);
+    REQUIRE(series.points[0].aggregate.mean() == 25);
+    REQUIRE(storage.get_fan_speed_rollup("device", 0, before, after, std::chrono::seconds(1)).points.size() >= 1);
+    REQUIRE(storage.get_temperature_rollup("unknown", 0, before, after, std::chrono::seconds(1)).points.empty());
+
+    SECTION("disabled by default")
+    {
+        hw::device_messages_storage disabled;
+        disabled.new_message(make_measurement(20));
+        REQUIRE(disabled.get_temperature_rollup("device", 0, before, hw::storage::now() + 1, std::chrono::seconds(1)).points.empty());
+    }
+}
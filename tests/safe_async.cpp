@@ -0,0 +1,135 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+
+#include <boost/asio.hpp>
+
+#include <common/safe_async.h>
+
+namespace
+{
+std::atomic<size_t> heap_allocations{0};
+
+class counter : public hw::common::safe_async<counter>
+{
+public:
+    counter(boost::asio::io_context& ioc_)
+        : hw::common::safe_async<counter>(ioc_)
+        , _timer(ioc_)
+    {}
+
+    // Post a chain of handlers, each posting the next one
+    void post_chain(size_t length_) { this->post_member_safe(&counter::next, length_, std::string("payload")); }
+
+    // Wait for timer repeatedly, each completion starts next wait
+    void wait_chain(size_t length_)
+    {
+        _remaining = length_;
+        this->post_member_safe(&counter::start_wait);
+    }
+
+    // Post handler from outside of io_context threads
+    void post_one() { this->post_member_safe(&counter::count); }
+
+    size_t invocations{0};
+
+private:
+    void next(size_t remaining_, std::string payload_)
+    {
+        invocations++;
+        if (remaining_ > 1)
+            this->post_member_safe(&counter::next, remaining_ - 1, std::move(payload_));
+    }
+
+    void start_wait()
+    {
+        _timer.expires_after(std::chrono::nanoseconds(0));
+        _timer.async_wait(this->wrap_member_safe(&counter::handle_wait));
+    }
+
+    void handle_wait(boost::system::error_code)
+    {
+        invocations++;
+        if (--_remaining > 0)
+            start_wait();
+    }
+
+    void count() { invocations++; }
+
+    boost::asio::steady_timer _timer;
+    size_t _remaining{0};
+};
+}
+
+void* operator new(size_t size_)
+{
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto pointer = std::malloc(size_ ? size_ : 1))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer_) noexcept
+{
+    std::free(pointer_);
+}
+
+void operator delete(void* pointer_, size_t) noexcept
+{
+    std::free(pointer_);
+}
+
+TEST_CASE("Safe async handlers do not allocate")
+{
+    boost::asio::io_context ioc;
+    auto object = std::make_shared<counter>(ioc);
+
+    // Warm up, lets Boost.Asio create its per-thread and per-service state
+    object->post_chain(10);
+    object->wait_chain(10);
+    ioc.run();
+    ioc.restart();
+    object->invocations = 0;
+
+    SECTION("posting from handlers")
+    {
+        object->post_chain(1000);
+        auto before = heap_allocations.load();
+        ioc.run();
+        REQUIRE(object->invocations == 1000);
+        REQUIRE(heap_allocations - before == 0);
+    }
+
+    SECTION("posting from outside of io_context")
+    {
+        auto before = heap_allocations.load();
+        for (size_t i = 0; i < 1000; i++)
+        {
+            object->post_one();
+            ioc.run();
+            ioc.restart();
+        }
+        REQUIRE(object->invocations == 1000);
+        REQUIRE(heap_allocations - before == 0);
+    }
+
+    SECTION("completion handlers of asynchronous operations")
+    {
+        object->wait_chain(1000);
+        auto before = heap_allocations.load();
+        ioc.run();
+        REQUIRE(object->invocations == 1000);
+        REQUIRE(heap_allocations - before == 0);
+    }
+
+    SECTION("handlers queued when object is destroyed")
+    {
+        object->post_chain(1000);
+        object.reset();
+        REQUIRE_NOTHROW(ioc.run());
+    }
+}
@@ -0,0 +1,151 @@
+#include <catch2/catch.hpp>
+
+#include <chrono>
+
+#include <device_messages_storage.h>
+#include <storage/streaming_aggregates.h>
+#include <storage/value_histogram.h>
+
+#include "test_helpers.h"
+
+namespace
+{
+constexpr hw::storage::timestamp_t second = 1'000'000'000;
+
+hw::device_control_messages::measurement make_measurement(uint16_t temperature_, uint8_t fan_)
+{
+    return hw::tests::make_measurement("device", {temperature_}, {fan_});
+}
+}
+
+TEST_CASE("Value histogram")
+{
+    hw::storage::value_histogram<uint16_t> histogram;
+    REQUIRE(histogram.percentile(50) == 0);
+
+    SECTION("bucket boundaries")
+    {
+        bool bounded = true;
+        for (uint32_t value = 0; value <= 0xffff; value++)
+        {
+            auto index = hw::storage::value_histogram<uint16_t>::bucket_index(static_cast<uint16_t>(value));
+            auto max   = hw::storage::value_histogram<uint16_t>::bucket_max(index);
+            bounded    = bounded && index < hw::storage::value_histogram<uint16_t>::buckets_count && max >= value && max - value <= value / 32;
+        }
+        for (uint32_t value = 0; value <= 0xff; value++)
+        {
+            auto index = hw::storage::value_histogram<uint8_t>::bucket_index(static_cast<uint8_t>(value));
+            auto max   = hw::storage::value_histogram<uint8_t>::bucket_max(index);
+            bounded    = bounded && index < hw::storage::value_histogram<uint8_t>::buckets_count && max >= value && max - value <= value / 32;
+        }
+        REQUIRE(bounded);
+        REQUIRE(hw::storage::value_histogram<uint8_t>::buckets_count == 128);
+    }
+
+    SECTION("percentiles")
+    {
+        for (uint16_t value = 1; value <= 1000; value++)
+        {
+            histogram.record(value);
+        }
+        REQUIRE(histogram.total() == 1000);
+        REQUIRE(histogram.percentile(0) == 1);
+        REQUIRE(histogram.percentile(50) == Approx(500).epsilon(1.0 / 32));
+        REQUIRE(histogram.percentile(99) == Approx(990).epsilon(1.0 / 32));
+        REQUIRE(histogram.percentile(100) == Approx(1000).epsilon(1.0 / 32));
+
+        hw::storage::value_histogram<uint16_t> other;
+        for (int i = 0; i < 1000; i++)
+        {
+            other.record(2000);
+        }
+        histogram.merge(other);
+        REQUIRE(histogram.total() == 2000);
+        REQUIRE(histogram.percentile(75) == Approx(2000).epsilon(1.0 / 32));
+    }
+}
+
+TEST_CASE("Streaming aggregates")
+{
+    hw::storage::aggregation_config config;
+    config.window        = std::chrono::seconds(10);
+    config.windows_count = 3;
+    hw::storage::streaming_aggregates aggregates(config);
+
+    SECTION("error values are counted separately")
+    {
+        aggregates.record(0, make_measurement(100, 10));
+        aggregates.record(1, make_measurement(hw::device_control_messages::measurement::error_temperature, 20));
+        aggregates.record(2, make_measurement(300, hw::device_control_messages::measurement::error_fan_speed));
+
+        auto temperature = aggregates.temperature(0, 0);
+        REQUIRE(temperature.aggregate.count == 2);
+        REQUIRE(temperature.aggregate.errors == 1);
+        REQUIRE(temperature.aggregate.min == 100);
+        REQUIRE(temperature.aggregate.max == 300);
+        REQUIRE(temperature.aggregate.mean() == 200);
+        REQUIRE(temperature.percentile(100) == 300);
+
+        auto fan = aggregates.fan_speed(0, 0);
+        REQUIRE(fan.aggregate.count == 2);
+        REQUIRE(fan.aggregate.errors == 1);
+        REQUIRE(fan.aggregate.max == 20);
+
+        REQUIRE(aggregates.temperature(1, 0).aggregate.count == 0);
+    }
+
+    SECTION("tumbling windows")
+    {
+        for (uint16_t i = 0; i < 5; i++)
+        {
+            // One measurement per window, value equal to window index
+            aggregates.record(i * 10 * second + 1, make_measurement(i, i));
+        }
+
+        // Only the last 3 windows are kept
+        auto all = aggregates.temperature(0, 0);
+        REQUIRE(all.aggregate.count == 3);
+        REQUIRE(all.aggregate.min == 2);
+
+        auto recent = aggregates.temperature(0, 35 * second);
+        REQUIRE(recent.aggregate.count == 2);
+        REQUIRE(recent.aggregate.min == 3);
+        REQUIRE(recent.aggregate.max == 4);
+
+        // Reused windows do not grow memory
+        auto memory_size = aggregates.memory_size();
+        REQUIRE(memory_size >= 3 * (sizeof(hw::storage::temperature_summary) + sizeof(hw::storage::fan_speed_summary)));
+        aggregates.record(60 * second, make_measurement(6, 6));
+        REQUIRE(aggregates.memory_size() == memory_size);
+    }
+}
+
+TEST_CASE("Device messages storage summaries")
+{
+    hw::storage_config config;
+    config.aggregation.windows_count = 2;
+    SECTION("full mode") {}
+    SECTION("counts only mode")
+    {
+        config.mode = hw::storage_mode::counts_only;
+    }
+    hw::device_messages_storage storage(config);
+
+    for (uint16_t i = 1; i <= 100; i++)
+    {
+        storage.new_message(make_measurement(i, 50));
+    }
+
+    auto summary = storage.get_temperature_summary("device", 0, std::chrono::hours(1));
+    REQUIRE(summary.aggregate.count == 100);
+    REQUIRE(summary.percentile(99) == Approx(99).epsilon(1.0 / 32));
+    REQUIRE(storage.get_fan_speed_summary("device", 0).percentile(50) == 50);
+    REQUIRE(storage.get_temperature_summary("unknown", 0).aggregate.count == 0);
+
+    SECTION("disabled by default")
+    {
+        hw::device_messages_storage disabled;
+        disabled.new_message(make_measurement(1, 50));
+        REQUIRE(disabled.get_temperature_summary("device", 0).aggregate.count == 0);
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <device_control_messages/measurement.h>
+
+namespace hw::tests
+{
+
+/**
+ * @brief Make measurement message
+ *
+ * @param device_ Name of reporting device
+ * @param temperatures_ Values of temperature sensors
+ * @param fans_ Speeds of fans
+ * @return Measurement
+ */
+inline device_control_messages::measurement make_measurement(const std::string& device_, std::vector<uint16_t> temperatures_, std::vector<uint8_t> fans_ = {})
+{
+    device_control_messages::measurement msg(device_);
+    msg.temperature_sensors = std::move(temperatures_);
+    msg.fans_speed          = std::move(fans_);
+    return msg;
+}
+}
@@ -1,20 +1,34 @@
 
+#include <functional>
 #include <iostream>
+#include <sstream>
 #include <vector>
 
 #include <boost/asio.hpp>
 #include <boost/program_options.hpp>
 
 #include <common/types.h>
+#include <device_control_messages/message_binary_converter.h>
 #include <device_control_messages/message_json_coverter.h>
 #include <device_messages_storage.h>
+#include <ingest_queue.h>
 #include <net/device_tcp_server.h>
+#include <net/device_udp_server.h>
+#include <net/device_uring_server.h>
+#include <net/io_context_pool.h>
+#include <net/io_uring.h>
+#include <net/metrics_http_server.h>
 
 void print_help_message()
 {
-    std::cout << "Tool for monitoring devices in network. Runs TCP server to which device clients connect.\n\n";
+    std::cout << "Tool for monitoring devices in network. Runs TCP, UDP or Unix domain socket servers to which device clients connect.\n\n";
     std::cout << "Example of usage:\n"
               << "    ./device_monitor_tool --ip 1.2.3.4 --port 1234\n"
+              << "    ./device_monitor_tool --ip 1.2.3.4 --port 1234 --format binary\n"
+              << "    ./device_monitor_tool --ip 1.2.3.4 --port 1234 --persist-dir /var/lib/device_monitor\n"
+              << "    ./device_monitor_tool --unix-socket /run/device_monitor.sock\n"
+              << "    ./device_monitor_tool --ip 1.2.3.4 --port 1234 --io-uring\n"
+              << "    ./device_monitor_tool --ip 1.2.3.4 --port 1234 --metrics-port 9100\n"
               << std::endl;
 }
 
@@ -23,6 +37,9 @@ boost::asio::steady_timer print_timer(ioc);
 size_t stats_print_interval;
 
 std::shared_ptr<hw::device_messages_storage> storage;
+std::unique_ptr<hw::ingest_queue> ingest;
+std::unique_ptr<hw::net::io_context_pool> io_pool;
+std::function<hw::net::datagram_statistics()> udp_statistics;
 
 void stats_timer_tick(boost::system::error_code ec_)
 {
@@ -35,14 +52,20 @@ void stats_timer_tick(boost::system::error_code ec_)
     std::cout << "Number of devices: ";
     if (storage)
     {
-        auto devices = storage->get_devices();
-        std::cout << devices.size() << '\n';
-        for (const auto& d : devices)
+        // Counters are read from the latest published snapshot, no storage lock is taken
+        auto snapshot = storage->get_statistics_snapshot();
+        std::cout << snapshot->devices.size() << '\n';
+        for (const auto& [d, stats] : snapshot->devices)
         {
             std::cout << "----------\n";
             std::cout << "Device: " << d << '\n';
-            std::cout << "Number of error messages: " << storage->get_device_messages_of_type<hw::device_control_messages::error>(d).size() << '\n';
-            std::cout << "Number of measurement messages: " << storage->get_device_messages_of_type<hw::device_control_messages::measurement>(d).size() << '\n';
+            std::cout << "Number of error messages: " << stats.errors << '\n';
+            for (size_t i = 0; i < hw::device_control_messages::error::error_types_count; i++)
+            {
+                auto err_type = static_cast<hw::device_control_messages::error::error_type>(i);
+                std::cout << "    " << hw::device_control_messages::error::error_type_to_string(err_type) << ": " << stats.count(err_type) << '\n';
+            }
+            std::cout << "Number of measurement messages: " << stats.measurements << '\n';
             std::cout << "----------\n";
         }
     }
@@ -51,8 +74,31 @@ void stats_timer_tick(boost::system::error_code ec_)
         std::cout << "0\n";
     }
 
+    if (ingest)
+    {
+        auto ingest_stats = ingest->statistics();
+        std::cout << "---------------------------------------\n";
+        std::cout << "Ingest queue depth: " << ingest_stats.depth << '\n';
+        std::cout << "Enqueued messages: " << ingest_stats.enqueued << '\n';
+        std::cout << "Stored messages: " << ingest_stats.applied << " in " << ingest_stats.batches << " batches\n";
+        std::cout << "Dropped messages: " << ingest_stats.dropped << '\n';
+        std::cout << "Producer waits: " << ingest_stats.producer_waits << '\n';
+    }
+
+    if (udp_statistics)
+    {
+        auto udp_stats = udp_statistics();
+        std::cout << "---------------------------------------\n";
+        std::cout << "Received datagrams: " << udp_stats.received << '\n';
+        std::cout << "Malformed datagrams: " << udp_stats.malformed << '\n';
+        std::cout << "Dropped datagrams: " << udp_stats.dropped << '\n';
+    }
+
     std::cout << "---------------------------------------\n\n";
 
+    if (storage)
+        storage->apply_retention();
+
     print_timer.expires_from_now(std::chrono::seconds(stats_print_interval));
     print_timer.async_wait(stats_timer_tick);
 }
@@ -63,6 +109,117 @@ void start_stats_printing()
     print_timer.async_wait(stats_timer_tick);
 }
 
+void store_message(hw::device_control_messages::device_message_type message_)
+{
+    if (ingest)
+        ingest->push(std::move(message_));
+    else
+        storage->new_message(std::move(message_));
+}
+
+std::shared_ptr<void> start_metrics_server(const hw::net::ip_address_t& listen_ip_, hw::net::port_t listen_port_)
+{
+    if (ingest)
+    {
+        auto& registry = hw::metrics::default_registry();
+        registry.add_callback("hw_ingest_queue_depth", "Messages waiting in the ingest queue", hw::metrics::metric_type::gauge,
+                              [] { return static_cast<double>(ingest->statistics().depth); });
+        registry.add_callback("hw_ingest_enqueued_total", "Messages pushed to the ingest queue", hw::metrics::metric_type::counter,
+                              [] { return static_cast<double>(ingest->statistics().enqueued); });
+        registry.add_callback("hw_ingest_dropped_total", "Messages dropped because the ingest queue was full", hw::metrics::metric_type::counter,
+                              [] { return static_cast<double>(ingest->statistics().dropped); });
+        registry.add_callback("hw_ingest_producer_waits_total", "Pushes which waited for space in the ingest queue", hw::metrics::metric_type::counter,
+                              [] { return static_cast<double>(ingest->statistics().producer_waits); });
+    }
+
+    auto server = std::make_shared<hw::net::metrics_http_server>(ioc);
+
+    server->on_error = [] {
+        std::cerr << "Metrics HTTP server error" << std::endl;
+        exit(EXIT_FAILURE);
+    };
+
+    server->listen(listen_ip_, listen_port_);
+    return server;
+}
+
+template <class MessageSerializer>
+std::shared_ptr<void> start_server(const hw::net::ip_address_t& listen_ip_, hw::net::port_t listen_port_, const hw::net::connection_config& config_)
+{
+    auto server = io_pool ? std::make_shared<hw::net::device_tcp_server<MessageSerializer>>(ioc, *io_pool, config_)
+                          : std::make_shared<hw::net::device_tcp_server<MessageSerializer>>(ioc, config_);
+
+    server->on_error = [] {
+        std::cerr << "Device TCP server error" << std::endl;
+        exit(EXIT_FAILURE);
+    };
+
+    server->on_message = store_message;
+
+    server->listen(listen_ip_, listen_port_);
+    return server;
+}
+
+template <class MessageSerializer>
+std::shared_ptr<void> start_uring_server(const hw::net::ip_address_t& listen_ip_, hw::net::port_t listen_port_, const hw::net::connection_config& config_,
+                                         const hw::net::io_uring_config& uring_config_)
+{
+#if defined(HW_WITH_IO_URING)
+    if (hw::net::io_uring_backend_supported())
+    {
+        auto server = std::make_shared<hw::net::device_uring_server<MessageSerializer>>(config_, uring_config_);
+
+        server->on_error = [] {
+            std::cerr << "Device io_uring server error" << std::endl;
+            exit(EXIT_FAILURE);
+        };
+
+        server->on_message = store_message;
+
+        server->listen(listen_ip_, listen_port_);
+        return server;
+    }
+    std::cerr << "io_uring not supported by the kernel, using Boost.Asio reactor" << std::endl;
+#else
+    std::cerr << "Built without io_uring support, using Boost.Asio reactor" << std::endl;
+#endif
+    return start_server<MessageSerializer>(listen_ip_, listen_port_, config_);
+}
+
+template <class MessageSerializer>
+std::shared_ptr<void> start_unix_server(const std::string& socket_path_, const hw::net::connection_config& config_)
+{
+    auto server = io_pool ? std::make_shared<hw::net::device_unix_server<MessageSerializer>>(ioc, *io_pool, config_)
+                          : std::make_shared<hw::net::device_unix_server<MessageSerializer>>(ioc, config_);
+
+    server->on_error = [] {
+        std::cerr << "Device Unix socket server error" << std::endl;
+        exit(EXIT_FAILURE);
+    };
+
+    server->on_message = store_message;
+
+    server->listen(socket_path_);
+    return server;
+}
+
+template <class MessageSerializer>
+std::shared_ptr<void> start_udp_server(const hw::net::ip_address_t& listen_ip_, hw::net::port_t listen_port_, const hw::net::datagram_config& config_)
+{
+    auto server = std::make_shared<hw::net::device_udp_server<MessageSerializer>>(ioc, config_);
+
+    server->on_error = [] {
+        std::cerr << "Device UDP server error" << std::endl;
+        exit(EXIT_FAILURE);
+    };
+
+    server->on_message = store_message;
+
+    udp_statistics = [server = server.get()] { return server->statistics(); };
+    server->listen(listen_ip_, listen_port_);
+    return server;
+}
+
 
 int main(int argc_, char** argv_)
 {
@@ -73,7 +230,30 @@ int main(int argc_, char** argv_)
 
     hw::net::ip_address_t listen_ip;
     hw::net::port_t listen_port;
+    hw::net::port_t udp_port;
+    std::string unix_socket;
+    hw::net::datagram_config datagram_config;
+    std::string format;
+    hw::net::connection_config conn_config;
+    bool counts_only;
+    bool raw_blocks;
+    hw::storage_config storage_config;
+    size_t retention_age;
+    size_t aggregation_window;
+    size_t snapshot_interval;
+    std::vector<std::string> rollup_tiers;
+    hw::storage::message_log_config log_config;
+    std::string persist_dir;
+    size_t checkpoint_interval;
+    hw::ingest_config ingest_config;
+    std::string ingest_overflow;
     size_t num_threads;
+    size_t io_contexts;
+    bool pin_threads;
+    bool use_io_uring;
+    hw::net::io_uring_config uring_config;
+    hw::net::ip_address_t metrics_ip;
+    hw::net::port_t metrics_port;
 
     // clang-format off
     options.add_options()
@@ -82,9 +262,68 @@ int main(int argc_, char** argv_)
                 "IP address on which the device monitor will listen for incomming device connections")
             ("port", po::value<hw::net::port_t>(&listen_port), 
                 "TCP port on which the device monitor will listen fir incomming device connections")
+            ("unix-socket", po::value<std::string>(&unix_socket),
+                "Path of Unix domain socket on which the device monitor will listen for connections of devices running on the same host")
+            ("udp-port", po::value<hw::net::port_t>(&udp_port),
+                "UDP port on which the device monitor will receive device messages, one message per datagram")
+            ("udp-batch", po::value<size_t>(&datagram_config.recv_batch)->default_value(datagram_config.recv_batch),
+                "Maximum number of datagrams received by one system call")
+            ("udp-batches-per-wakeup", po::value<size_t>(&datagram_config.batches_per_wakeup)->default_value(datagram_config.batches_per_wakeup),
+                "Maximum number of UDP receive batches before other work of the thread gets to run")
+            ("udp-recv-buffer", po::value<size_t>(&datagram_config.socket_recv_buffer_len)->default_value(0),
+                "Size of UDP socket receive buffer in bytes, 0 keeps system default")
             ("stats-print-interval", po::value<size_t>(&stats_print_interval)->default_value(5),
                 "Interval in seconds in which stats of received messages will be printed.")
-            ("threads", po::value<size_t>(&num_threads)->default_value(2));
+            ("snapshot-interval", po::value<size_t>(&snapshot_interval)->default_value(1000),
+                "Interval in milliseconds of publishing snapshots of message counters read by stats printing")
+            ("format", po::value<std::string>(&format)->default_value("json"),
+                "Format of messages received from devices (json, binary)")
+            ("counts-only", po::bool_switch(&counts_only),
+                "Count received messages only, do not store them")
+            ("raw-blocks", po::bool_switch(&raw_blocks),
+                "Keep full blocks of stored measurements uncompressed")
+            ("storage-shards", po::value<size_t>(&storage_config.shards_count)->default_value(storage_config.shards_count),
+                "Number of independently locked storage shards")
+            ("retention-messages", po::value<size_t>(&storage_config.retention.max_messages)->default_value(0),
+                "Maximum number of stored messages per device, 0 for unlimited")
+            ("retention-age", po::value<size_t>(&retention_age)->default_value(0),
+                "Maximum age in seconds of stored messages, 0 for unlimited")
+            ("retention-memory", po::value<size_t>(&storage_config.retention.max_memory_bytes)->default_value(0),
+                "Maximum memory in bytes occupied by stored messages per device, 0 for unlimited")
+            ("aggregation-window", po::value<size_t>(&aggregation_window)->default_value(storage_config.aggregation.window.count()),
+                "Length in seconds of windows of per-sensor summaries")
+            ("aggregation-windows", po::value<size_t>(&storage_config.aggregation.windows_count)->default_value(storage_config.aggregation.windows_count),
+                "Number of kept windows of per-sensor summaries, 0 disables summaries")
+            ("rollup-tier", po::value<std::vector<std::string>>(&rollup_tiers)->multitoken(),
+                "Rollup tier as RESOLUTION:RETENTION in seconds, may be repeated, e.g. 60:86400 3600:2592000. Rollups are disabled by default.")
+            ("persist-dir", po::value<std::string>(&persist_dir),
+                "Directory of persistent message log. Stored state is recovered from it at startup. Persistence is disabled when not set.")
+            ("checkpoint-interval", po::value<size_t>(&checkpoint_interval)->default_value(log_config.checkpoint_interval.count()),
+                "Interval in seconds of writing checkpoints of persistent message log")
+            ("max-message-size", po::value<size_t>(&conn_config.max_recv_buffer_len)->default_value(conn_config.max_recv_buffer_len),
+                "Maximum size of one received message in bytes. Connections sending longer messages are closed.")
+            ("ingest-queue", po::value<size_t>(&ingest_config.capacity)->default_value(ingest_config.capacity),
+                "Capacity of queue between network threads and storage, 0 stores messages directly from network threads")
+            ("ingest-batch", po::value<size_t>(&ingest_config.max_batch)->default_value(ingest_config.max_batch),
+                "Maximum number of queued messages stored at once")
+            ("ingest-overflow", po::value<std::string>(&ingest_overflow)->default_value("block"),
+                "Behaviour when the ingest queue is full (block, drop)")
+            ("threads", po::value<size_t>(&num_threads)->default_value(2),
+                "Number of threads running the shared io_context")
+            ("io-contexts", po::value<size_t>(&io_contexts)->default_value(0),
+                "Run connections on this many io_contexts with one thread each instead of the shared io_context, 0 disables")
+            ("pin-threads", po::bool_switch(&pin_threads),
+                "Pin threads of --io-contexts to CPUs")
+            ("io-uring", po::bool_switch(&use_io_uring),
+                "Receive TCP connections through io_uring on its own thread, falls back to Boost.Asio reactor if the kernel does not support it")
+            ("io-uring-buffers", po::value<unsigned>(&uring_config.buffers_count)->default_value(uring_config.buffers_count),
+                "Number of io_uring receive buffers shared by all connections")
+            ("io-uring-buffer-size", po::value<size_t>(&uring_config.buffer_len)->default_value(uring_config.buffer_len),
+                "Size of one io_uring receive buffer in bytes")
+            ("metrics-ip", po::value<hw::net::ip_address_t>(&metrics_ip)->default_value("127.0.0.1"),
+                "IP address of the metrics HTTP endpoint")
+            ("metrics-port", po::value<hw::net::port_t>(&metrics_port),
+                "Serve metrics in Prometheus text format at http://<metrics-ip>:<metrics-port>/metrics");
     // clang-format on
 
     po::store(po::command_line_parser(argc_, argv_).options(options).run(), vm);
@@ -96,26 +335,105 @@ int main(int argc_, char** argv_)
         std::cout << options << std::endl;
         return EXIT_SUCCESS;
     }
-    if (!vm.count("port"))
+    if (!vm.count("port") && !vm.count("unix-socket") && !vm.count("udp-port"))
+    {
+        std::cerr << "Missing parameter --port, --unix-socket or --udp-port\n\n";
+        std::cerr << options << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (format != "json" && format != "binary")
+    {
+        std::cerr << "Invalid parameter --format\n\n";
+        std::cerr << options << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (ingest_overflow != "block" && ingest_overflow != "drop")
     {
-        std::cerr << "Missing parameter --port\n\n";
+        std::cerr << "Invalid parameter --ingest-overflow\n\n";
         std::cerr << options << std::endl;
         return EXIT_FAILURE;
     }
 
+    if (vm.count("rollup-tier"))
+    {
+        storage_config.rollups.tiers.clear();
+        for (const auto& tier : rollup_tiers)
+        {
+            size_t resolution, retention;
+            char separator;
+            std::istringstream ss(tier);
+            if (!(ss >> resolution >> separator >> retention) || separator != ':' || resolution == 0)
+            {
+                std::cerr << "Invalid parameter --rollup-tier " << tier << "\n\n";
+                std::cerr << options << std::endl;
+                return EXIT_FAILURE;
+            }
+            storage_config.rollups.tiers.push_back({std::chrono::seconds(resolution), std::chrono::seconds(retention)});
+        }
+    }
+
     // --- PROGRAM START --- //
 
-    auto server = std::make_shared<hw::net::device_tcp_server<hw::device_control_messages::json_serializer>>(ioc);
-    storage     = std::make_shared<hw::device_messages_storage>();
+    storage_config.mode               = counts_only ? hw::storage_mode::counts_only : hw::storage_mode::full;
+    storage_config.compress_blocks    = !raw_blocks;
+    storage_config.retention.max_age  = std::chrono::seconds(retention_age);
+    storage_config.aggregation.window = std::chrono::seconds(aggregation_window);
+    storage_config.snapshot_interval  = std::chrono::milliseconds(std::max<size_t>(snapshot_interval, 1));
+    storage                           = std::make_shared<hw::device_messages_storage>(storage_config);
 
-    server->on_error = [] {
-        std::cerr << "Device TCP server error" << std::endl;
-        exit(EXIT_FAILURE);
-    };
+    if (!persist_dir.empty())
+    {
+        log_config.directory           = persist_dir;
+        log_config.checkpoint_interval = std::chrono::seconds(checkpoint_interval);
+        if (!storage->enable_persistence(log_config))
+        {
+            std::cerr << "Cannot open persistent message log in " << persist_dir << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (ingest_config.capacity)
+    {
+        ingest_config.overflow = ingest_overflow == "drop" ? hw::ingest_overflow::drop : hw::ingest_overflow::block;
+        ingest                 = std::make_unique<hw::ingest_queue>(*storage, ingest_config);
+    }
 
-    server->on_message = [](auto msg_) { storage->new_message(std::move(msg_)); };
+    if (io_contexts)
+    {
+        io_pool = std::make_unique<hw::net::io_context_pool>(io_contexts, pin_threads);
+        io_pool->run();
+    }
+
+    std::shared_ptr<void> server;
+    if (vm.count("port") && use_io_uring && format == "binary")
+        server = start_uring_server<hw::device_control_messages::binary_serializer>(listen_ip, listen_port, conn_config, uring_config);
+    else if (vm.count("port") && use_io_uring)
+        server = start_uring_server<hw::device_control_messages::json_serializer>(listen_ip, listen_port, conn_config, uring_config);
+    else if (vm.count("port") && format == "binary")
+        server = start_server<hw::device_control_messages::binary_serializer>(listen_ip, listen_port, conn_config);
+    else if (vm.count("port"))
+        server = start_server<hw::device_control_messages::json_serializer>(listen_ip, listen_port, conn_config);
+
+    std::shared_ptr<void> unix_server;
+    if (vm.count("unix-socket") && format == "binary")
+        unix_server = start_unix_server<hw::device_control_messages::binary_serializer>(unix_socket, conn_config);
+    else if (vm.count("unix-socket"))
+        unix_server = start_unix_server<hw::device_control_messages::json_serializer>(unix_socket, conn_config);
+
+    std::shared_ptr<void> udp_server;
+    if (vm.count("udp-port"))
+    {
+        if (format == "binary")
+            udp_server = start_udp_server<hw::device_control_messages::binary_serializer>(listen_ip, udp_port, datagram_config);
+        else
+            udp_server = start_udp_server<hw::device_control_messages::json_serializer>(listen_ip, udp_port, datagram_config);
+    }
 
-    server->listen(listen_ip, listen_port);
+    std::shared_ptr<void> metrics_server;
+    if (vm.count("metrics-port"))
+        metrics_server = start_metrics_server(metrics_ip, metrics_port);
 
     start_stats_printing();
 
@@ -4,19 +4,58 @@
 #include <boost/asio.hpp>
 #include <boost/program_options.hpp>
 
+#include <device_control_messages/message_binary_converter.h>
 #include <device_control_messages/message_json_coverter.h>
 #include <devices/file_reading_device.h>
 #include <net/device_tcp_client.h>
+#include <net/device_udp_client.h>
 
 void print_help_message()
 {
-    std::cout << "Tool for reporting device temperature sensors and fan speeds to device monitor center using TCP connection.\n\n";
+    std::cout << "Tool for reporting device temperature sensors and fan speeds to device monitor center over TCP, UDP or Unix domain socket.\n\n";
     std::cout << "Example of usage:\n"
               << "    ./file_reading_device_tool --server-ip 1.2.3.4 --server-port 1234 --device-name testing_device -t /sys/class/hwmon/hwmon4/temp1_input -t "
                  "/sys/class/hwmon/hwmon4/temp2_input -f /sys/class/hwmon/hwmon2/fan1_input\n"
+              << "    ./file_reading_device_tool --server-socket /run/device_monitor.sock --device-name testing_device -t /sys/class/hwmon/hwmon4/temp1_input\n"
               << std::endl;
 }
 
+template <class Client, class... Endpoint>
+std::shared_ptr<void> start_client(boost::asio::io_context& ioc_, std::shared_ptr<hw::devices::file_reading_device> device_, const Endpoint&... endpoint_)
+{
+    auto client = std::make_shared<Client>(ioc_);
+
+    client->on_error = [] {
+        std::cerr << "Connection to server error" << std::endl;
+        exit(EXIT_FAILURE);
+    };
+
+    // UDP client has no connection which could be closed
+    if constexpr (requires { client->on_close = [] {}; })
+    {
+        client->on_close = [] {
+            std::cerr << "Connection to server closed" << std::endl;
+            exit(EXIT_FAILURE);
+        };
+    }
+
+    client->on_connect = [device_] {
+        std::cout << "Client connected" << std::endl;
+        device_->start();
+    };
+
+    device_->on_message = [weak_client = std::weak_ptr(client)](auto msg_) {
+        auto msg_sending_visitor = [](auto m_) { std::cout << "Sending message:\n" << m_.as_string() << std::endl; };
+        std::visit(msg_sending_visitor, msg_);
+
+        if (auto client = weak_client.lock())
+            client->send(std::move(msg_));
+    };
+
+    client->connect(endpoint_...);
+    return client;
+}
+
 int main(int argc_, char** argv_)
 {
     namespace po = boost::program_options;
@@ -26,7 +65,10 @@ int main(int argc_, char** argv_)
 
     hw::net::ip_address_t server_ip;
     hw::net::port_t server_port;
+    std::string server_socket;
     std::string device_name;
+    std::string format;
+    bool udp;
     size_t report_interval;
     size_t num_threads;
     std::vector<std::string> temp_sensor_files;
@@ -37,12 +79,16 @@ int main(int argc_, char** argv_)
             ("help,h", "Produce help message")
             ("server-ip,i", po::value<hw::net::ip_address_t>(&server_ip), "IP address of device monitoring server")
             ("server-port,p", po::value<hw::net::port_t>(&server_port), "TCP port of device monitoring server")
+            ("server-socket", po::value<std::string>(&server_socket),
+                "Path of Unix domain socket of device monitoring server running on the same host, used instead of --server-ip and --server-port")
             ("device-name,n", po::value<std::string>(&device_name), "Device name")
             ("report-interval", po::value<size_t>(&report_interval)->default_value(1000), "Reporting interval in milliseconds")
             ("temp-sensor,t", po::value<std::vector<std::string>>(&temp_sensor_files)->multitoken(), 
                 "Paths to files listing values of temperature sensors")
             ("fan-speed,f", po::value<std::vector<std::string>>(&fan_speed_files)->multitoken(), 
                 "Paths to files listing values of fans speeds")
+            ("format", po::value<std::string>(&format)->default_value("json"), "Format of messages sent to server (json, binary)")
+            ("udp", po::bool_switch(&udp), "Send messages as UDP datagrams to the server port instead of using TCP connection")
             ("threads", po::value<size_t>(&num_threads)->default_value(2))
             ;
     // clang-format on
@@ -56,13 +102,13 @@ int main(int argc_, char** argv_)
         std::cout << options << std::endl;
         return EXIT_SUCCESS;
     }
-    if (!vm.count("server-ip"))
+    if (!vm.count("server-ip") && !vm.count("server-socket"))
     {
         std::cerr << "Missing parameter --server-ip\n\n";
         std::cerr << options << std::endl;
         return EXIT_FAILURE;
     }
-    if (!vm.count("server-port"))
+    if (!vm.count("server-port") && !vm.count("server-socket"))
     {
         std::cerr << "Missing parameter --server-port\n\n";
         std::cerr << options << std::endl;
@@ -75,36 +121,34 @@ int main(int argc_, char** argv_)
         return EXIT_FAILURE;
     }
 
+    if (format != "json" && format != "binary")
+    {
+        std::cerr << "Invalid parameter --format\n\n";
+        std::cerr << options << std::endl;
+        return EXIT_FAILURE;
+    }
+
     // --- PROGRAM START --- //
 
     boost::asio::io_context ioc;
 
-    auto client = std::make_shared<hw::net::device_tcp_client<hw::device_control_messages::json_serializer>>(ioc);
     auto device = std::make_shared<hw::devices::file_reading_device>(device_name, ioc, report_interval, temp_sensor_files, fan_speed_files);
 
-    client->on_error = [] {
-        std::cerr << "TCP connection to server error" << std::endl;
-        exit(EXIT_FAILURE);
-    };
-
-    client->on_close = [] {
-        std::cerr << "TCP connection to server closed" << std::endl;
-        exit(EXIT_FAILURE);
-    };
-
-    client->on_connect = [&device] {
-        std::cout << "Client connected" << std::endl;
-        device->start();
-    };
-
-    device->on_message = [&client](auto msg_) {
-        auto msg_sending_visitor = [](auto m_) { std::cout << "Sending message:\n" << m_.as_string() << std::endl; };
-        std::visit(msg_sending_visitor, msg_);
-
-        client->send(std::move(msg_));
-    };
-
-    client->connect(server_ip, server_port);
+    std::shared_ptr<void> client;
+    using hw::device_control_messages::binary_serializer;
+    using hw::device_control_messages::json_serializer;
+    if (vm.count("server-socket") && format == "binary")
+        client = start_client<hw::net::device_unix_client<binary_serializer>>(ioc, device, server_socket);
+    else if (vm.count("server-socket"))
+        client = start_client<hw::net::device_unix_client<json_serializer>>(ioc, device, server_socket);
+    else if (udp && format == "binary")
+        client = start_client<hw::net::device_udp_client<hw::device_control_messages::binary_serializer>>(ioc, device, server_ip, server_port);
+    else if (udp)
+        client = start_client<hw::net::device_udp_client<hw::device_control_messages::json_serializer>>(ioc, device, server_ip, server_port);
+    else if (format == "binary")
+        client = start_client<hw::net::device_tcp_client<hw::device_control_messages::binary_serializer>>(ioc, device, server_ip, server_port);
+    else
+        client = start_client<hw::net::device_tcp_client<hw::device_control_messages::json_serializer>>(ioc, device, server_ip, server_port);
 
     std::vector<std::thread> threads;
     for (size_t i = 0; i < num_threads; i++)